@@ -200,6 +200,37 @@ template < class ValueType > void * checkConvertibleNumpyScalar(PyObject * obj){
 }
 
 
+/*! Return true if the values of the ndarray arr can be used in place as
+ * a one dimensional array of the numpy type npyType. */
+inline bool isViewable(PyArrayObject * arr, int npyType, int nDim=1){
+    return PyArray_NDIM(arr) == nDim &&
+           PyArray_EquivTypenums(PyArray_TYPE(arr), npyType) &&
+           PyArray_IS_C_CONTIGUOUS(arr) &&
+           PyArray_ISALIGNED(arr) &&
+           PyArray_ISNOTSWAPPED(arr);
+}
+
+/*! Let numpy convert a one dimensional ndarray into a contiguous array of
+ * npyType and copy it into vec. This avoids the element wise extraction
+ * of python objects for all other dtypes. */
+template < class ValueType > bool castArray(PyObject * obj, int npyType,
+                                            GIMLI::Vector< ValueType > & vec){
+    PyObject * c = PyArray_FromAny(obj, PyArray_DescrFromType(npyType), 1, 1,
+                                   NPY_ARRAY_CARRAY_RO | NPY_ARRAY_FORCECAST,
+                                   NULL);
+    if (!c) {
+        PyErr_Clear();
+        return false;
+    }
+    PyArrayObject * ca = (PyArrayObject *)c;
+    vec.resize(PyArray_DIM(ca, 0));
+    if (vec.size() > 0) {
+        std::memcpy(&vec[0], PyArray_DATA(ca), vec.size() * sizeof(ValueType));
+    }
+    Py_DECREF(c);
+    return true;
+}
+
 struct PyTuple2RVector3{
 
     typedef boost::tuples::tuple< double, double > xy_type;
@@ -259,36 +290,31 @@ struct PySequence2RVector{
         void* memory_chunk = the_storage->storage.bytes;
 
         bp::object py_sequence(bp::handle<>(bp::borrowed(obj)));
-        GIMLI::Vector< double > * vec = new (memory_chunk) GIMLI::Vector< double >(len(py_sequence));
+        GIMLI::Vector< double > * vec = new (memory_chunk) GIMLI::Vector< double >();
         data->convertible = memory_chunk;
 
-        if (strcmp(obj->ob_type->tp_name, "numpy.ndarray") == 0){
+        if (PyArray_Check(obj)){
             PyArrayObject *arr = (PyArrayObject *)obj;
             __DC("type is " << obj->ob_type->tp_name << " " << PyArray_TYPE(arr))
 
-            if (PyArray_TYPE(arr) == 12 && PyArray_ISONESEGMENT(arr)){
-                void * arrData = PyArray_DATA(arr);
-                std::memcpy(&(*vec)[0], arrData, vec->size() * sizeof(double));
+            //** the argument lives as long as the call, so no copy is needed
+            if (isViewable(arr, NPY_FLOAT64)){
+                vec->attach((double *)PyArray_DATA(arr), PyArray_DIM(arr, 0));
                 return;
-            } else if (PyArray_TYPE(arr) == 7 && PyArray_ISONESEGMENT(arr)){ //numpy.int64
-                    __DC(arr << " ** from array of type " << PyArray_TYPE(arr))
-
-                    bp::object element;
-
-                    for (GIMLI::Index i = 0; i < vec->size(); i ++){
-                        element = py_sequence[i];
-                        (*vec)[i] = PyArrayScalar_VAL(element.ptr(), Int64);
-
-    //                     __DC(i << " a " << element);
-    //                     __DC(i << " a " << element.ptr()->ob_type->tp_name)
-    //                     __DC(i << " d " <<  PyArrayScalar_VAL(element.ptr(), Int64));
+            }
+            if (PyArray_NDIM(arr) == 1 &&
+                (PyArray_ISINTEGER(arr) || PyArray_ISFLOAT(arr))){
+                if (castArray(obj, NPY_FLOAT64, *vec)) return;
+            }
+            vec->resize(len(py_sequence));
 
-                    }
-                    return;
-            } else {
-                    __DC("fixme: type=" << PyArray_TYPE(arr))
+            if (PyArray_TYPE(arr) == NPY_FLOAT64 && PyArray_ISONESEGMENT(arr)){
+                std::memcpy(&(*vec)[0], PyArray_DATA(arr), vec->size() * sizeof(double));
+                return;
             }
+            __DC("fixme: type=" << PyArray_TYPE(arr))
         }
+        vec->resize(len(py_sequence));
 
         // convert from list
         __DC(obj << " ** from sequence ")
@@ -319,65 +345,26 @@ struct PySequence2CVector{
 
         bp::object py_sequence(bp::handle<>(bp::borrowed(obj)));
         GIMLI::Vector< GIMLI::Complex > * vec =
-            new (memory_chunk) GIMLI::Vector< GIMLI::Complex >(len(py_sequence));
+            new (memory_chunk) GIMLI::Vector< GIMLI::Complex >();
         data->convertible = memory_chunk;
 
-        if (strcmp(obj->ob_type->tp_name, "numpy.ndarray") == 0){
+        if (PyArray_Check(obj)){
             PyArrayObject *arr = (PyArrayObject *)obj;
             __DC("type is " << obj->ob_type->tp_name << " " << PyArray_TYPE(arr))
 
-            if (PyArray_TYPE(arr) == 12 && PyArray_ISONESEGMENT(arr)){
-                void * arrData = PyArray_DATA(arr);
-                std::memcpy(&(*vec)[0], arrData, vec->size() * sizeof(double));
+            //** std::complex< double > has the layout of numpy.complex128
+            if (isViewable(arr, NPY_COMPLEX128)){
+                vec->attach((GIMLI::Complex *)PyArray_DATA(arr),
+                            PyArray_DIM(arr, 0));
                 return;
-            } else if (PyArray_TYPE(arr) == 7 && PyArray_ISONESEGMENT(arr)){ //numpy.int64
-                    __DC(arr << " ** from array of type " << PyArray_TYPE(arr))
-
-                    bp::object element;
-
-                    for (GIMLI::Index i = 0; i < vec->size(); i ++){
-                        element = py_sequence[i];
-                        (*vec)[i] = PyArrayScalar_VAL(element.ptr(), Int64);
-    //                     __DC(i << " a " << element);
-    //                     __DC(i << " a " << element.ptr()->ob_type->tp_name)
-    //                     __DC(i << " d " <<  PyArrayScalar_VAL(element.ptr(), Int64));
-                    }
-                    return;
-            } else if (PyArray_TYPE(arr) == 15 && PyArray_ISONESEGMENT(arr)){ //numpy.complex
-                __DC(arr << " ** from array of type " << PyArray_TYPE(arr))
-
-                bp::object element;
-
-                for (GIMLI::Index i = 0; i < vec->size(); i ++){
-                    element = py_sequence[i];
-
-#ifndef NPY_2_0_API_VERSION
-                    (*vec)[i] = GIMLI::Complex(
-                            PyArrayScalar_VAL(element.ptr(), Complex128).real,
-                            PyArrayScalar_VAL(element.ptr(), Complex128).imag);
-#else
-                    //see and fix me! https://numpy.org/devdocs/release/2.0.0-notes.html#complex-types-underlying-c-type-changes
-                    (*vec)[i] = GIMLI::Complex(
-                            npy_creal(PyArrayScalar_VAL(element.ptr(), Complex128)),
-                            npy_cimag(PyArrayScalar_VAL(element.ptr(), Complex128)));
-#endif
-//                     (*vec)[i] = PyArrayScalar_VAL(element.ptr(),
-//                     __DC(i << " a " << element);
-//                     __DC(i << " a "
-//                         << bp::extract< double >(element.attr('real')));
-//                     __DC(i << " a "
-//                     << bp::extract< double >(bp::extract<bp::tuple>(element)));
-//                     __DC(i << " a " << element.ptr()->ob_type->tp_name);
-//                     PyArrayScalar_VAL(element.ptr(), Complex128).real;
-//                     PyArrayScalar_VAL(element.ptr(), Complex128).imag;
-//                     __DC(i << " d " <<  PyArrayScalar_VAL(element.ptr(),
-//                                                           Complex128));
-                }
-                return;
-            } else {
-                 __DC("fixme: type="
-                 << PyArray_TYPE(arr) << " " << PyArray_ISONESEGMENT(arr))
             }
+            if (PyArray_NDIM(arr) == 1 &&
+                (PyArray_ISINTEGER(arr) || PyArray_ISFLOAT(arr) ||
+                 PyArray_ISCOMPLEX(arr))){
+                if (castArray(obj, NPY_COMPLEX128, *vec)) return;
+            }
+            __DC("fixme: type="
+                 << PyArray_TYPE(arr) << " " << PyArray_ISONESEGMENT(arr))
         }
 
         // convert from list
@@ -408,8 +395,21 @@ struct PySequence2IndexArray{
         storage_t* the_storage = reinterpret_cast<storage_t*>(data);
         void* memory_chunk = the_storage->storage.bytes;
 
-        GIMLI::IndexArray * vec = new (memory_chunk) GIMLI::IndexArray(len(py_sequence));
+        GIMLI::IndexArray * vec = new (memory_chunk) GIMLI::IndexArray();
         data->convertible = memory_chunk;
+
+        if (PyArray_Check(obj)){
+            PyArrayObject *arr = (PyArrayObject *)obj;
+            //** int64 values are taken bitwise like the scalar conversion does
+            if (isViewable(arr, NPY_UINT64) || isViewable(arr, NPY_INT64)){
+                vec->attach((GIMLI::Index *)PyArray_DATA(arr), PyArray_DIM(arr, 0));
+                return;
+            }
+            if (PyArray_NDIM(arr) == 1 && PyArray_ISINTEGER(arr)){
+                if (castArray(obj, NPY_UINT64, *vec)) return;
+            }
+        }
+        vec->resize(len(py_sequence));
         __DC(obj << "\t from list")
         for (GIMLI::Index i = 0; i < vec->size(); i ++){
             (*vec)[i] = bp::extract< GIMLI::Index >(py_sequence[i]);
@@ -436,8 +436,20 @@ struct PySequence2IVector{
         storage_t* the_storage = reinterpret_cast<storage_t*>(data);
         void* memory_chunk = the_storage->storage.bytes;
 
-        GIMLI::IVector * vec = new (memory_chunk) GIMLI::IVector(len(py_sequence));
+        GIMLI::IVector * vec = new (memory_chunk) GIMLI::IVector();
         data->convertible = memory_chunk;
+
+        if (PyArray_Check(obj)){
+            PyArrayObject *arr = (PyArrayObject *)obj;
+            if (isViewable(arr, NPY_INT64)){
+                vec->attach((GIMLI::SIndex *)PyArray_DATA(arr), PyArray_DIM(arr, 0));
+                return;
+            }
+            if (PyArray_NDIM(arr) == 1 && PyArray_ISINTEGER(arr)){
+                if (castArray(obj, NPY_INT64, *vec)) return;
+            }
+        }
+        vec->resize(len(py_sequence));
         __DC(obj << "\t from list")
         for (GIMLI::Index i = 0; i < vec->size(); i ++){
             //__DC(obj << " " << i << " " << bp::extract< long >(py_sequence[i]))
@@ -461,8 +473,16 @@ struct PySequence2BVector{
         storage_t* the_storage = reinterpret_cast<storage_t*>(data);
         void* memory_chunk = the_storage->storage.bytes;
 
-        GIMLI::BVector * vec = new (memory_chunk) GIMLI::BVector(len(py_sequence));
+        GIMLI::BVector * vec = new (memory_chunk) GIMLI::BVector();
         data->convertible = memory_chunk;
+
+        if (PyArray_Check(obj) && sizeof(bool) == 1 &&
+            isViewable((PyArrayObject *)obj, NPY_BOOL)){
+            PyArrayObject *arr = (PyArrayObject *)obj;
+            vec->attach((bool *)PyArray_DATA(arr), PyArray_DIM(arr, 0));
+            return;
+        }
+        vec->resize(len(py_sequence));
         __DC(obj << "\t from list")
         for (GIMLI::Index i = 0; i < vec->size(); i ++){
             (*vec)[i] = PyArrayScalar_VAL(bp::object(py_sequence[i]).ptr(), Bool);
@@ -550,6 +570,33 @@ struct Numpy2RMatrix{
 
         PyArrayObject *arr = (PyArrayObject *)obj;
 
+        if (isViewable(arr, NPY_FLOAT64, 2)){
+            //** every row is a view into the argument array
+            GIMLI::Matrix < double > *mat = new (memory_chunk) GIMLI::Matrix < double >();
+            data->convertible = memory_chunk;
+            mat->attach((double *)PyArray_DATA(arr),
+                        PyArray_DIM(arr, 0), PyArray_DIM(arr, 1));
+            return;
+        }
+
+        if (PyArray_NDIM(arr) == 2 && PyArray_TYPE(arr) != NPY_FLOAT64 &&
+            (PyArray_ISINTEGER(arr) || PyArray_ISFLOAT(arr))){
+            PyObject * c = PyArray_FromAny(obj, PyArray_DescrFromType(NPY_FLOAT64),
+                                           2, 2, NPY_ARRAY_CARRAY_RO | NPY_ARRAY_FORCECAST,
+                                           NULL);
+            if (c) {
+                PyArrayObject * ca = (PyArrayObject *)c;
+                GIMLI::Matrix < double > *mat = new (memory_chunk)
+                    GIMLI::Matrix < double >(PyArray_DIM(ca, 0), PyArray_DIM(ca, 1),
+                                             (double *)PyArray_DATA(ca));
+                data->convertible = memory_chunk;
+                Py_DECREF(c);
+                __DC("rows=" << mat->rows() << " cols=" << mat->cols())
+                return;
+            }
+            PyErr_Clear();
+        }
+
         if (PyArray_TYPE(arr) == 12) {
             __DC("\ttype=" << PyArray_TYPE(arr)
                 << " ISONESEGMENT:" << PyArray_ISONESEGMENT(arr)
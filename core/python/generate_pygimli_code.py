@@ -610,6 +610,11 @@ def generate(defined_symbols, extraIncludes):
 
     # exclude all that does not match any predefined callpolicie
 
+    # clone() hands over ownership of a new forward operator
+    for mem_fun in mb.member_functions('clone', allow_empty=True):
+        mem_fun.call_policies = call_policies.return_value_policy(
+            call_policies.manage_new_object)
+
     excludeRest = True
 
     if excludeRest:
@@ -67,23 +67,63 @@ public:
         }
     }
 
+    /*! Flush the column panel of sensitivities for the model indices
+    [panelStart, panelStart + width) into S_ with contiguous row writes. */
+    void flushPanel_(std::vector < ValueType > & panel,
+                     SIndex panelStart, Index width){
+        if (panelStart < 0) return;
+        Index nCols = min(width, S_->cols() - panelStart);
+
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++){
+            ValueType * row = &(*S_)[dataIdx][panelStart];
+            for (Index j = 0; j < nCols; j ++){
+                row[j] += panel[j * nData_ + dataIdx];
+            }
+        }
+        std::fill(panel.begin(), panel.begin() + width * nData_, ValueType(0));
+    }
+
     virtual void calc2(){
         ElementMatrix < double > S_i;
         ElementMatrix < double > S1_i;
 
         Cell * cell = NULL;
-        int modelIdx = 0;
-
-        const Vector < ValueType > *va;
-        const Vector < ValueType > *vb;
-        const Vector < ValueType > *vm;
-        const Vector < ValueType > *vn;
-        Vector < ValueType > dummy((*pots_)[0].size(), ValueType(0));
+        SIndex modelIdx = 0;
+
+        //** resolve the electrode columns once, poles (-1) point to the
+        //** zero row nElecs_ of the gathered potential block
+        std::vector < Index > a(nData_), b(nData_), m(nData_), n(nData_);
+        const RVector & da = (*data_)("a");
+        const RVector & db = (*data_)("b");
+        const RVector & dm = (*data_)("m");
+        const RVector & dn = (*data_)("n");
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            a[dataIdx] = da[dataIdx] > -1 ? Index(da[dataIdx]) : nElecs_;
+            b[dataIdx] = db[dataIdx] > -1 ? Index(db[dataIdx]) : nElecs_;
+            m[dataIdx] = dm[dataIdx] > -1 ? Index(dm[dataIdx]) : nElecs_;
+            n[dataIdx] = dn[dataIdx] > -1 ? Index(dn[dataIdx]) : nElecs_;
+        }
 
-        const RVector *da = &(*data_)("a");
-        const RVector *db = &(*data_)("b");
-        const RVector *dm = &(*data_)("m");
-        const RVector *dn = &(*data_)("n");
+        //** small dense blocks per cell: P holds the cell's node potentials
+        //** for all electrodes, Q = P * S_i^T, both (nElecs_ + 1) x nNodes
+        std::vector < ValueType > P;
+        std::vector < ValueType > Q;
+        std::vector < double > Sk;
+
+        //** if the data outnumber the electrode pairs, the k-sum is folded
+        //** into the electrode pair products E = sum_k w_k P_k S_k P_k^T once
+        //** per cell, so every datum only needs four lookups into E
+        const Index nK = weights_->size();
+        const Index nE1 = nElecs_ + 1;
+        const bool usePairs = (nE1 * nE1 / 2 < nData_);
+        std::vector < ValueType > E(usePairs ? nE1 * nE1 : 0, ValueType(0));
+
+        //** sensitivities for a run of consecutive model indices, stored
+        //** column wise and flushed into S_ as contiguous row panels
+        const Index panelWidth = 32;
+        std::vector < ValueType > panel(panelWidth * nData_, ValueType(0));
+        SIndex panelStart = -1;
+        Index panelUsed = 0;
 
         for (Index cellID = start_; cellID < end_; cellID ++) {
 
@@ -92,30 +132,98 @@ public:
 
             if (modelIdx < 0) continue;
 
+            if (panelStart < 0 || modelIdx < panelStart ||
+                modelIdx >= panelStart + SIndex(panelWidth)){
+                flushPanel_(panel, panelStart, panelUsed);
+                panelStart = modelIdx;
+                panelUsed = 0;
+            }
+            //** only flush columns of own cells, others may belong to
+            //** another thread
+            panelUsed = max(panelUsed, Index(modelIdx - panelStart + 1));
+            ValueType * sens = &panel[(modelIdx - panelStart) * nData_];
+
+            //** stiffness and mass part are needed only once per cell,
+            //** each k just forms S_k = S1_i + k^2 * S_i from both
             S1_i.ux2uy2uz2(*cell);
+            S_i.u2(*cell);
 
-            for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
-                S_i.u2(*cell);
-                S_i *= (*k_)[kIdx] * (*k_)[kIdx];
-                S_i += S1_i;
-                int a = 0, b = 0, m = 0, n = 0;
-                for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            const IndexArray & ids = S1_i.ids();
+            Index nN = S1_i.size();
+            const Matrix < double > & stiff = S1_i.mat();
+            const Matrix < double > & mass = S_i.mat();
 
-                    a = (int)(*da)[dataIdx];
-                    b = (int)(*db)[dataIdx];
-                    m = (int)(*dm)[dataIdx];
-                    n = (int)(*dn)[dataIdx];
+            P.assign((nElecs_ + 1) * nN, ValueType(0));
+            Q.assign((nElecs_ + 1) * nN, ValueType(0));
+            Sk.resize(nN * nN);
+            if (usePairs) std::fill(E.begin(), E.end(), ValueType(0));
 
-                    if (a > -1) va = &(*pots_)[a + nElecs_ * kIdx]; else va = &dummy;
-                    if (b > -1) vb = &(*pots_)[b + nElecs_ * kIdx]; else vb = &dummy;
-                    if (m > -1) vm = &(*pots_)[m + nElecs_ * kIdx]; else vm = &dummy;
-                    if (n > -1) vn = &(*pots_)[n + nElecs_ * kIdx]; else vn = &dummy;
+            for (Index kIdx = 0; kIdx < nK; kIdx ++){
+                const double k2 = (*k_)[kIdx] * (*k_)[kIdx];
+                const double w = (*weights_)[kIdx];
+
+                for (Index i = 0; i < nN; i ++){
+                    for (Index j = 0; j < nN; j ++){
+                        Sk[i * nN + j] = stiff[i][j] + k2 * mass[i][j];
+                    }
+                }
+
+                for (Index e = 0; e < nElecs_; e ++){
+                    const Vector < ValueType > & pot = (*pots_)[e + nElecs_ * kIdx];
+                    ValueType * Pe = &P[e * nN];
+                    for (Index j = 0; j < nN; j ++) Pe[j] = pot[ids[j]];
+                }
+
+                for (Index e = 0; e < nElecs_; e ++){
+                    const ValueType * Pe = &P[e * nN];
+                    ValueType * Qe = &Q[e * nN];
+                    for (Index i = 0; i < nN; i ++){
+                        const double * Si = &Sk[i * nN];
+                        ValueType t = ValueType(0);
+                        for (Index j = 0; j < nN; j ++) t += Si[j] * Pe[j];
+                        Qe[i] = t;
+                    }
+                }
+
+                if (usePairs){
+                    //** E[e][f] += w_k * P_e^T S_k P_f, symmetric since S_k is
+                    for (Index e = 0; e < nElecs_; e ++){
+                        const ValueType * Qe = &Q[e * nN];
+                        for (Index f = e; f < nElecs_; f ++){
+                            const ValueType * Pf = &P[f * nN];
+                            ValueType t = ValueType(0);
+                            for (Index i = 0; i < nN; i ++) t += Qe[i] * Pf[i];
+                            E[e * nE1 + f] += t * w;
+                        }
+                    }
+                } else {
+                    for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                        const ValueType * Qa = &Q[a[dataIdx] * nN];
+                        const ValueType * Qb = &Q[b[dataIdx] * nN];
+                        const ValueType * Pm = &P[m[dataIdx] * nN];
+                        const ValueType * Pn = &P[n[dataIdx] * nN];
+                        ValueType sum = ValueType(0);
+                        for (Index i = 0; i < nN; i ++){
+                            sum += (Qa[i] - Qb[i]) * (Pm[i] - Pn[i]);
+                        }
+                        sens[dataIdx] += sum * w;
+                    }
+                }
+            }
 
-                    (*S_)[dataIdx][modelIdx] +=
-                       S_i.mult((*va), (*vb), (*vm), (*vn)) * (*weights_)[kIdx];
+            if (usePairs){
+                for (Index e = 0; e < nElecs_; e ++){
+                    for (Index f = 0; f < e; f ++) E[e * nE1 + f] = E[f * nE1 + e];
+                }
+                for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                    const ValueType * Ea = &E[a[dataIdx] * nE1];
+                    const ValueType * Eb = &E[b[dataIdx] * nE1];
+                    sens[dataIdx] += (Ea[m[dataIdx]] - Ea[n[dataIdx]]) -
+                                     (Eb[m[dataIdx]] - Eb[n[dataIdx]]);
                 }
             }
         }
+        flushPanel_(panel, panelStart, panelUsed);
     }
 
     virtual void calc1(){
@@ -264,6 +372,20 @@ protected:
 
 bool lessCellMarker(const Cell * c1, const Cell * c2) { return c1->marker() < c2->marker(); }
 
+/*! Chunk borders for the marker sorted cells. All cells of one marker add to
+ * the same sensitivity column, so they need to stay in one chunk. */
+std::vector < Index > markerChunks(const std::vector < Cell * > & cells,
+                                   uint nThreads){
+    Index grain = max(Index(1), Index(cells.size() / (8 * max(1u, nThreads))));
+    std::vector < Index > bounds(1, 0);
+    for (Index i = 1; i < cells.size(); i ++){
+        if (i - bounds.back() >= grain &&
+            cells[i]->marker() != cells[i - 1]->marker()) bounds.push_back(i);
+    }
+    bounds.push_back(cells.size());
+    return bounds;
+}
+
 template < class ValueType >
 void createSensitivityCol_(Matrix < ValueType > & S,
                           const Mesh & mesh,
@@ -364,7 +486,7 @@ MEMINFO
                                                                weights, k,
                                                                calc1,
                                                                verbose),
-                           cellsCluster.size(), nThreads, verbose);
+                           markerChunks(cellsCluster, nThreads), nThreads, verbose);
 
 MEMINFO
 
@@ -408,7 +530,7 @@ MEMINFO
             distributeCalc(CreateSensitivityColMT< ValueType >(S, cells, data,
                                                            pots, currPatternIdx,
                                                            weights, k, calc1, verbose),
-                            cells.size(), nThreads, verbose);
+                            markerChunks(cells, nThreads), nThreads, verbose);
         }
          if (verbose){
              swatch.stop(verbose);
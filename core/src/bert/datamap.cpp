@@ -22,18 +22,39 @@
 #include "electrode.h"
 
 #include <interpolate.h>
+#include <mappedfile.h>
 #include <node.h>
 #include <meshentities.h>
+#include <threadpool.h>
 
+#include <cstring>
 #include <fstream>
 
 namespace GIMLI{
 
-DataMap::DataMap(){
-    complex_ = false;
+namespace {
+
+static const char DATAMAPBIN_MAGIC[4] = {'G', 'D', 'M', 'B'};
+
+template < class ValueType > void writeToFile_(std::fstream & file, const ValueType * v, Index n){
+    if (n > 0) file.write(reinterpret_cast< const char * >(v), n * sizeof(ValueType));
+}
+
+template < class ValueType > const ValueType * readFromMap_(const MappedFile & mf,
+                                                           Index & pos, Index n){
+    const ValueType * v = mf.at< ValueType >(pos, n);
+    pos += n * sizeof(ValueType);
+    return v;
+}
+
+} // namespace
+
+DataMap::DataMap()
+    : rows_(0), cols_(0), complex_(false){
 }
 
-DataMap::DataMap(const std::string & filename){
+DataMap::DataMap(const std::string & filename)
+    : rows_(0), cols_(0), complex_(false){
     this->load(filename);
 }
 
@@ -50,14 +71,32 @@ DataMap & DataMap::operator = (const DataMap & map){
 
 void DataMap::copy_(const DataMap & map){
     elecs_ = map.electrodes();
-    map_ = map.map();
+    pot_ = map.potentials();
+    rows_ = map.rows();
+    cols_ = map.cols();
     complex_ = map.isComplex();
 }
 
+void DataMap::resize_(Index rows, Index cols){
+    rows_ = rows;
+    cols_ = cols;
+    pot_.resize(rows * cols);
+}
+
+RMatrix DataMap::map() const {
+    RMatrix ret(rows_, cols_);
+    for (Index i = 0; i < rows_; i ++){
+        if (cols_ > 0) std::memcpy(&ret.rowRef(i)[0], &pot_[i * cols_],
+                                   cols_ * sizeof(double));
+    }
+    return ret;
+}
+
 void DataMap::collect(const std::vector < ElectrodeShape * > & electrodes,
                       const RMatrix & sol, bool isCEM){
     elecs_.clear();
-    map_.clear();
+    resize_(0, 0);
+    complex_ = false;
     for (uint i = 0; i < electrodes.size(); i ++) {
         if (electrodes[i]){
             if (electrodes[i]->id() > -1){
@@ -75,29 +114,33 @@ void DataMap::collect(const std::vector < ElectrodeShape * > & electrodes,
     if ((sol.rows()     == elecs_.size() && sol.cols() == elecs_.size()) ||
         (sol.rows()     == elecs_.size() && sol.cols() == elecs_.size() + 1) ||
         (sol.rows() + 1 == elecs_.size() && sol.cols() == elecs_.size()) ||
+        (sol.rows()     == 2. * elecs_.size() && sol.cols() == elecs_.size()) ||
         isCEM ){
 
-        map_ = sol;
-    } else if((sol.rows()     == 2. * elecs_.size() && sol.cols() == elecs_.size()) ){
-        map_ = sol;
-        complex_ = true;
-    } else {
-        RVector tmp(elecs_.size());
-        for (size_t row = 0; row < sol.rows(); row ++) {
-//             __MS(row)
-//             __MS(sol.rows())
-            for (size_t i = 0; i < tmp.size(); i ++) {
-//                 __MS(i)
-//                 __MS(sol.rows())
-//                 __MS(sol.cols())
-                tmp[i] = electrodes[i]->pot(sol[row]);
+        complex_ = (!isCEM && sol.rows() == 2 * elecs_.size() &&
+                    sol.cols() == elecs_.size());
+        resize_(sol.rows(), sol.cols());
+        for (Index i = 0; i < rows_; i ++){
+            if (sol[i].size() != cols_){
+                throwLengthError(WHERE_AM_I + " sol is not rectangular: row "
+                                 + str(i) + " " + str(sol[i].size()) + " != " + str(cols_));
             }
-            map_.push_back(tmp);
+            if (cols_ > 0) std::memcpy(&pot_[i * cols_], &sol[i][0], cols_ * sizeof(double));
         }
+    } else {
+        resize_(sol.rows(), elecs_.size());
+        //** every row interpolates the solution at all electrodes
+        parallelFor(0, rows_, 1, [&](Index start, Index end, Index){
+            for (Index row = start; row < end; row ++) {
+                for (Index i = 0; i < cols_; i ++) {
+                    pot_[row * cols_ + i] = electrodes[i]->pot(sol[row]);
+                }
+            }
+        });
     }
 }
 
-int DataMap::save(const std::string & filename){
+int DataMap::save(const std::string & filename) const {
     std::fstream outfile; if (!openOutFile(filename, & outfile)){ return -1; }
     uint nElecs = elecs_.size();
 
@@ -109,9 +152,9 @@ int DataMap::save(const std::string & filename){
     outfile.setf(std::ios::scientific, std::ios::floatfield);
     outfile.precision(14);
 
-    for (size_t i = 0; i < map_.rows(); i ++){
-        for (size_t j = 0; j < map_[i].size(); j ++){
-            outfile << map_[i][j] << "\t";
+    for (Index i = 0; i < rows_; i ++){
+        for (Index j = 0; j < cols_; j ++){
+            outfile << pot_[i * cols_ + j] << "\t";
         }
         outfile << std::endl;
     }
@@ -119,7 +162,61 @@ int DataMap::save(const std::string & filename){
     return 1;
 }
 
+int DataMap::saveBinary(const std::string & filename) const {
+    std::fstream file;
+    if (!openFile(filename, &file, std::ios::out | std::ios::binary, true)) return -1;
+
+    file.write(DATAMAPBIN_MAGIC, 4);
+    uint32 version = 1;
+    writeToFile_(file, &version, 1);
+    uint64 counts[4] = {elecs_.size(), rows_, cols_, complex_ ? 1u : 0u};
+    writeToFile_(file, counts, 4);
+
+    std::vector < double > p(3 * elecs_.size());
+    for (Index i = 0; i < elecs_.size(); i ++){
+        for (Index j = 0; j < 3; j ++) p[3 * i + j] = elecs_[i][j];
+    }
+    writeToFile_(file, p.data(), p.size());
+    if (pot_.size() > 0) writeToFile_(file, &pot_[0], pot_.size());
+
+    if (!file.good()){
+        throwError(WHERE_AM_I + " error while writing " + filename);
+    }
+    file.close();
+    return 1;
+}
+
 int DataMap::load(const std::string & filename){
+    elecs_.clear();
+    resize_(0, 0);
+    complex_ = false;
+
+    {
+        MappedFile mf(filename);
+        if (mf.size() >= 4 && std::memcmp(mf.data(), DATAMAPBIN_MAGIC, 4) == 0){
+            Index pos = 4;
+            uint32 version = *readFromMap_< uint32 >(mf, pos, 1);
+            if (version != 1){
+                throwError(WHERE_AM_I + " " + filename + ": unknown version " + str(version));
+            }
+            const uint64 * counts = readFromMap_< uint64 >(mf, pos, 4);
+            Index nElecs = counts[0];
+            Index rows = counts[1];
+            Index cols = counts[2];
+            complex_ = counts[3] != 0;
+
+            const double * p = readFromMap_< double >(mf, pos, 3 * nElecs);
+            elecs_.resize(nElecs);
+            for (Index i = 0; i < nElecs; i ++){
+                elecs_[i] = RVector3(p[3 * i], p[3 * i + 1], p[3 * i + 2]);
+            }
+            const double * v = readFromMap_< double >(mf, pos, rows * cols);
+            resize_(rows, cols);
+            if (pot_.size() > 0) std::memcpy(&pot_[0], v, pot_.size() * sizeof(double));
+            return 1;
+        }
+    }
+
     std::fstream file; if (!openInFile(filename, & file)){ return -1; }
 
     std::vector < std::string > row; row = getNonEmptyRow(file);
@@ -143,91 +240,142 @@ int DataMap::load(const std::string & filename){
         }
     }
 
+    std::vector < double > vals;
+    Index rows = 0, cols = 0;
     while (!file.eof()){
         row = getNonEmptyRow(file);
         if (row.size() > 0){
-            RVector tmp(row.size());
-            for (size_t i = 0; i < row.size(); i ++) tmp[i] = toDouble(row[i ]);
-            map_.push_back(tmp);
+            if (rows == 0) cols = row.size();
+            if (row.size() != cols){
+                throwError(WHERE_AM_I + " " + filename + ": row " + str(rows)
+                           + " has " + str(row.size()) + " values, expected " + str(cols));
+            }
+            for (size_t i = 0; i < row.size(); i ++) vals.push_back(toDouble(row[i]));
+            rows ++;
         }
     }
-
     file.close();
+
+    resize_(rows, cols);
+    if (vals.size() > 0) std::memcpy(&pot_[0], &vals[0], vals.size() * sizeof(double));
+    complex_ = (nElecs > 0 && rows == 2 * nElecs && cols == nElecs);
     return 1;
 }
 
-RVector DataMap::data(const DataContainerERT & data, bool reciprocity, bool imag){
-    size_t nData = data.size();
-    size_t nElecs = elecs_.size();
+RVector DataMap::data(const DataContainerERT & dat, bool reciprocity, bool imag) const {
+    RVector u;
+    if (reciprocity){
+        gather_(dat, NULL, &u, imag);
+    } else {
+        gather_(dat, &u, NULL, imag);
+    }
+    return u;
+}
+
+void DataMap::data(const DataContainerERT & dat, RVector & u, RVector & uRez,
+                   bool imag) const {
+    gather_(dat, &u, &uRez, imag);
+}
+
+void DataMap::gather_(const DataContainerERT & dat, RVector * u, RVector * uRez,
+                      bool imag) const {
+    Index nData = dat.size();
+    int nElecs = elecs_.size();
 
     Index offSet = 0;
     if (imag){
-        if (map_.rows() == 2 * nElecs){
+        if (rows_ == 2 * Index(nElecs)){
             offSet = nElecs;
         } else {
             throwError(WHERE_AM_I + " imaginary values requested but not calculated");
         }
     }
 
-    RVector uVec(nData);
-    for (size_t i = 0; i < nData; i ++){
-        int a = data("a")[i];
-        int b = data("b")[i];
-        int m = data("m")[i];
-        int n = data("n")[i];
-
-        if (reciprocity){
-            std::swap(a, m);
-            std::swap(b, n);
-        }
-
-        if ((a > (int)nElecs - 1) || (a < -1) || (b > (int)nElecs - 1) || (b < -1) ||
-             (m > (int)nElecs - 1) || (m < -1) || (n > (int)nElecs - 1) || (n < -1)) {
+    //** resolve the sensor columns once
+    const RVector & dA = dat("a");
+    const RVector & dB = dat("b");
+    const RVector & dM = dat("m");
+    const RVector & dN = dat("n");
+    std::vector < int > abmn(4 * nData);
+    for (Index i = 0; i < nData; i ++){
+        int a = dA[i], b = dB[i], m = dM[i], n = dN[i];
+
+        if ((a > nElecs - 1) || (a < -1) || (b > nElecs - 1) || (b < -1) ||
+             (m > nElecs - 1) || (m < -1) || (n > nElecs - 1) || (n < -1)) {
             std::stringstream str1;
             str1 << WHERE_AM_I << " Collect matrix to small. data: "
                 << i << " Number of electrodes = "
                 << nElecs
                 << "; a = " << a+1  << " b = " << b+1 << " m = " << m+1 << " n = " << n+1 << std::endl;
-            //dat.save("tmp.data");
             throwLengthError(str1.str());
         }
+        abmn[4 * i] = a; abmn[4 * i + 1] = b; abmn[4 * i + 2] = m; abmn[4 * i + 3] = n;
+    }
 
-        double uAM = 0.0, uAN = 0.0, uBM = 0.0, uBN = 0.0;
-
-        if (map_.rows() == nElecs || map_.rows() == 2*nElecs){
-            if (a != -1 && m != -1) uAM = map_[a + offSet][m];
-            if (a != -1 && n != -1) uAN = map_[a + offSet][n];
-            if (b != -1 && m != -1) uBM = map_[b + offSet][m];
-            if (b != -1 && n != -1) uBN = map_[b + offSet][n];
-        } else {
-            if (map_.rows() + 1 == nElecs && map_.cols() == nElecs){
-                //!** probably measured agains last electrode as current and power reference
-                if (a == (int)nElecs -1) a = -1;
-                if (b == (int)nElecs -1) b = -1;
-
-                if (a != -1 && m != -1) uAM = map_[a][m];
-                if (a != -1 && n != -1) uAN = map_[a][n];
-                if (b != -1 && m != -1) uBM = map_[b][m];
-                if (b != -1 && n != -1) uBN = map_[b][n];
+    bool full = (rows_ == Index(nElecs) || rows_ == 2 * Index(nElecs));
+    //** probably measured agains last electrode as current and power reference
+    bool lastRef = (rows_ + 1 == Index(nElecs) && cols_ == Index(nElecs));
+
+    //** fills uXX with the four potentials for current a, b and power m, n
+    auto potentials = [&](int a, int b, int m, int n, double * uXX){
+        uXX[0] = uXX[1] = uXX[2] = uXX[3] = 0.0;
+        if (lastRef){
+            if (a == nElecs - 1) a = -1;
+            if (b == nElecs - 1) b = -1;
+        } else if (!full) {
+            return;
+        }
+        const double * pA = a != -1 ? &pot_[(a + offSet) * cols_] : NULL;
+        const double * pB = b != -1 ? &pot_[(b + offSet) * cols_] : NULL;
+        if (pA && m != -1) uXX[0] = pA[m];
+        if (pA && n != -1) uXX[1] = pA[n];
+        if (pB && m != -1) uXX[2] = pB[m];
+        if (pB && n != -1) uXX[3] = pB[n];
+    };
+
+    if (u) u->resize(nData);
+    if (uRez) uRez->resize(nData);
+
+    parallelFor(0, nData, 0, [&](Index start, Index end, Index){
+        double uXX[4];
+        for (Index i = start; i < end; i ++){
+            const int * c = &abmn[4 * i];
+            if (u){
+                potentials(c[0], c[1], c[2], c[3], uXX);
+                (*u)[i] = (uXX[0] - uXX[1]) - (uXX[2] - uXX[3]);
+            }
+            if (uRez){
+                //** reciprocity: a <-> m and b <-> n
+                potentials(c[2], c[3], c[0], c[1], uXX);
+                (*uRez)[i] = (uXX[0] - uXX[1]) - (uXX[2] - uXX[3]);
             }
         }
-
-        uVec[i] = (uAM - uAN) - (uBM - uBN);
-
-        if (std::fabs(uVec[i]) < TOLERANCE/1000. || std::isnan(uVec[i])){
-            if (!imag){
-                
+    });
+
+    if (imag) return;
+
+    for (Index k = 0; k < 2; k ++){
+        RVector * v = k == 0 ? u : uRez;
+        if (!v) continue;
+        for (Index i = 0; i < nData; i ++){
+            if (std::fabs((*v)[i]) < TOLERANCE/1000. || std::isnan((*v)[i])){
+                int a = abmn[4 * i], b = abmn[4 * i + 1];
+                int m = abmn[4 * i + 2], n = abmn[4 * i + 3];
+                if (k == 1){
+                    std::swap(a, m);
+                    std::swap(b, n);
+                }
+                double uXX[4];
+                potentials(a, b, m, n, uXX);
                 std::stringstream str1;
                 str1 << WHERE_AM_I << std::endl << " a = " << a
                     << " b = " << b << " m = " << m << " n = " << n 	<< std::endl
-                    <<  " " << uAM <<  " " << uAN <<  " " << uBM <<  " " << uBN
-                    << " U = " << uVec[i] << std::endl;
+                    <<  " " << uXX[0] <<  " " << uXX[1] <<  " " << uXX[2] <<  " " << uXX[3]
+                    << " U = " << (*v)[i] << std::endl;
                 log(Warning, str1.str());
             }
         }
     }
-
-    return uVec;
 }
 
 } //namespace GIMLI
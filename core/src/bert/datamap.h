@@ -27,7 +27,9 @@
 namespace GIMLI{
 
 /*! Potential matrix for BERT.
-Stores the potential values for every current injection at every electrode positions. Filtering a specific data configuration is done by the \ref data call. In generall, the map size is equal to the amount of electrodes. There are exceptions: Dipol-Pattern sources, Dipol-Sources against a reference Electrode. */
+Stores the potential values for every current injection at every electrode positions. Filtering a specific data configuration is done by the \ref data call. In generall, the map size is equal to the amount of electrodes. There are exceptions: Dipol-Pattern sources, Dipol-Sources against a reference Electrode.
+
+The potentials are held in one contiguous row major block of rows() x cols() values. For complex valued maps the imaginary rows follow the real rows, i.e., rows() is twice the number of current injections. */
 class DLLEXPORT DataMap {
 public:
     /*! Default contructor, builds an empty map */
@@ -46,9 +48,20 @@ public:
     bool isComplex() const { return complex_; }
 
     /*! Save the collect matrix */
-    int save(const std::string & filename);
-
-    /*! Load a collect matrix */
+    int save(const std::string & filename) const;
+
+    /*! Save the collect matrix in a binary format, the values are stored
+     * unrounded as one little endian double block. \ref load detects the
+     * format from the file content.
+     *
+     * char[4] "GDMB", uint32 version (1)\n
+     * uint64 nElectrodes, rows, cols, isComplex\n
+     * double[3 * nElectrodes] electrode positions\n
+     * double[rows * cols] potentials row by row */
+    int saveBinary(const std::string & filename) const;
+
+    /*! Load a collect matrix, either the ascii format written by \ref save
+     * or the binary format written by \ref saveBinary. */
     int load(const std::string & filename);
 
     /*! Fill the map. Collect potential values from complete mesh related solution matrix
@@ -59,7 +72,13 @@ public:
     /*! Returns \ref RVector of power values corresponding to the \ref DataConatiner,
      * Return reciprocity values if reciprocity set to True.
      * In the case of reciprocity, a <-> m and b <-> n are swapped. */
-    RVector data(const DataContainerERT & dat, bool reciprocity=false, bool imag=false);
+    RVector data(const DataContainerERT & dat, bool reciprocity=false, bool imag=false) const;
+
+    /*! Fill u with the power values and uRez with the reciprocity values
+     * corresponding to the \ref DataContainerERT in one pass over the data.
+     * Same as the two calls data(dat, false, imag) and data(dat, true, imag). */
+    void data(const DataContainerERT & dat, RVector & u, RVector & uRez,
+              bool imag=false) const;
 
     /*! Set the electrode positions */
     inline void setElectrodes(const std::vector < RVector3 > & elecs){ elecs_ = elecs; }
@@ -67,18 +86,39 @@ public:
     /*! Return a reference to the electrode positions */
     inline const std::vector < RVector3 > & electrodes() const { return elecs_; }
 
-    /*! Return a reference to the potential matrix */
-    inline const RMatrix & map() const { return map_; }
+    /*! Return the number of rows of the potential matrix */
+    inline Index rows() const { return rows_; }
+
+    /*! Return the number of columns of the potential matrix */
+    inline Index cols() const { return cols_; }
+
+    /*! Return the potential of row i at column j */
+    inline double pot(Index i, Index j) const { return pot_[i * cols_ + j]; }
+
+    /*! Return the contiguous potential block, row by row */
+    inline const RVector & potentials() const { return pot_; }
+
+    /*! Return a copy of the potential matrix */
+    RMatrix map() const;
 
 protected:
     /*! Internal copy function */
     void copy_(const DataMap & map);
 
+    /*! Clear and resize the potential block */
+    void resize_(Index rows, Index cols);
+
+    /*! Fill u and/or uRez if not NULL, see \ref data. */
+    void gather_(const DataContainerERT & dat, RVector * u, RVector * uRez,
+                 bool imag) const;
+
     /*! Hold electrode positions */
     std::vector < RVector3 > elecs_;
 
     /*! Hold potential map */
-    RMatrix map_;
+    RVector pot_;
+    Index rows_;
+    Index cols_;
 
     bool complex_;
 };
@@ -29,10 +29,12 @@
 
 #include <interpolate.h>
 #include <linSolver.h>
+#include <mappedmatrix.h>
 #include <matrix.h>
 #include <memwatch.h>
 #include <mesh.h>
 #include <numericbase.h>
+#include <profiler.h>
 
 #include <regionManager.h>
 #include <shape.h>
@@ -709,6 +711,9 @@ void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass_(SparseMatrix
 }
 
 void DCMultiElectrodeModelling::updateMeshDependency_(){
+    //** attributes and markers are changed through attributeMesh_(), which
+    //** keeps the mesh shared with the region manager
+
     if (subSolutions_) subSolutions_->clear();
 
     for_each(electrodes_.begin(), electrodes_.end(), deletePtr());
@@ -1084,6 +1089,7 @@ RVector DCMultiElectrodeModelling::createDefaultStartModel(){
 
 RVector DCMultiElectrodeModelling::response(const RVector & model,
                                             double background){
+    GIMLI_PROFILE_ZONE("DCMultiElectrodeModelling::response");
 
     if (min(abs(dataContainer_->get("k"))) < TOLERANCE){
         if (!(this->topography() || buildCompleteElectrodeModel_)){
@@ -1137,8 +1143,10 @@ RVector DCMultiElectrodeModelling::response(const RVector & model,
     }
 
     DataMap dMap(response_(model, background));
-    RVector resp(round(dMap.data(this->dataContainer()), 1e-10));
-    RVector respRez(round(dMap.data(this->dataContainer(), true), 1e-10));
+    RVector resp, respRez;
+    dMap.data(this->dataContainer(), resp, respRez);
+    resp = round(resp, 1e-10);
+    respRez = round(respRez, 1e-10);
 
     if (resp.size() != dataContainer_->size() || respRez.size() != dataContainer_->size()){
         throwError(WHERE_AM_I + " size wrong: " + str(dataContainer_->size())
@@ -1168,10 +1176,12 @@ RVector DCMultiElectrodeModelling::response(const RVector & model,
                         std::cout << i << " " << resp[i] << " " << respRez[i]<< std::endl;
                         std::cout << a << " " << b << " " << m << " " << n << std::endl;
 
-                        mesh_->addData("ab-pot", prepExportPotentialData(ab));
-                        mesh_->addData("mn-pot", prepExportPotentialData(mn));
-                        //mesh_->addData("sens-mn-pot", prepExportSensitivityData(jacobian));
-                        mesh_->exportVTK("negResp");
+                        //** export a copy, the mesh may be shared
+                        Mesh negMesh(*mesh_);
+                        negMesh.addData("ab-pot", prepExportPotentialData(ab));
+                        negMesh.addData("mn-pot", prepExportPotentialData(mn));
+                        //negMesh.addData("sens-mn-pot", prepExportSensitivityData(jacobian));
+                        negMesh.exportVTK("negResp");
 
                         break;
                         //std::cout << (*dataContainer_)[i] << std::endl;
@@ -1198,20 +1208,20 @@ RVector DCMultiElectrodeModelling::response(const RVector & model,
 
 void DCMultiElectrodeModelling::mapERTModel(const CVector & model, Complex background){
     if (model.size() == this->mesh_->cellCount()){
-        setComplexResistivities(*mesh_, model);
+        setComplexResistivities(*this->attributeMesh_(), model);
     } else {
         RVector re(createMappedModel(real(model), background.real()));
         // RVector im(re*0.0);
         // log(Warning, "imag part forced to zero");
         RVector im(createMappedModel(imag(model), -9e99));
-        setComplexResistivities(*mesh_, toComplex(re, im));
+        setComplexResistivities(*this->attributeMesh_(), toComplex(re, im));
     }
 }
 
 void DCMultiElectrodeModelling::mapERTModel(const RVector & model,
                                             double background){
     if (model.size() == this->mesh_->cellCount()){
-        this->mesh_->setCellAttributes(model);
+        this->attributeMesh_()->setCellAttributes(model);
     } else {
         mapModel(model, background);
     }
@@ -1361,10 +1371,20 @@ void DCMultiElectrodeModelling::createJacobian_(const RVector & model,
                                    + str(end) + ".bmat",
                                    sensMatDropTol, start);
             } else { // no drop tol
-                RMatrix Jcluster("sensPart_" + str(start) + "-" + str(end));
+                //** only map the part, J holds the values already
+                RMappedMatrix Jcluster("sensPart_" + str(start) + "-"
+                                       + str(end) + MATRIXBINSUFFIX);
+                if (Jcluster.rows() != J->rows() || Jcluster.cols() != end - start
+                    || end > J->cols()){
+                    throwError(WHERE_AM_I + " sensitivity cluster [" + str(start)
+                               + ", " + str(end) + ") has size " + str(Jcluster.rows())
+                               + " x " + str(Jcluster.cols()) + ", expected "
+                               + str(J->rows()) + " x " + str(end - start) + ".");
+                }
 
                 for (Index i = 0; i < J->rows(); i ++){
-                    (*J)[i].setVal(Jcluster[i], start, end);
+                    std::memcpy(&(*J)[i][start], Jcluster.rowData(i),
+                                (end - start) * sizeof(double));
                 }
             }
 // MEMINFO
@@ -1444,6 +1464,7 @@ void DCMultiElectrodeModelling::createJacobian_(const CVector & model,
 }
 
 void DCMultiElectrodeModelling::createJacobian(const RVector & model){
+    GIMLI_PROFILE_ZONE("DCMultiElectrodeModelling::createJacobian");
     if (complex_){
         CVector cMod(toComplex(model(0, model.size()/2),
                                model(model.size()/2, model.size())));
@@ -1538,6 +1559,7 @@ RVector DCMultiElectrodeModelling::calcGeometricFactor(const DataContainerERT &
 
     if (primDataMap_->electrodes().size() != electrodes_.size()){
         if (verbose_) std::cout << " (numerical)" << std::endl;
+        this->attributeMesh_();
         RVector atts(mesh_->cellAttributes());
         if (nModel > 0) {
             this->mapERTModel(RVector(nModel, 1.0), -9e99);
@@ -1668,6 +1690,7 @@ class CalculateMT{
 
 void DCMultiElectrodeModelling::calculate(const std::vector < ElectrodeShape * > & eA,
                                           const std::vector < ElectrodeShape * > & eB){
+    GIMLI_PROFILE_ZONE("DCMultiElectrodeModelling::calculate");
 
     if (!subSolutions_) {
         subpotOwner_ = true;
@@ -1756,6 +1779,7 @@ template < class ValueType >
 void DCMultiElectrodeModelling::calculateK_(const std::vector < ElectrodeShape * > & eA,
                                             const std::vector < ElectrodeShape * > & eB,
                                             Matrix < ValueType > & solutionK, int kIdx){
+    GIMLI_PROFILE_ZONE("DCMultiElectrodeModelling::calculateK");
     bool debug = false;
     Stopwatch swatch(true);
 
@@ -2152,6 +2176,7 @@ void DCSRMultiElectrodeModelling::preCalculate(const std::vector < ElectrodeShap
 void DCSRMultiElectrodeModelling::calculateK(const std::vector < ElectrodeShape * > & eA,
                                              const std::vector < ElectrodeShape * > & eB,
                                              RMatrix & solutionK, int kIdx) {
+    GIMLI_PROFILE_ZONE("DCSRMultiElectrodeModelling::calculateK");
     bool debug = false;
     if (complex_){
         THROW_TO_IMPL
@@ -20,13 +20,11 @@
 #define _GIMLI_CALCULATE_MULTI_THREAD__H
 
 #include "gimli.h"
+#include "stopwatch.h"
+#include "threadpool.h"
 
-#ifdef USE_BOOST_THREAD
-    #include <boost/thread.hpp>
-#else
-    #include <mutex>
-    #include <thread>
-#endif
+#include <memory>
+#include <mutex>
 
 namespace GIMLI{
 
@@ -56,6 +54,28 @@ protected:
     Index end_;
     Index _threadNumber;
 };
+/*! Run calc for [0, nCalcs) on the \ref ThreadPool. Every thread works on
+ * its own copy of calc, the iterations of each chunk are set by setRange.
+ * Chunks are balanced between the threads by work stealing. */
+template < class T > void distributeCalc(T calc, const std::vector< Index > & bounds,
+                                         uint nThreads, bool verbose=false){
+    std::mutex calcMutex;
+    std::vector< std::unique_ptr< T > > calcObjs;
+
+    ThreadPool::instance().parallelFor(bounds,
+        [&](Index start, Index end, Index slot){
+            T * c = 0;
+            {
+                std::lock_guard< std::mutex > lock(calcMutex);
+                if (slot >= calcObjs.size()) calcObjs.resize(slot + 1);
+                if (!calcObjs[slot]) calcObjs[slot].reset(new T(calc));
+                c = calcObjs[slot].get();
+            }
+            c->setRange(start, end, slot);
+            (*c)();
+        }, nThreads);
+}
+
 template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, bool verbose=false){
     log(Debug, "Create distributed calculation of " + str(nCalcs) + " jobs on "
         + str(nThreads) + " threads for " + str(numberOfCPU()) + " CPU");
@@ -66,49 +86,13 @@ template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, boo
         calc();
         log(Debug, "time: " + str(swatch.duration()) + "s");
     } else {
-        uint singleCalcCount = (uint)ceil((double)nCalcs / (double)nThreads);
-
-        std::vector < T > calcObjs;
-        for (uint i = 0; i < nThreads; i ++){
-            calcObjs.push_back(calc);
-            Index start = singleCalcCount * i;
-            Index end   = min(singleCalcCount * (i + 1), nCalcs);
-            log(Debug, "Threaded calculation: #" + str(i) + ": " + str(start)  +" " + str(end));
-            calcObjs.back().setRange(start, end, i);
-            if (end >= nCalcs) break;
-        }
-#if USE_BOOST_THREAD
-        boost::thread_group threads;
-        for (uint i = 0; i < calcObjs.size(); i++) {
-            threads.create_thread(calcObjs[i]);
-        }
-        threads.join_all();
-#else
-
-        std::mutex iomutex;
-        std::vector<std::thread> threads(calcObjs.size());
-
-        for (uint i = 0; i < calcObjs.size(); i++) {
-            //threads.emplace_back(calcObjs[i]);
-            threads[i] = std::thread( [&iomutex, i, &calcObjs] {
-                // Stopwatch swatch(true);
-                {
-                    std::lock_guard<std::mutex> iolock(iomutex);
-                    //log(Debug, "Thread #" + str(i) + ": on CPU "
-                    //+ str(schedGetCPU()) + " slice " + str(calcObjs[i].start()) + ":" + str(calcObjs[i].end()));
-                }
-                calcObjs[i]();
-                {
-                    std::lock_guard<std::mutex> iolock(iomutex);
-                    // log(Debug, "time: #" + str(i) + " " + str(swatch.duration()) + "s");
-                }
-
-            });
-        }
-
-        for (auto & t: threads) if (t.joinable()) t.join();
-
-#endif
+        //** some chunks per thread, so idle threads can steal from busy ones
+        Index grain = max(Index(1), Index(nCalcs / (8 * max(1u, nThreads))));
+        std::vector< Index > bounds;
+        for (Index i = 0; i < nCalcs; i += grain) bounds.push_back(i);
+        bounds.push_back(nCalcs);
+
+        distributeCalc(calc, bounds, nThreads, verbose);
     }
 }
 
@@ -18,6 +18,7 @@
 
 #include "cholmodWrapper.h"
 #include "vector.h"
+#include "profiler.h"
 #include "sparsematrix.h"
 
 #if CHOLMOD_FOUND
@@ -202,6 +203,8 @@ int CHOLMODWrapper::initializeMatrix_(CSparseMatrix & S){
 
             // if (verbose_) std::cout << "Using umfpack .. " << std::endl;
 
+            GIMLI_PROFILE_ZONE("CHOLMODWrapper::factorize");
+            GIMLI_PROFILE_COUNT("factorizations", 1);
             umfpack_zi_symbolic (S.nRows(), S.nRows(), Ap_, Ai_, Ax_, Az_, &Symbolic, null, null) ;
             umfpack_zi_numeric (Ap_, Ai_, Ax_, Az_, Symbolic, &Numeric_, null, null) ;
             umfpack_zi_free_symbolic (&Symbolic);
@@ -280,6 +283,8 @@ int CHOLMODWrapper::initializeMatrix_(RSparseMatrix & S){
 
             // if (verbose_) std::cout << "Using umfpack .. " << std::endl;
             // beware transposed matrix here
+            GIMLI_PROFILE_ZONE("CHOLMODWrapper::factorize");
+            GIMLI_PROFILE_COUNT("factorizations", 1);
             Stopwatch sw;
             // __MS(sw.duration(true))
             (void) umfpack_di_symbolic(S.nCols(), S.nRows(), ApR_, AiR_, Ax_, &Symbolic, null, null) ;
@@ -356,6 +361,8 @@ int CHOLMODWrapper::factorise_(){
             // ((cholmod_common *)c_)->current=3;
 
 
+            GIMLI_PROFILE_ZONE("CHOLMODWrapper::factorize");
+            GIMLI_PROFILE_COUNT("factorizations", 1);
             L_ = cholmod_analyze((cholmod_sparse*)A_,
                                  (cholmod_common*)c_);		    /* analyze */
             // __MS(((cholmod_factor *)L_)->is_super)
@@ -424,6 +431,7 @@ template < class ValueType >
 void CHOLMODWrapper::solve(const RVector & rhs, RVector & solution){
     ASSERT_VEC_SIZE(rhs, this->dim_)
     ASSERT_VEC_SIZE(solution, this->dim_)
+    GIMLI_PROFILE_COUNT("solves", 1);
     if (!dummy_){
 
         if (useUmfpack_){
@@ -461,6 +469,7 @@ void CHOLMODWrapper::solve(const RVector & rhs, RVector & solution){
 void CHOLMODWrapper::solve(const CVector & rhs, CVector & solution){
     ASSERT_VEC_SIZE(rhs, this->dim_)
     ASSERT_VEC_SIZE(solution, this->dim_)
+    GIMLI_PROFILE_COUNT("solves", 1);
     if (!dummy_){
 
         if (useUmfpack_){
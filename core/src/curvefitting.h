@@ -119,6 +119,8 @@ public:
     PolynomialModelling(uint dim, uint nCoeffizient, const std::vector < RVector3 > & referencePoints,
                         const RVector & startModel);
 
+    virtual ModellingBase * clone() const { return new PolynomialModelling(*this); }
+
     virtual RVector response(const RVector & par);
 
     /*! Create starting model. The dimension is recognized here \n
@@ -22,6 +22,12 @@
 #include "pos.h"
 #include "numericbase.h"
 #include "vectortemplates.h"
+#include "mappedfile.h"
+#include "platform.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
 
 
 namespace GIMLI{
@@ -206,6 +212,133 @@ void DataContainer::setSensorPositions(const PosVector & sensors) {
     sensorPoints_ = sensors;
 }
 
+namespace {
+
+static const char DATABIN_MAGIC[4] = {'G', 'D', 'C', 'B'};
+
+typedef std::pair< const char *, const char * > Token_;
+
+//! Row reader for the unified data format.
+/*! Works on the whole (memory mapped) file and splits rows into tokens
+ * that point into the buffer, so no string is created per value.
+ * Rows are cut at the comment sign '#' and empty rows are skipped like
+ * getNonEmptyRow does. */
+class DataFileReader_ {
+public:
+    DataFileReader_(const MappedFile & mf)
+        : p_(mf.data()), end_(mf.data() + mf.size()){}
+
+    /*! Return the bounds of the next non empty row without comment.
+     * Returns false if the end of the file is reached. */
+    bool rowSpan(const char *& b, const char *& e){
+        while (p_ < end_){
+            const char * eol = static_cast< const char * >(
+                std::memchr(p_, '\n', end_ - p_));
+            if (!eol) eol = end_;
+            b = p_;
+            e = b;
+            while (e < eol && *e != '#') e ++;
+            p_ = eol < end_ ? eol + 1 : eol;
+
+            for (const char * c = b; c < e; c ++){
+                if (!isspace(*c)) return true;
+            }
+        }
+        return false;
+    }
+
+    /*! Split the span into tokens. */
+    static void tokenize(const char * c, const char * e, std::vector < Token_ > & tok){
+        tok.clear();
+        while (c < e){
+            while (c < e && isspace(*c)) c ++;
+            const char * b = c;
+            while (c < e && !isspace(*c)) c ++;
+            if (c > b) tok.push_back(Token_(b, c));
+        }
+    }
+
+    /*! Fill tok with the tokens of the next non empty row.
+     * Returns false if the end of the file is reached. */
+    bool row(std::vector < Token_ > & tok){
+        const char * b = NULL;
+        const char * e = NULL;
+        tok.clear();
+        if (!rowSpan(b, e)) return false;
+        tokenize(b, e, tok);
+        return true;
+    }
+
+    /*! If the next line starts with '#' consume it and return its tokens
+     * in format. */
+    bool formatLine(std::vector < std::string > & format){
+        if (p_ >= end_ || *p_ != '#') return false;
+        p_ ++;
+        std::vector < Token_ > tok;
+        const char * eol = p_;
+        while (eol < end_ && *eol != '\n') eol ++;
+        const char * e = p_;
+        while (e < eol && *e != '#') e ++;
+        format = getSubstrings(std::string(p_, e));
+        p_ = eol < end_ ? eol + 1 : eol;
+        return true;
+    }
+
+    static std::string str(const Token_ & t){ return std::string(t.first, t.second); }
+
+    /*! Convert the token like toDouble does, i.e., invalid input gives 0. */
+    static double toDouble(const Token_ & t){
+        //** fast path for plain integers, e.g., sensor indices
+        const char * c = t.first;
+        bool neg = (*c == '-');
+        if (neg || *c == '+') c ++;
+        if (c < t.second && t.second - c < 19){
+            int64 iv = 0;
+            const char * d = c;
+            while (d < t.second && *d >= '0' && *d <= '9') iv = iv * 10 + (*d++ - '0');
+            if (d == t.second) return neg ? -double(iv) : double(iv);
+        }
+        //** the mapped buffer is not null terminated
+        Index len = t.second - t.first;
+        if (len >= 64) return std::strtod(str(t).c_str(), NULL);
+        char buf[64];
+        std::memcpy(buf, t.first, len);
+        buf[len] = '\0';
+        return std::strtod(buf, NULL);
+    }
+
+protected:
+    const char * p_;
+    const char * end_;
+};
+
+/*! Return the column of a position token: 0, 1, 2 for x, y, z
+ * and the scale to meter in scale. -1 if unknown. */
+int positionColumn_(const std::string & f, double & scale){
+    scale = 1.0;
+    if (f == "x" || f == "X" || f == "x/m" || f == "X/m") return 0;
+    if (f == "y" || f == "Y" || f == "y/m" || f == "Y/m") return 1;
+    if (f == "z" || f == "Z" || f == "z/m" || f == "Z/m") return 2;
+    scale = 1.0 / 1000.0;
+    if (f == "x/mm" || f == "X/mm") return 0;
+    if (f == "y/mm" || f == "Y/mm") return 1;
+    if (f == "z/mm" || f == "Z/mm") return 2;
+    return -1;
+}
+
+template < class ValueType > void writeToFile_(std::fstream & file, const ValueType * v, Index n){
+    if (n > 0) file.write(reinterpret_cast< const char * >(v), n * sizeof(ValueType));
+}
+
+template < class ValueType > const ValueType * readFromMap_(const MappedFile & mf,
+                                                           Index & pos, Index n){
+    const ValueType * v = mf.at< ValueType >(pos, n);
+    pos += n * sizeof(ValueType);
+    return v;
+}
+
+} // namespace
+
 int DataContainer::load(const std::string & fileName,
                         bool sensorIndicesFromOne,
                         bool removeInvalid){
@@ -217,50 +350,54 @@ int DataContainer::load(const std::string & fileName,
     //std::setlocale(LC_NUMERIC, "C");
     // __MS(std::locale(LC_NUMERIC, "C"));
     // __MS(std::localeconv()->decimal_point[0]));
-                            
+
     clear();
     setSensorIndexOnFileFromOne(sensorIndicesFromOne);
 
-	std::fstream file; openInFile(fileName, & file, true);
+    MappedFile mf(fileName);
 
-    std::vector < std::string > row(getNonEmptyRow(file));
+    if (mf.size() >= 4 && std::memcmp(mf.data(), DATABIN_MAGIC, 4) == 0){
+        return loadBinary_(mf, removeInvalid);
+    }
+
+    DataFileReader_ file(mf);
+    std::vector < Token_ > row;
+    file.row(row);
 
     if (row.size() != 1){
         throwError(WHERE_AM_I + " cannot determine data format. " + str(row.size()));
     }
 
     //** read number of electrodes
-    int nSensors = toInt(row[0]);
+    int nSensors = toInt(DataFileReader_::str(row[0]));
     if (nSensors < 1){
-        throwError(" cannot determine sensor count " + row[0]);
+        throwError(" cannot determine sensor count " + DataFileReader_::str(row[0]));
     }
     RVector x(nSensors, 0.0), y(nSensors, 0.0), z(nSensors, 0.0);
+    RVector * xyz[3] = {&x, &y, &z};
 
     //** read electrodes format
     //** if no electrodes format is given (no x after comment symbol) take defaults
     std::string sensorFormatDefault("x y z");
     std::vector < std::string > format(getSubstrings(sensorFormatDefault));
-
-    char c; file.get(c);
-    if (c == '#') {
-        format = getRowSubstrings(file);
-//         if (format[0][0] != 'x' && format[0][0] != 'X'){
-//             format = getSubstrings(elecsFormatDefault);
-//         }
-    } else {
-        format = getSubstrings(sensorFormatDefault);
-    }
-    file.unget();
+    file.formatLine(format);
 
     inputFormatStringSensors_.clear();
     for (Index i = 0; i < format.size(); i ++)
         inputFormatStringSensors_ += format[i] + " ";
 
+    std::vector < int > posCol(format.size());
+    std::vector < double > posScale(format.size());
+    for (Index j = 0; j < format.size(); j ++){
+        posCol[j] = positionColumn_(format[j], posScale[j]);
+        if (posCol[j] < 0){
+            std::cerr << WHERE_AM_I << " Warning! format description unknown: format[" << j << "] = " << format[j] << " column ignored." << std::endl;
+        }
+    }
+
     //** read sensor
     for (int i = 0; i < nSensors; i ++){
-        row = getNonEmptyRow(file);
-
-        if (row.empty()){
+        if (!file.row(row)){
             throwError(
                        WHERE_AM_I + "To few sensor data. " +
                        str(nSensors) + " Sensors expected but " +
@@ -268,18 +405,9 @@ int DataContainer::load(const std::string & fileName,
         }
 
         for (Index j = 0; j < row.size(); j ++){
-
             if (j == format.size()) break; // no or to few format defined, ignore
-
-            if (format[j] == "x" || format[j] == "X" ||  format[j] == "x/m" || format[j] == "X/m") x[i] = toDouble(row[j]);
-            else if (format[j] == "x/mm" || format[j] == "X/mm") x[i] = toDouble(row[j]) / 1000.0;
-            else if (format[j] == "y" || format[j] == "Y" ||  format[j] == "y/m" || format[j] == "Y/m" ) y[i] = toDouble(row[j]);
-            else if (format[j] == "y/mm" || format[j] == "Y/mm") y[i] = toDouble(row[j]) / 1000.0;
-            else if (format[j] == "z" || format[j] == "Z" ||  format[j] == "z/m" || format[j] == "Z/m" ) z[i] = toDouble(row[j]);
-            else if (format[j] == "z/mm" || format[j] == "z/mm") z[i] = toDouble(row[j]) / 1000.0;
-            else {
-                std::cerr << WHERE_AM_I << " Warning! format description unknown: format[" << j << "] = " << format[j] << " column ignored." << std::endl;
-            }
+            if (posCol[j] < 0) continue;
+            (*xyz[posCol[j]])[i] = DataFileReader_::toDouble(row[j]) * posScale[j];
         }
     }
 
@@ -289,7 +417,7 @@ int DataContainer::load(const std::string & fileName,
         Index s = createSensor(RVector3(x[i], y[i], z[i]).round(1e-12));
 
         if (this->sensorCount() != oldCount+1){
-            duplicatedSensors.insert(duplicatedSensors.end(), 
+            duplicatedSensors.insert(duplicatedSensors.end(),
                                      std::pair< Index, Index >(this->sensorCount(), s));
             log(Warning, "Duplicated sensor position found at: " + str(RVector3(x[i], y[i], z[i])));
             //** we add them temporary and delete them later as unused
@@ -297,58 +425,70 @@ int DataContainer::load(const std::string & fileName,
         }
     }
     //****************************** Start read the data;
-    row = getNonEmptyRow(file);
+    file.row(row);
     if (row.size() != 1) {
         for (Index i = 0; i < row.size(); i ++){
-            std::cerr << row[i] << " ";
+            std::cerr << DataFileReader_::str(row[i]) << " ";
         }
         std::cerr << std::endl;
 
         throwError(WHERE_AM_I + " cannot determine data size. " + str(row.size()));
     }
 
-    int nData = toInt(row[0]);
-
-    //bool fromOne    = true;
-    //bool schemeOnly = false;
+    int nData = toInt(DataFileReader_::str(row[0]));
 
     if (nData > 0){
         this->resize(nData);
 
         //** looking for # symbol which start format description section
-        file.get(c);
-        if (c == '#') {
-            format = getRowSubstrings(file);
+        if (file.formatLine(format)){
             if (format.size() == 0){
                 throwError(WHERE_AM_I + "Can not determine data format.");
             }
-//            if (format.size() == 4) schemeOnly = true;
         }
-        file.unget();
-
     }
 
-    std::map< std::string, RVector > tmpMap;
-
+    //** find the rows first, then convert them in parallel
+    std::vector < Token_ > rows(nData);
     for (int data = 0; data < nData; data ++){
-        row = getNonEmptyRow(file);
-
-        if (row.empty()){
+        if (!file.rowSpan(rows[data].first, rows[data].second)){
             throwError(
                        WHERE_AM_I + " To few data. " + str(nData) +
                        " data expected and " + str(data) + " data found.");
         }
+    }
 
-        for (Index j = 0; j < row.size(); j ++){
-            if (j == format.size()) break;
+    std::map< std::string, RVector > tmpMap;
+    std::vector < RVector * > cols(format.size(), NULL);
+    for (Index j = 0; j < format.size(); j ++){
+        if (!tmpMap.count(format[j])){
+            tmpMap.insert(std::pair< std::string, RVector > (format[j], RVector(nData, 0.0))) ;
+        }
+        cols[j] = &tmpMap[format[j]];
+    }
 
-            if (!tmpMap.count(format[j])){
-                tmpMap.insert(std::pair< std::string, RVector > (format[j], RVector(nData, 0.0))) ;
+    Index maxCols = 0;
+#pragma omp parallel if (useOMP() && nData > 10000)
+    {
+        std::vector < Token_ > tok;
+        Index maxColsT = 0;
+#pragma omp for schedule(static)
+        for (int data = 0; data < nData; data ++){
+            DataFileReader_::tokenize(rows[data].first, rows[data].second, tok);
+            Index n = std::min(tok.size(), format.size());
+            for (Index j = 0; j < n; j ++){
+                (*cols[j])[data] = DataFileReader_::toDouble(tok[j]);
             }
-// 	    std::cout << format[j] << " " << tmpMap[format[j]].size() << std::endl;
-// 	    std::cout << row[j] << " " << toDouble(row[j]) << std::endl;
-            tmpMap[format[j]][data] = toDouble(row[j]);
+            maxColsT = std::max(maxColsT, n);
         }
+#pragma omp critical
+        maxCols = std::max(maxCols, maxColsT);
+    }
+    //** fields that are not present in any row are not created
+    for (Index j = maxCols; j < format.size(); j ++){
+        bool used = false;
+        for (Index k = 0; k < maxCols; k ++) used = used || (format[k] == format[j]);
+        if (!used) tmpMap.erase(format[j]);
     }
 
     //** renaming formats with the token translator (tT_):
@@ -367,12 +507,8 @@ int DataContainer::load(const std::string & fileName,
                 scale = 1.0 / 100.0;
             }
 
-// 	    std::cout << min(it->second) <<  " " << max(it->second) << std::endl;
-
-//std::cout << "Insert translated:-" << tT_[it->first] << "-" << it->second.size() << std::endl;
             dataMap_[translateAlias(it->first)] = it->second * scale;
         } else {
-//std::cout << "Insert:-" <<  it->first << "-" << it->second.size() << std::endl;
             dataMap_[it->first] = it->second;
         }
     }
@@ -419,11 +555,11 @@ int DataContainer::load(const std::string & fileName,
     this->checkDataValidity(removeInvalid);
 
     //** start read topography;
-    row = getNonEmptyRow(file);
+    file.row(row);
 
     if (row.size() == 1) {
         //** we found topography
-        Index nTopoPoints = toInt(row[0]);
+        Index nTopoPoints = toInt(DataFileReader_::str(row[0]));
 
         if (nTopoPoints > 0){
 
@@ -431,22 +567,16 @@ int DataContainer::load(const std::string & fileName,
 
             std::string topoFormatDefault("x y z");
 
-            file.get(c);
-            if (c == '#') {
-                format = getRowSubstrings(file);
-                if (format[0] != "x" && format[0] != "X"){
+            if (file.formatLine(format)){
+                if (format.size() == 0 || (format[0] != "x" && format[0] != "X")){
                     //** if no electrodes format is given (no x after comment symbol) take defaults;
                     format = getSubstrings(topoFormatDefault);
                 }
-            } else {
-                file.unget();
             }
 
             //** read topography points;
             for (Index i = 0; i < nTopoPoints; i ++){
-                row = getNonEmptyRow(file);
-
-                if (row.empty()) {
+                if (!file.row(row)) {
                     throwError(WHERE_AM_I
                             + "To few topo data. " + str(nTopoPoints)
                             + " Topopoints expected and " + str(i) + " found.");
@@ -454,10 +584,9 @@ int DataContainer::load(const std::string & fileName,
 
                 for (Index j = 0; j < row.size(); j ++){
                     if (j == format.size()) break; // no or to few format defined, ignore
-        //__MS(j << " "<< format[j]<< " " << row[j] )
-                    if (     format[j] == "x" || format[j] == "X") xt[i] = toDouble(row[j]);
-                    else if (format[j] == "y" || format[j] == "Y") yt[i] = toDouble(row[j]);
-                    else if (format[j] == "z" || format[j] == "Z") zt[i] = toDouble(row[j]);
+                    if (     format[j] == "x" || format[j] == "X") xt[i] = DataFileReader_::toDouble(row[j]);
+                    else if (format[j] == "y" || format[j] == "Y") yt[i] = DataFileReader_::toDouble(row[j]);
+                    else if (format[j] == "z" || format[j] == "Z") zt[i] = DataFileReader_::toDouble(row[j]);
                     else {
                         std::stringstream str;
                         str << " Warning! format description unknown: topo electrode format["
@@ -473,6 +602,109 @@ int DataContainer::load(const std::string & fileName,
         } // if nTopo > 0
     } // if topo
 
+    return 1;
+}
+
+int DataContainer::loadBinary_(const MappedFile & mf, bool removeInvalid){
+    Index pos = 4;
+    uint32 version = *readFromMap_< uint32 >(mf, pos, 1);
+    if (version != 1 && version != 2){
+        throwError(WHERE_AM_I + " " + mf.fileName() + ": unknown version " + str(version));
+    }
+    const uint64 * counts = readFromMap_< uint64 >(mf, pos, 4);
+    Index nSensors = counts[0];
+    Index nData = counts[1];
+    Index nTokens = counts[2];
+    Index nTopo = counts[3];
+
+    if (version > 1){
+        const uint64 * head = readFromMap_< uint64 >(mf, pos, 2);
+        sensorIndexOnFileFromOne_ = head[0] != 0;
+        const char * format = readFromMap_< char >(mf, pos, head[1]);
+        inputFormatStringSensors_.assign(format, head[1]);
+        pos = (pos + 7) & ~Index(7);
+    }
+
+    const double * sensors = readFromMap_< double >(mf, pos, 3 * nSensors);
+    sensorPoints_.resize(nSensors);
+    for (Index i = 0; i < nSensors; i ++){
+        sensorPoints_[i] = RVector3(sensors[3 * i], sensors[3 * i + 1], sensors[3 * i + 2]);
+    }
+
+    const double * topo = readFromMap_< double >(mf, pos, 3 * nTopo);
+    for (Index i = 0; i < nTopo; i ++){
+        topoPoints_.push_back(RVector3(topo[3 * i], topo[3 * i + 1], topo[3 * i + 2]));
+    }
+
+    inputFormatString_.clear();
+    for (Index i = 0; i < nTokens; i ++){
+        const uint64 * head = readFromMap_< uint64 >(mf, pos, 2);
+        Index nameLen = head[0];
+        bool isSensorIdx = head[1] != 0;
+        const char * name = readFromMap_< char >(mf, pos, nameLen);
+        std::string token(name, nameLen);
+        pos = (pos + 7) & ~Index(7);
+
+        const double * v = readFromMap_< double >(mf, pos, nData);
+        RVector vec(nData);
+        if (nData > 0) std::memcpy(&vec[0], v, nData * sizeof(double));
+        dataMap_[token] = vec;
+
+        if (isSensorIdx) registerSensorIndex(token);
+        if (token != "valid") inputFormatString_ += token + " ";
+    }
+    if (!dataMap_.count("valid")) dataMap_["valid"] = RVector(nData, 1.0);
+
+    this->checkDataValidity(removeInvalid);
+    return 1;
+}
+
+int DataContainer::saveBinary(const std::string & fileName) const {
+    std::fstream file;
+    if (!openFile(fileName, &file, std::ios::out | std::ios::binary, true)) return 0;
+
+    Index nData = this->size();
+    file.write(DATABIN_MAGIC, 4);
+    uint32 version = 2;
+    writeToFile_(file, &version, 1);
+    uint64 counts[4] = {sensorPoints_.size(), nData, dataMap_.size(), topoPoints_.size()};
+    writeToFile_(file, counts, 4);
+
+    uint64 zero = 0;
+    uint64 head[2] = {sensorIndexOnFileFromOne_ ? 1u : 0u,
+                      inputFormatStringSensors_.length()};
+    writeToFile_(file, head, 2);
+    writeToFile_(file, inputFormatStringSensors_.c_str(), head[1]);
+    file.write(reinterpret_cast< const char * >(&zero),
+               ((head[1] + 7) & ~Index(7)) - head[1]);
+
+    std::vector < double > p(3 * sensorPoints_.size());
+    for (Index i = 0; i < sensorPoints_.size(); i ++){
+        for (Index j = 0; j < 3; j ++) p[3 * i + j] = sensorPoints_[i][j];
+    }
+    writeToFile_(file, p.data(), p.size());
+
+    p.resize(3 * topoPoints_.size());
+    for (Index i = 0; i < topoPoints_.size(); i ++){
+        for (Index j = 0; j < 3; j ++) p[3 * i + j] = topoPoints_[i][j];
+    }
+    writeToFile_(file, p.data(), p.size());
+
+    for (auto & it: dataMap_){
+        if (it.second.size() != nData){
+            throwError(WHERE_AM_I + " data size mismatch for " + it.first);
+        }
+        uint64 head[2] = {it.first.length(), isSensorIndex(it.first) ? 1u : 0u};
+        writeToFile_(file, head, 2);
+        writeToFile_(file, it.first.c_str(), it.first.length());
+        Index nPad = ((it.first.length() + 7) & ~Index(7)) - it.first.length();
+        file.write(reinterpret_cast< const char * >(&zero), nPad);
+        if (nData > 0) writeToFile_(file, &it.second[0], nData);
+    }
+
+    if (!file.good()){
+        throwError(WHERE_AM_I + " error while writing " + fileName);
+    }
     file.close();
     return 1;
 }
@@ -595,24 +827,43 @@ int DataContainer::write(std::fstream & file,
         }
     }
 
-    for (Index i = 0; i < toSaveIdx.size(); i ++){
-        file.setf(std::ios::scientific, std::ios::floatfield);
-        file.precision(14);
-
-        for (Index j = 0; j < token.size(); j ++){
-
-            if (outInt[j]){
-                file << int((*outVec[j])[toSaveIdx[i]]) + sensorIndexOnFileFromOne_;
-            } else {
-                 if (token[j] == "valid"){
-                    file << int((*outVec[j])[toSaveIdx[i]]);
-                 } else {
-                    file << (*outVec[j])[toSaveIdx[i]];
-                 }
+    for (Index j = 0; j < token.size(); j ++){
+        if (token[j] == "valid") outInt[j] = true;
+    }
+    int idxOffset = sensorIndexOnFileFromOne_;
+
+    //** format rows into buffers, same output as stream with
+    //** std::scientific and precision 14 but without stream overhead.
+    //** Blocks of rows are formatted in parallel and written in order.
+    const Index blockSize = 20000;
+    Index nBlocks = (toSaveIdx.size() + blockSize - 1) / blockSize;
+    Index nBatch = std::max(Index(1), Index(numberOfCPU()));
+    std::vector < std::string > buf(nBatch);
+
+    for (Index batch = 0; batch < nBlocks; batch += nBatch){
+        Index nb = std::min(nBatch, nBlocks - batch);
+#pragma omp parallel for schedule(dynamic) if (useOMP() && nb > 1)
+        for (Index k = 0; k < nb; k ++){
+            std::string & b = buf[k];
+            b.clear();
+            char val[64];
+            Index start = (batch + k) * blockSize;
+            Index end = std::min(start + blockSize, Index(toSaveIdx.size()));
+            for (Index i = start; i < end; i ++){
+                for (Index j = 0; j < token.size(); j ++){
+                    double v = (*outVec[j])[toSaveIdx[i]];
+                    int len = 0;
+                    if (outInt[j]){
+                        len = snprintf(val, 64, "%d", int(v) + (token[j] == "valid" ? 0 : idxOffset));
+                    } else {
+                        len = snprintf(val, 64, "%.14e", v);
+                    }
+                    b.append(val, len);
+                    b += (j < token.size() -1) ? '\t' : '\n';
+                }
             }
-            if (j < token.size() -1) file << "\t";
         }
-        file << std::endl;
+        for (Index k = 0; k < nb; k ++) file.write(buf[k].data(), buf[k].size());
     }
 
     //** START write additional points
@@ -305,6 +305,21 @@ public:
                     bool verbose=false) const {
         return save(fileName, formatData, "x y z", noFilter, verbose); }
 
+    /*! Save the data in a columnar binary format: sensor positions,
+     * additional points and every data field (including invalid data) as
+     * contiguous little endian double block. \ref load detects the format
+     * from the file content.
+     *
+     * char[4] "GDCB", uint32 version (2)\n
+     * uint64 nSensors, nData, nTokens, nTopoPoints\n
+     * uint64 sensorIndexOnFileFromOne, uint64 length of the sensor format
+     * string, char[] sensor format string padded to 8 byte\n
+     * double[3 * nSensors] sensor positions\n
+     * double[3 * nTopoPoints] additional points\n
+     * nTokens times: uint64 token length, uint64 isSensorIndex,
+     * char[] token padded to 8 byte, double[nData] values */
+    int saveBinary(const std::string & fileName) const;
+
     virtual int write(std::fstream & os,
                      const std::string & fmtData,
                      const std::string & fmtSensor,
@@ -416,6 +431,9 @@ public:
 protected:
     virtual void copy_(const DataContainer & data);
 
+    /*! Load the binary format written by \ref saveBinary. */
+    int loadBinary_(const MappedFile & mf, bool removeInvalid);
+
     std::string inputFormatStringSensors_;
 
     std::string inputFormatString_;
@@ -22,6 +22,8 @@
 #include "dc1dmodelling.h"
 #include "meshgenerators.h"
 
+#include <algorithm>
+
 namespace GIMLI {
 
 DC1dModelling::DC1dModelling(size_t nlayers,
@@ -79,8 +81,8 @@ RVector DC1dModelling::createDefaultStartModel() {
     return mod;
 }
 
-RVector DC1dModelling::response(const RVector & model) {
-
+void DC1dModelling::splitModel_(const RVector & model,
+                                RVector & rho, RVector & thk) const {
     if (model.size() < (nlayers_ * 2 - 1)){
         throwError(WHERE_AM_I + " model vector to small: nlayers_ * 2 - 1 = " + str(nlayers_ * 2 - 1) + " > " + str(model.size()));
     }
@@ -88,18 +90,106 @@ RVector DC1dModelling::response(const RVector & model) {
         throwError(WHERE_AM_I + " model vector to large: nlayers_ * 2 - 1 = " + str(nlayers_ * 2 - 1) + " < " + str(model.size()));
     }
 
-    RVector rho(nlayers_);
-    RVector thk(nlayers_ - 1);
+    rho.resize(nlayers_);
+    thk.resize(nlayers_ - 1);
     for (size_t i = 0 ; i < nlayers_ -1 ; i++) thk[i] = model[i];
     for (size_t i = 0 ; i < nlayers_ ; i++) rho[i] = model[nlayers_ + i -1];
+}
+
+RVector DC1dModelling::response(const RVector & model) {
+    RVector rho, thk;
+    splitModel_(model, rho, thk);
     return rhoa(rho, thk);
 }
 
+void DC1dModelling::createJacobian(const RVector & model) {
+    RVector rho, thk;
+    splitModel_(model, rho, thk);
+
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+    rhoa(rho, thk, *J);
+}
+
+void DC1dRhoModelling::createJacobian(const RVector & rho) {
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+
+    RMatrix JFull;
+    rhoa(rho, thk_, JFull);
+    Index nThk = thk_.size();
+    J->resize(JFull.rows(), rho.size());
+    for (Index i = 0; i < JFull.rows(); i ++){
+        (*J)[i] = JFull[i](nThk, nThk + rho.size());
+    }
+}
+
+//** positions of the electrode distances in the sorted unique distances
+static void uniqueDistances_(const RVector & am, const RVector & an,
+                             const RVector & bm, const RVector & bn,
+                             RVector & r, IndexArray & idx){
+    Index nData = am.size();
+    std::vector< double > d(4 * nData);
+    for (Index i = 0; i < nData; i ++){
+        d[i]             = std::fabs(am[i]);
+        d[i + nData]     = std::fabs(an[i]);
+        d[i + 2 * nData] = std::fabs(bm[i]);
+        d[i + 3 * nData] = std::fabs(bn[i]);
+    }
+    std::vector< double > u(d);
+    std::sort(u.begin(), u.end());
+    u.erase(std::unique(u.begin(), u.end()), u.end());
+
+    r.resize(u.size());
+    for (Index i = 0; i < u.size(); i ++) r[i] = u[i];
+    idx.resize(d.size());
+    for (Index i = 0; i < d.size(); i ++){
+        idx[i] = std::lower_bound(u.begin(), u.end(), d[i]) - u.begin();
+    }
+}
+
 RVector DC1dModelling::rhoa(const RVector & rho, const RVector & thk) {
-    tmp_ = pot1d(am_, rho, thk);
-    tmp_ -= pot1d(an_, rho, thk);
-    tmp_ -= pot1d(bm_, rho, thk);
-    tmp_ += pot1d(bn_, rho, thk);
+    RVector r, pot;
+    IndexArray idx;
+    uniqueDistances_(am_, an_, bm_, bn_, r, idx);
+    pot1dBatch_(r, rho, thk, pot);
+
+    Index nData = am_.size();
+    tmp_.resize(nData);
+    for (Index i = 0; i < nData; i ++){
+        tmp_[i] = pot[idx[i]] - pot[idx[i + nData]]
+                - pot[idx[i + 2 * nData]] + pot[idx[i + 3 * nData]];
+    }
+    return tmp_ * k_ + rho[0];
+}
+
+RVector DC1dModelling::rhoa(const RVector & rho, const RVector & thk,
+                            RMatrix & J) {
+    RVector r, pot;
+    RMatrix dPot;
+    IndexArray idx;
+    uniqueDistances_(am_, an_, bm_, bn_, r, idx);
+    pot1dBatch_(r, rho, thk, pot, &dPot);
+
+    Index nData = am_.size();
+    Index nThk = thk.size();
+    J.resize(nData, nThk + rho.size());
+    tmp_.resize(nData);
+    for (Index i = 0; i < nData; i ++){
+        const RVector & dA = dPot[idx[i]];
+        const RVector & dN = dPot[idx[i + nData]];
+        const RVector & dM = dPot[idx[i + 2 * nData]];
+        const RVector & dB = dPot[idx[i + 3 * nData]];
+        RVector & Ji = J[i];
+        for (Index j = 0; j < Ji.size(); j ++){
+            Ji[j] = k_[i] * (dA[j] - dN[j] - dM[j] + dB[j]);
+        }
+        Ji[nThk] += 1.0;
+        tmp_[i] = pot[idx[i]] - pot[idx[i + nData]]
+                - pot[idx[i + 2 * nData]] + pot[idx[i + 3 * nData]];
+    }
     return tmp_ * k_ + rho[0];
 }
 
@@ -120,15 +210,125 @@ RVector DC1dModelling::kern1d(const RVector & lam, const RVector & rho, const RV
 }
 
 RVector DC1dModelling::pot1d(const RVector & R, const RVector & rho, const RVector & thk) {
-    RVector z0(R.size());
-    double rabs;
-    for (size_t i = 0; i < R.size(); i++) {
-        rabs = std::fabs(R[i]);
-        z0[i] = sum(myw_ * kern1d(myx_ / rabs, rho, thk) * 2.0) / rabs;
-    }
+    RVector z0;
+    pot1dBatch_(R, rho, thk, z0);
     return z0;
 }
 
+void DC1dModelling::pot1dBatch_(const RVector & R, const RVector & rho,
+                                const RVector & thk, RVector & pot,
+                                RMatrix * dPot) const {
+    Index nLay = rho.size();
+    Index nFil = myx_.size();
+    Index nR = R.size();
+    Index n = nFil * nR;
+    Index nThk = nLay - 1;
+
+    pot.resize(nR);
+    pot.fill(0.0);
+    if (dPot) {
+        dPot->resize(nR, nThk + nLay);
+        for (Index i = 0; i < nR; i ++) (*dPot)[i].fill(0.0);
+    }
+    if (nLay < 2) return; //** homogeneous halfspace, no secondary potential
+    if (thk.size() < nThk){
+        throwError(WHERE_AM_I + " not enough thicknesses " + str(thk.size()));
+    }
+
+    std::vector< double > lam(n);
+    for (Index i = 0; i < nR; i ++){
+        double rabs = std::fabs(R[i]);
+        for (Index k = 0; k < nFil; k ++) lam[i * nFil + k] = myx_[k] / rabs;
+    }
+
+    //** layer recursion from the bottom to layer 1 for all abscissae,
+    //** z and tanh are kept per layer for the derivatives
+    std::vector< double > z(n, rho[nLay - 1]);
+    std::vector< double > zs, ts;
+    if (dPot){
+        zs.resize(n * nLay);
+        ts.resize(n * nLay);
+    }
+    for (Index i = nLay - 2; i >= 1; i --){
+        double r = rho[i];
+        double h = thk[i];
+        double * zi = dPot ? &zs[i * n] : 0;
+        double * ti = dPot ? &ts[i * n] : 0;
+        for (Index j = 0; j < n; j ++){
+            double t = std::tanh(lam[j] * h);
+            if (dPot){
+                zi[j] = z[j];
+                ti[j] = t;
+            }
+            z[j] = r * (z[j] + t * r) / (z[j] * t + r);
+        }
+    }
+
+    //** kernel and its derivatives for the top layer
+    double rho0 = rho[0];
+    double h0 = thk[0];
+    std::vector< double > K(n), a, dK0, dH0;
+    if (dPot){
+        a.resize(n);
+        dK0.resize(n);
+        dH0.resize(n);
+    }
+    for (Index j = 0; j < n; j ++){
+        double s = z[j] + rho0;
+        double p = (z[j] - rho0) / s;
+        double E = std::exp(-2.0 * lam[j] * h0);
+        double e = E * p;
+        K[j] = e / (1.0 - e) * rho0 / 2.0 / PI;
+        if (dPot){
+            double dKde = rho0 / 2.0 / PI / ((1.0 - e) * (1.0 - e));
+            double gp = dKde * E;
+            dH0[j] = -2.0 * lam[j] * e * dKde;
+            dK0[j] = -2.0 * z[j] / (s * s) * gp + e / (1.0 - e) / 2.0 / PI;
+            a[j]   = 2.0 * rho0 / (s * s) * gp;
+        }
+    }
+
+    //** weighted filter sum per distance
+    auto filter = [&](const std::vector< double > & v, Index i) -> double {
+        const double * vi = &v[i * nFil];
+        double sum = 0.0;
+        for (Index k = 0; k < nFil; k ++) sum += myw_[k] * vi[k] * 2.0;
+        return sum / std::fabs(R[i]);
+    };
+
+    for (Index i = 0; i < nR; i ++) pot[i] = filter(K, i);
+    if (!dPot) return;
+
+    RMatrix & dP = *dPot;
+    for (Index i = 0; i < nR; i ++){
+        dP[i][0]    = filter(dH0, i);
+        dP[i][nThk] = filter(dK0, i);
+    }
+
+    //** back through the recursion, a is dK/dz of the current layer
+    std::vector< double > dR(n), dH(n);
+    for (Index l = 1; l < nLay - 1; l ++){
+        double r = rho[l];
+        const double * zl = &zs[l * n];
+        const double * tl = &ts[l * n];
+        for (Index j = 0; j < n; j ++){
+            double zz = zl[j];
+            double t = tl[j];
+            double D = zz * t + r;
+            double N = r * (zz + t * r);
+            double D2 = D * D;
+            dR[j] = a[j] * ((zz + 2.0 * t * r) * D - N) / D2;
+            dH[j] = a[j] * (r * r * D - N * zz) / D2 * lam[j] * (1.0 - t * t);
+            a[j] *= r * r * (1.0 - t * t) / D2;
+        }
+        for (Index i = 0; i < nR; i ++){
+            dP[i][l]        = filter(dH, i);
+            dP[i][nThk + l] = filter(dR, i);
+        }
+    }
+    for (Index i = 0; i < nR; i ++) dP[i][nThk + nLay - 1] = filter(a, i);
+}
+
 void DC1dModelling::init_() {
 
     double myx[801] = { 8.917099801327442e-14, 9.854919374005225e-14,
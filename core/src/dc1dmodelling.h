@@ -50,6 +50,8 @@ public:
 
     virtual ~DC1dModelling() { }
 
+    virtual ModellingBase * clone() const { return new DC1dModelling(*this); }
+
     /*! Returns an RVector of the 1dc response for
      * model = [thickness_ 0, ..., thickness_(n-1), rho_0 .. rho_n].
      * For n = nlayers. */
@@ -57,6 +59,14 @@ public:
 
     RVector rhoa(const RVector & rho, const RVector & thk);
 
+    /*! Apparent resistivity and its derivatives. J is resized to
+     * data x (2 * nlayers - 1) with the columns [thk, rho]. */
+    RVector rhoa(const RVector & rho, const RVector & thk, RMatrix & J);
+
+    /*! Analytic Jacobian for model = [thk, rho], derived through the same
+     * layer recursion as the response. */
+    virtual void createJacobian(const RVector & model);
+
     RVector kern1d(const RVector & lam, const RVector & rho, const RVector & h);
 
     RVector pot1d(const RVector & R, const RVector & rho, const RVector & thk);
@@ -111,6 +121,16 @@ protected:
 
     void postprocess_();
 
+    /*! Split model into thk and rho. */
+    void splitModel_(const RVector & model, RVector & rho, RVector & thk) const;
+
+    /*! Potentials for the distances r. The layer recursion is evaluated
+     * for all distances and filter abscissae at once in contiguous
+     * arrays. If dPot is given it gets the derivatives for [thk, rho]. */
+    void pot1dBatch_(const RVector & r, const RVector & rho,
+                     const RVector & thk, RVector & pot,
+                     RMatrix * dPot=0) const;
+
     size_t nlayers_;
     double meanrhoa_;
     RVector am_;
@@ -139,8 +159,15 @@ public:
 
     virtual ~DC1dModellingC() { }
 
+    virtual ModellingBase * clone() const { return new DC1dModellingC(*this); }
+
     /*! Return [|rhoa|, +phi(rad)] for [thicks, res, phi(rad)]*/
     RVector response(const RVector & model);
+
+    /*! No analytic Jacobian for complex resistivity, use brute force. */
+    void createJacobian(const RVector & model){
+        ModellingBase::createJacobian(model);
+    }
 };
 
 /*! DC1dRhoModelling - Variant of DC 1D modelling with fixed parameterization
@@ -169,8 +196,13 @@ public:
 
     virtual ~DC1dRhoModelling() { }
 
+    virtual ModellingBase * clone() const { return new DC1dRhoModelling(*this); }
+
     RVector response(const RVector & rho) {  return rhoa(rho, thk_); }
 
+    /*! Analytic Jacobian for the resistivities. */
+    virtual void createJacobian(const RVector & rho);
+
     RVector createDefaultStartModel() {
         return RVector(thk_.size() + 1, meanrhoa_);
     }
@@ -25,29 +25,131 @@
 
 namespace GIMLI {
 
-RVector MT1dModelling::rhoaphi(const RVector & rho, const RVector & thk) { // after mtmod.c by R.-U. B�rner
+//** Jacobian columns of the resistivities only, for fixed thicknesses
+static void rhoColumns_(const RMatrix & JFull, Index nThk, RMatrix & J){
+    Index nRho = JFull.cols() - nThk;
+    J.resize(JFull.rows(), nRho);
+    for (Index i = 0; i < JFull.rows(); i ++){
+        J[i] = JFull[i](nThk, nThk + nRho);
+    }
+}
+
+RVector MT1dModelling::rhoaphi(const RVector & rho, const RVector & thk) {
+    return rhoaphi_(rho, thk, 0);
+}
+
+RVector MT1dModelling::rhoaphi(const RVector & rho, const RVector & thk,
+                               RMatrix & J) {
+    return rhoaphi_(rho, thk, &J);
+}
+
+RVector MT1dModelling::rhoaphi_(const RVector & rho, const RVector & thk,
+                                RMatrix * J) { // after mtmod.c by R.-U. B�rner
     size_t nperiods = periods_.size();
+    size_t nl = rho.size();
     RVector rhoa(nperiods), phi(nperiods);
 
     RVector::ValType my0 = PI * 4e-7;
-    Complex i_unit(0.0 , 1.0), adm, alpha, tanalpha;
-    CVector z(nlay_);
+    Complex i_unit(0.0 , 1.0);
+
+    //** impedance recursion for all periods, layer by layer;
+    //** zs, adm, tanalpha and wavenumbers are kept for the derivatives
+    std::vector< Complex > z(nperiods);
+    std::vector< Complex > zs, adms, tas, ks;
+    if (J){
+        zs.resize(nl * nperiods);
+        adms.resize(nl * nperiods);
+        tas.resize(nl * nperiods);
+        ks.resize(nl * nperiods);
+    }
     for (size_t i = 0 ; i < nperiods ; i++) {
         RVector::ValType omega = 2.0 * PI / periods_[i];
-        z[nlay_ - 1] = sqrt(i_unit * omega * rho[nlay_ - 1] / my0);
-        for (int k = nlay_ - 2 ; k >= 0 ; k--) {
-            adm = sqrt(my0 / (rho[k] * i_unit * omega));
-            alpha = thk[k] * sqrt(i_unit * my0 * omega / rho[k]);
-            tanalpha = sinh(alpha) / cosh(alpha);
-            z[k] = (adm * z[k + 1] + tanalpha) / (adm * z[k + 1] * tanalpha + (RVector::ValType)1.0);
-            z[k] /= adm;
+        z[i] = sqrt(i_unit * omega * rho[nl - 1] / my0);
+    }
+    for (int k = nl - 2 ; k >= 0 ; k--) {
+        for (size_t i = 0 ; i < nperiods ; i++) {
+            RVector::ValType omega = 2.0 * PI / periods_[i];
+            Complex adm = sqrt(my0 / (rho[k] * i_unit * omega));
+            Complex wk = sqrt(i_unit * my0 * omega / rho[k]);
+            Complex tanalpha = std::tanh(thk[k] * wk);
+            if (J){
+                Index j = k * nperiods + i;
+                zs[j] = z[i];
+                adms[j] = adm;
+                tas[j] = tanalpha;
+                ks[j] = wk;
+            }
+            z[i] = (adm * z[i] + tanalpha) / (adm * z[i] * tanalpha + (RVector::ValType)1.0);
+            z[i] /= adm;
+        }
+    }
+    for (size_t i = 0 ; i < nperiods ; i++) {
+        RVector::ValType omega = 2.0 * PI / periods_[i];
+        rhoa[i] = abs(z[i]) * abs(z[i]) * my0 / omega;
+        phi[i] = std::atan(imag(z[i]) / real(z[i]));
+    }
+    if (!J) return cat(rhoa, phi);
+
+    //** back through the recursion, a is dz0/dz of the current layer
+    size_t nThk = nl - 1;
+    J->resize(2 * nperiods, nThk + nl);
+    for (size_t i = 0 ; i < nperiods ; i++) {
+        RVector::ValType omega = 2.0 * PI / periods_[i];
+        Complex z0 = z[i];
+        Complex a(1.0, 0.0);
+
+        auto setJ = [&](size_t col, const Complex & dz0){
+            (*J)[i][col] = 2.0 * real(conj(z0) * dz0) * my0 / omega;
+            (*J)[i + nperiods][col] = imag(dz0 / z0);
+        };
+
+        for (size_t k = 0 ; k < nThk ; k++) {
+            Index j = k * nperiods + i;
+            Complex zz = zs[j];
+            Complex A = adms[j];
+            Complex T = tas[j];
+            Complex Q = A * zz * T + 1.0;
+            Complex g = (A * zz + T) / Q;
+            Complex sech2 = 1.0 - T * T;
+
+            Complex dA = zz * sech2 / (Q * Q) / A - g / (A * A);
+            Complex dT = (1.0 - A * A * zz * zz) / (Q * Q) / A;
+            Complex dRho = (dA * (-A) - dT * sech2 * thk[k] * ks[j]) / (2.0 * rho[k]);
+            Complex dH = dT * sech2 * ks[j];
+
+            setJ(k, a * dH);
+            setJ(nThk + k, a * dRho);
+            a *= sech2 / (Q * Q);
         }
-        rhoa[i] = abs(z[0]) * abs(z[0]) * my0 / omega;
-        phi[i] = std::atan(imag(z[0]) / real(z[0]));
+        Complex zb = sqrt(i_unit * omega * rho[nl - 1] / my0);
+        setJ(nThk + nl - 1, a * zb / (2.0 * rho[nl - 1]));
     }
     return cat(rhoa, phi);
 }
 
+void MT1dModelling::createJacobian(const RVector & model) {
+    if (model.size() != nlay_ * 2 - 1) {
+        throwError(WHERE_AM_I + " model size " + str(model.size()) +
+                   " != " + str(nlay_ * 2 - 1));
+    }
+    RVector thk(model, 0, nlay_ - 1), rho(model, nlay_ - 1, 2 * nlay_ - 1);
+
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+    rhoaphi(rho, thk, *J);
+}
+
+void MT1dRhoModelling::createJacobian(const RVector & rho) {
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+
+    RMatrix JFull;
+    rhoaphi(rho, thk_, JFull);
+    rhoColumns_(JFull, thk_.size(), *J);
+}
+
 RVector MT1dModelling::rhoa(const RVector & model){ //! app. res. for thk/res vector
     if (model.size() != nlay_ * 2 - 1) {
 	__M
@@ -118,27 +220,8 @@ void FDEM1dModelling::init(){
     double zpq = (ze_ - zs_) * (ze_ - zs_);
     RVector rpq(coilspacing_ * coilspacing_ + zpq);
     freeAirSolution_ = (rpq - zpq * 3.0) / rpq / rpq / sqrt(rpq) / 4.0 / PI;
-}
-
-Complex btp(double u, double f, RVector rho, RVector d){
-    size_t nl = rho.size();
-    double mu0 = 4e-7 * PI;
-    Complex c(0.0, mu0 * 2. * PI * f);
-
-    Complex b(std::sqrt(c / rho[nl-1] + u*u));
-    if(nl > 1) {
-        for(int nn=nl-2; nn>=0 ; nn--){
-            Complex alpha(std::sqrt(c/rho[nn] + u*u));
-            Complex cth(std::exp(alpha * d[nn] * -2.0));
-            cth=(Complex(1.0) - cth) / (cth + 1.0);
-            b=(alpha * cth + b) / (cth * b / alpha + 1.0);
-        }
-    }
-    return b;
-}
 
-RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk){
-    double hankelJ0[100]={
+    static const double hankelJ0[100]={
         2.89878288E-07,3.64935144E-07,4.59426126E-07,5.78383226E-07,
         7.28141338E-07,9.16675639E-07,1.15402625E-06,1.45283298E-06,
         1.82900834E-06,2.30258511E-06,2.89878286E-06,3.64935148E-06,
@@ -165,25 +248,122 @@ RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk){
         1.56774609E-06,-9.89180896E-07,6.24130948E-07,-3.93800005E-07,
         2.48471005E-07,-1.56774605E-07,9.89180888E-08,-6.24130946E-08};
 
-    //** extract resistivity and thickness
-    RVector inph(nfr_), outph(nfr_);//** inphase and quadrature components
+    //** filter abscissae and weights for all frequencies, including
+    //** source/receiver heights and the normalization by the free air
+    //** solution in per cent
     int nc = 100, nc0 = 60; // number of coefficients
     RVector::ValType q=0.1*std::log(10.0);
+    u_.resize(nfr_ * nc);
+    w_.resize(nfr_ * nc);
     for (size_t i = 0 ; i < nfr_ ; i++) {
-        Complex aux(0.0, 0.0);
         for (int ii = 0 ; ii < nc ; ii++) {
             RVector::ValType ui=std::exp(q * (nc - ii - nc0)) / coilspacing_[i];
-            Complex bti(btp(ui, freqs_[i], rho, thk));
-            Complex delta((bti - ui) / (bti + ui) * std::exp(ui * ze_) * std::exp(ui * zs_));
-            aux += delta * ui * ui * hankelJ0[nc - ii - 1];
+            u_[i * nc + ii] = ui;
+            w_[i * nc + ii] = std::exp(ui * ze_) * std::exp(ui * zs_) * ui * ui
+                            * hankelJ0[nc - ii - 1] / (PI * 4.0 * coilspacing_[i])
+                            / freeAirSolution_[i] * 100.0;
         }
+    }
+}
+
+RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk){
+    return calc_(rho, thk, 0);
+}
+
+RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk,
+                              RMatrix & J){
+    return calc_(rho, thk, &J);
+}
+
+RVector FDEM1dModelling::calc_(const RVector & rho, const RVector & thk,
+                               RMatrix * J) const {
+    size_t nl = rho.size();
+    Index n = u_.size();
+    Index nc = n / max(nfr_, size_t(1));
+    double mu0 = 4e-7 * PI;
 
-        aux /= PI * 4.0 * coilspacing_[i];
-        // normalize by free air solution in per cent
-        inph[i]  = real(aux) / freeAirSolution_[i] * 100.0;
-        outph[i] = imag(aux) / freeAirSolution_[i] * 100.0;
+    //** propagation recursion from the bottom for all frequencies and
+    //** filter abscissae; b, alpha and tanh are kept for the derivatives
+    std::vector< Complex > c(nfr_), b(n), bs, alphas, cths;
+    for (size_t i = 0 ; i < nfr_ ; i++) c[i] = Complex(0.0, mu0 * 2. * PI * freqs_[i]);
+    for (Index j = 0; j < n; j ++){
+        b[j] = std::sqrt(c[j / nc] / rho[nl-1] + u_[j] * u_[j]);
+    }
+    if (J){
+        bs.resize(n * nl);
+        alphas.resize(n * nl);
+        cths.resize(n * nl);
+        for (Index j = 0; j < n; j ++) alphas[(nl - 1) * n + j] = b[j];
+    }
+    for (int nn = nl - 2; nn >= 0; nn--){
+        for (Index j = 0; j < n; j ++){
+            Complex alpha(std::sqrt(c[j / nc] / rho[nn] + u_[j] * u_[j]));
+            Complex cth(std::exp(alpha * thk[nn] * -2.0));
+            cth = (Complex(1.0) - cth) / (cth + 1.0);
+            if (J){
+                bs[nn * n + j] = b[j];
+                alphas[nn * n + j] = alpha;
+                cths[nn * n + j] = cth;
+            }
+            b[j] = (alpha * cth + b[j]) / (cth * b[j] / alpha + 1.0);
+        }
     }
-    //** paste together both components and
+
+    //** Hankel transform, the weights include heights and normalization
+    RVector inph(nfr_), outph(nfr_);//** inphase and quadrature components
+    std::vector< Complex > a(J ? n : 0);
+    for (size_t i = 0 ; i < nfr_ ; i++) {
+        Complex aux(0.0, 0.0);
+        for (Index j = i * nc; j < (i + 1) * nc; j ++){
+            Complex bu(b[j] + u_[j]);
+            aux += (b[j] - u_[j]) / bu * w_[j];
+            if (J) a[j] = 2.0 * u_[j] / (bu * bu) * w_[j];
+        }
+        inph[i]  = real(aux);
+        outph[i] = imag(aux);
+    }
+    if (!J) return cat(inph, outph);
+
+    //** back through the recursion, a is d(response)/db of the current layer
+    size_t nThk = nl - 1;
+    J->resize(2 * nfr_, nThk + nl);
+    std::vector< Complex > dRho(n), dThk(n);
+
+    auto setJ = [&](size_t col, const std::vector< Complex > & d){
+        for (size_t i = 0 ; i < nfr_ ; i++) {
+            Complex sum(0.0, 0.0);
+            for (Index j = i * nc; j < (i + 1) * nc; j ++) sum += d[j];
+            (*J)[i][col] = real(sum);
+            (*J)[i + nfr_][col] = imag(sum);
+        }
+    };
+
+    for (size_t nn = 0; nn < nThk; nn ++){
+        for (Index j = 0; j < n; j ++){
+            Complex bb = bs[nn * n + j];
+            Complex al = alphas[nn * n + j];
+            Complex T = cths[nn * n + j];
+            Complex D = T * bb + al;
+            Complex N = al * (al * T + bb);
+            Complex D2 = D * D;
+            Complex sech2 = 1.0 - T * T;
+
+            Complex dAl = ((2.0 * al * T + bb) * D - N) / D2;
+            Complex dT = (al * al * D - N * bb) / D2;
+            Complex dAlRho = -c[j / nc] / (2.0 * al * rho[nn] * rho[nn]);
+
+            dRho[j] = a[j] * (dAl + dT * thk[nn] * sech2) * dAlRho;
+            dThk[j] = a[j] * dT * al * sech2;
+            a[j] *= al * al * sech2 / D2;
+        }
+        setJ(nn, dThk);
+        setJ(nThk + nn, dRho);
+    }
+    for (Index j = 0; j < n; j ++){
+        Complex al = alphas[(nl - 1) * n + j];
+        dRho[j] = a[j] * -c[j / nc] / (2.0 * al * rho[nl - 1] * rho[nl - 1]);
+    }
+    setJ(nThk + nl - 1, dRho);
     return cat(inph, outph);
 }
 
@@ -192,6 +372,29 @@ RVector FDEM1dModelling::response(const RVector & model){
     return calc(rho, thk);
 }
 
+void FDEM1dModelling::createJacobian(const RVector & model){
+    if (model.size() != nlay_ * 2 - 1) {
+        throwError(WHERE_AM_I + " model size " + str(model.size()) +
+                   " != " + str(nlay_ * 2 - 1));
+    }
+    RVector thk(model, 0, nlay_ - 1), rho(model, nlay_ - 1, 2 * nlay_ - 1);
+
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+    calc(rho, thk, *J);
+}
+
+void FDEM1dRhoModelling::createJacobian(const RVector & rho){
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian needs to be a RMatrix.");
+
+    RMatrix JFull;
+    calc(rho, thk_, JFull);
+    rhoColumns_(JFull, thk_.size(), *J);
+}
+
 RVector MRSModelling::response(const RVector & model) {
     RVector outreal(*KR_ * model);
     RVector outimag(*KI_ * model);
@@ -43,6 +43,8 @@ public:
 
     virtual ~MT1dModelling() { }
 
+    virtual ModellingBase * clone() const { return new MT1dModelling(*this); }
+
     /*! different sub-forward operators for alternate use */
     virtual RVector rhoaphi(const RVector & rho, const RVector & thk); //! app. res. and phase
 
@@ -52,10 +54,21 @@ public:
     //! app. res. for thk/res vector
 
 
+    /*! app. res. and phase and their derivatives, J is resized to
+     * 2 periods x (2 nlay - 1) with the columns [thk, rho]. */
+    RVector rhoaphi(const RVector & rho, const RVector & thk, RMatrix & J);
+
     /*! the actual (full) forward operator returning app.res.+phase for thickness+resistivity */
     virtual RVector response(const RVector & model);
 
+    /*! Analytic Jacobian for model = [thk, rho]. */
+    virtual void createJacobian(const RVector & model);
+
 protected:
+    /*! Impedance recursion for all periods at once, optionally with the
+     * derivatives for [thk, rho]. */
+    RVector rhoaphi_(const RVector & rho, const RVector & thk, RMatrix * J);
+
     RVector periods_;
     size_t nlay_;
 };
@@ -76,8 +89,13 @@ public:
 
     virtual ~MT1dRhoModelling() { }
 
+    virtual ModellingBase * clone() const { return new MT1dRhoModelling(*this); }
+
     virtual RVector response(const RVector & rho) { return rhoaphi(rho, thk_); }
 
+    /*! Analytic Jacobian for the resistivities. */
+    virtual void createJacobian(const RVector & rho);
+
     virtual RVector rhoa(const RVector & rho) { return MT1dModelling::rhoa(rho, thk_); }
 
 protected:
@@ -99,6 +117,8 @@ public:
 
     virtual ~FDEM1dModelling() { }
 
+    virtual ModellingBase * clone() const { return new FDEM1dModelling(*this); }
+
     void init();
 
     virtual RVector response(const RVector & model);
@@ -110,14 +130,28 @@ public:
 
     RVector calc(const RVector & rho, const RVector & thk);
 
+    /*! Inphase and quadrature and their derivatives, J is resized to
+     * 2 frequencies x (2 nlay - 1) with the columns [thk, rho]. */
+    RVector calc(const RVector & rho, const RVector & thk, RMatrix & J);
+
+    /*! Analytic Jacobian for model = [thk, rho]. */
+    virtual void createJacobian(const RVector & model);
 
 protected:
+    /*! Layer recursion for all frequencies and filter abscissae at once,
+     * optionally with the derivatives for [thk, rho]. */
+    RVector calc_(const RVector & rho, const RVector & thk, RMatrix * J) const;
+
     size_t nlay_;
     RVector freqs_;
     RVector coilspacing_;
     double zs_, ze_; // transmitter&receiver heights (minus)
     size_t nfr_;
     RVector freeAirSolution_;
+
+    //** Hankel filter abscissae and weights for all frequencies, see init()
+    RVector u_;
+    RVector w_;
 };
 
 //class MaxMinModelling:FDEMModelling
@@ -141,8 +175,13 @@ public:
 
     virtual ~FDEM1dRhoModelling() { }
 
+    virtual ModellingBase * clone() const { return new FDEM1dRhoModelling(*this); }
+
     RVector response(const RVector & model){ return calc(model, thk_); }
 
+    /*! Analytic Jacobian for the resistivities. */
+    virtual void createJacobian(const RVector & rho);
+
 protected:
     RVector thk_;
 };
@@ -188,6 +227,8 @@ public:
         }
 
     virtual ~MRS1dBlockModelling() { }
+
+    virtual ModellingBase * clone() const { return new MRS1dBlockModelling(*this); }
     /*! return voltage for a given block model vector */
     RVector response(const RVector & model);
 
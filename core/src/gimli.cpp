@@ -62,7 +62,7 @@ Index __setTC__(){
     }
 
 // __MS(tc)
-    tc = Index(min(8, numberOfCPU()-2));
+    tc = max(1, min(8, numberOfCPU()-2));
 // __MS(Index(tc))
     setThreadCount(Index(tc));
     return Index(tc);
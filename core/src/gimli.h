@@ -284,6 +284,7 @@ static const uint8 GIMLI_MATRIX_RTTI            = 1;
 static const uint8 GIMLI_SPARSE_MAP_MATRIX_RTTI = 2;
 static const uint8 GIMLI_SPARSE_CRS_MATRIX_RTTI = 3;
 static const uint8 GIMLI_BLOCKMATRIX_RTTI       = 4;
+static const uint8 GIMLI_MAPPEDMATRIX_RTTI      = 5;
 
 /*! Flag load/save Ascii or binary */
 enum IOFormat{Ascii, Binary};
@@ -293,6 +294,7 @@ class Boundary;
 class Cell;
 class DataContainer;
 class Line;
+class MappedFile;
 class MatrixBase;
 class Mesh;
 class MeshEntity;
@@ -321,6 +323,7 @@ typedef SparseMapMatrix< Complex, Index >  CSparseMapMatrix;
 
 template < class ValueType > class Matrix;
 template < class ValueType > class BlockMatrix;
+template < class ValueType > class MappedMatrix;
 template < class ValueType > class Matrix3;
 template < class ValueType > class Vector;
 
@@ -338,6 +341,8 @@ typedef Matrix < double > RMatrix;
 typedef Matrix3< double > RMatrix3;
 typedef Matrix < Complex > CMatrix;
 typedef BlockMatrix < double > RBlockMatrix;
+typedef MappedMatrix < double > RMappedMatrix;
+typedef MappedMatrix < Complex > CMappedMatrix;
 
 
 //#typedef Vector< unsigned char > BVector;
@@ -18,38 +18,259 @@
 
 #include "gravimetry.h"
 
+#include "datacontainer.h"
 #include "integration.h"
 #include "mesh.h"
 #include "pos.h"
 #include "shape.h"
+#include "threadpool.h"
 
 #include <cmath>
 
 namespace GIMLI {
 
-GravimetryModelling::GravimetryModelling( Mesh & mesh, DataContainer & dataContainer, bool verbose ){
+//** gravitational constant [m^3/(kg s^2)] and conversion m/s^2 to mGal
+static const double __GIMLIGravConst__ = 6.67384e-11 * 1e5;
+
+GravimetryModelling::GravimetryModelling(Mesh & mesh, DataContainer & dataContainer,
+                                         bool verbose)
+    : ModellingBase(mesh, dataContainer, verbose), matrixFree_(false){
+    stations_ = dataContainer.sensorPositions();
 }
 
-RVector GravimetryModelling::createDefaultStartModel( ){
-    RVector ret;
-    THROW_TO_IMPL
-    return ret;
+GravimetryModelling::GravimetryModelling(Mesh & mesh, const R3Vector & stations,
+                                         bool verbose)
+    : ModellingBase(mesh, verbose), stations_(stations), matrixFree_(false){
 }
 
-RVector GravimetryModelling::response( const RVector & model ){
-    RVector ret;
-    THROW_TO_IMPL
-    return ret;
+void GravimetryModelling::updateDataDependency_(){
+    if (dataContainer_) stations_ = dataContainer_->sensorPositions();
+    kernel_.clear();
+}
+
+void GravimetryModelling::setStations(const R3Vector & stations){
+    stations_ = stations;
+    kernel_.clear();
 }
 
-void GravimetryModelling::createJacobian( const RVector & model ){
-    THROW_TO_IMPL
+RVector GravimetryModelling::createDefaultStartModel(){
+    if (!mesh_) throwError(WHERE_AM_I + " no mesh given.");
+    return RVector(mesh_->cellCount(), 0.0);
 }
 
-void GravimetryModelling::initJacobian( ){
-    THROW_TO_IMPL
+RVector GravimetryModelling::response(const RVector & density){
+    if (!mesh_) throwError(WHERE_AM_I + " no mesh given.");
+    RVector cellDensity(createMappedModel(density, 0.0));
+
+    this->createNeighborInfos_();
+    if (matrixFree_) return calcGravimetry(stations_, *mesh_, cellDensity);
+
+    if (kernel_.rows() != stations_.size() || kernel_.cols() != mesh_->cellCount()){
+        createGravimetryKernel(stations_, *mesh_, kernel_);
+    }
+    return kernel_ * cellDensity;
+}
+
+void GravimetryModelling::createJacobian(const RVector & density){
+    if (!mesh_) throwError(WHERE_AM_I + " no mesh given.");
+
+    this->createNeighborInfos_();
+    if (kernel_.rows() != stations_.size() || kernel_.cols() != mesh_->cellCount()){
+        createGravimetryKernel(stations_, *mesh_, kernel_);
+    }
+
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(WHERE_AM_I + " Jacobian is not a RMatrix.");
+
+    //** same decision as in createMappedModel: cell values or one per marker
+    IVector cM(mesh_->cellMarkers());
+    if (density.size() == mesh_->cellCount() &&
+        unique(sort(cM[cM > -1])).size() != density.size()){
+        *J = kernel_;
+        return;
+    }
+
+    *J = RMatrix(stations_.size(), density.size());
+    for (Index i = 0; i < stations_.size(); i ++){
+        const RVector & k = kernel_[i];
+        RVector & Ji = (*J)[i];
+        for (Index c = 0; c < cM.size(); c ++){
+            if (cM[c] >= 0 && (Index)cM[c] < density.size()) Ji[cM[c]] += k[c];
+        }
+    }
 }
 
+/*! Boundaries of the mesh with contiguous corner coordinates. The nodes of
+ * each face are ordered so that the normal points out of the left cell. */
+struct GravimetryFaces_ {
+    explicit GravimetryFaces_(const Mesh & mesh){
+        if (!mesh.neighborsKnown()){
+            throwError(WHERE_AM_I + " mesh needs neighbor infos, "
+                       "call mesh.createNeighborInfos() first.");
+        }
+        dim = mesh.dim();
+        if (dim < 2) throwError(WHERE_AM_I + " need a 2D or 3D mesh.");
+
+        offset.reserve(mesh.boundaryCount() + 1);
+        offset.push_back(0);
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            Boundary & b = *mesh.boundaries()[i];
+            const Cell * l = b.leftCell();
+            const Cell * r = b.rightCell();
+            //** faces between two cells without density contrast cancel out,
+            //** but the contrast is not known here
+            if (!l && !r) continue;
+            if (!l) { l = r; r = 0; }
+
+            Index n = b.shape().nodeCount();
+            bool flip = false;
+            if (dim == 2){
+                RVector3 t(b.node(1).pos() - b.node(0).pos());
+                RVector3 d(b.center() - l->center());
+                flip = (t[1] * d[0] - t[0] * d[1]) < 0.0;
+            } else {
+                RVector3 nv((b.node(1).pos() - b.node(0).pos()).cross(
+                             b.node(2).pos() - b.node(0).pos()));
+                flip = nv.dot(b.center() - l->center()) < 0.0;
+            }
+            for (Index j = 0; j < n; j ++){
+                const RVector3 & p = b.node(flip ? n - 1 - j : j).pos();
+                x.push_back(p[0]); y.push_back(p[1]); z.push_back(p[2]);
+            }
+            offset.push_back(x.size());
+            left.push_back(l->id());
+            right.push_back(r ? (SIndex)r->id() : -1);
+        }
+    }
+
+    Index size() const { return left.size(); }
+
+    /*! Vertical gravity of face i for unit density of the left cell,
+     * without the gravitational constant. */
+    inline double gz(Index i, const RVector3 & p) const {
+        Index o = offset[i], n = offset[i + 1] - o;
+        if (dim == 2){
+            return -2.0 * lineIntegraldGdz(
+                    RVector3(x[o] - p[0], y[o] - p[1]),
+                    RVector3(x[o + 1] - p[0], y[o + 1] - p[1]));
+        }
+        return polyhedronFace_(&x[o], &y[o], &z[o], n, p);
+    }
+
+    //** analytic solution for polyhedra, e.g., Okabe (1979),
+    //** Werner & Scheeres (1997): gz = G rho sum_f n_z int_f 1/r dS
+    static double polyhedronFace_(const double * fx, const double * fy,
+                                  const double * fz, Index n, const RVector3 & p){
+        if (n < 3) return 0.0;
+        //** triangles and quads stay on the stack, larger polygons not
+        double buf[16];
+        std::vector< double > heap;
+        double * rx = buf;
+        if (n > 4){
+            heap.resize(4 * n);
+            rx = &heap[0];
+        }
+        double * ry = rx + n, * rz = ry + n, * r = rz + n;
+
+        for (Index j = 0; j < n; j ++){
+            rx[j] = fx[j] - p[0]; ry[j] = fy[j] - p[1]; rz[j] = fz[j] - p[2];
+            r[j] = std::sqrt(rx[j] * rx[j] + ry[j] * ry[j] + rz[j] * rz[j]);
+        }
+        //** unit normal of the planar polygon (Newell's method)
+        double nx = 0.0, ny = 0.0, nz = 0.0;
+        for (Index j = 0; j < n; j ++){
+            Index k = (j + 1) % n;
+            nx += (ry[j] - ry[k]) * (rz[j] + rz[k]);
+            ny += (rz[j] - rz[k]) * (rx[j] + rx[k]);
+            nz += (rx[j] - rx[k]) * (ry[j] + ry[k]);
+        }
+        double nn = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (nn < TOLERANCE || std::fabs(nz) < TOLERANCE * nn) return 0.0;
+        nx /= nn; ny /= nn; nz /= nn;
+
+        //** signed solid angle (van Oosterom & Strackee, 1983) of the fan
+        double omega = 0.0;
+        for (Index j = 1; j + 1 < n; j ++){
+            double cx = ry[j] * rz[j + 1] - rz[j] * ry[j + 1];
+            double cy = rz[j] * rx[j + 1] - rx[j] * rz[j + 1];
+            double cz = rx[j] * ry[j + 1] - ry[j] * rx[j + 1];
+            double num = rx[0] * cx + ry[0] * cy + rz[0] * cz;
+            double den = r[0] * r[j] * r[j + 1]
+                       + (rx[0] * rx[j] + ry[0] * ry[j] + rz[0] * rz[j]) * r[j + 1]
+                       + (rx[0] * rx[j + 1] + ry[0] * ry[j + 1] + rz[0] * rz[j + 1]) * r[j]
+                       + (rx[j] * rx[j + 1] + ry[j] * ry[j + 1] + rz[j] * rz[j + 1]) * r[0];
+            omega += 2.0 * std::atan2(num, den);
+        }
+        double d = nx * rx[0] + ny * ry[0] + nz * rz[0];
+        double s = -d * omega;
+
+        for (Index j = 0; j < n; j ++){
+            Index k = (j + 1) % n;
+            double ex = rx[k] - rx[j], ey = ry[k] - ry[j], ez = rz[k] - rz[j];
+            double e = std::sqrt(ex * ex + ey * ey + ez * ez);
+            if (e < TOLERANCE) continue;
+            //** outward in-plane edge normal t x n
+            double h = ((ey * nz - ez * ny) * rx[j] +
+                        (ez * nx - ex * nz) * ry[j] +
+                        (ex * ny - ey * nx) * rz[j]) / e;
+            double den = r[j] + r[k] - e;
+            if (std::fabs(h) < TOLERANCE || den < TOLERANCE) continue;
+            s += h * std::log((r[j] + r[k] + e) / den);
+        }
+        return nz * s;
+    }
+
+    Index dim;
+    std::vector< double > x, y, z;
+    std::vector< Index > offset;
+    std::vector< Index > left;
+    std::vector< SIndex > right;
+};
+
+void createGravimetryKernel(const R3Vector & pos, const Mesh & mesh, RMatrix & kernel){
+    GravimetryFaces_ faces(mesh);
+    kernel.resize(pos.size(), mesh.cellCount());
+
+    parallelFor(0, pos.size(), 0, [&](Index start, Index end, Index){
+        for (Index i = start; i < end; i ++){
+            RVector & k = kernel[i];
+            k.fill(0.0);
+            for (Index f = 0; f < faces.size(); f ++){
+                double g = faces.gz(f, pos[i]) * __GIMLIGravConst__;
+                k[faces.left[f]] += g;
+                if (faces.right[f] > -1) k[faces.right[f]] -= g;
+            }
+        }
+    });
+}
+
+RVector calcGravimetry(const R3Vector & pos, const Mesh & mesh, const RVector & density){
+    if (density.size() != mesh.cellCount()){
+        throwLengthError(WHERE_AM_I + " density size " + str(density.size())
+                         + " != " + str(mesh.cellCount()));
+    }
+    GravimetryFaces_ faces(mesh);
+
+    //** density contrast across each face, faces without contrast are skipped
+    RVector contrast(faces.size());
+    for (Index f = 0; f < faces.size(); f ++){
+        contrast[f] = density[faces.left[f]];
+        if (faces.right[f] > -1) contrast[f] -= density[faces.right[f]];
+    }
+
+    RVector ret(pos.size(), 0.0);
+    parallelFor(0, pos.size(), 0, [&](Index start, Index end, Index){
+        for (Index i = start; i < end; i ++){
+            double g = 0.0;
+            for (Index f = 0; f < faces.size(); f ++){
+                if (contrast[f] != 0.0) g += faces.gz(f, pos[i]) * contrast[f];
+            }
+            ret[i] = g * __GIMLIGravConst__;
+        }
+    });
+    return ret;
+}
 
 double lineIntegraldGdz( const RVector3 & p1, const RVector3 & p2 ){
     double x1 = p1[ 0 ], z1 = p1[ 1 ];
@@ -98,21 +319,25 @@ double lineIntegraldGdz( const RVector3 & p1, const RVector3 & p2 ){
 
 RVector calcGBounds( const std::vector< RVector3 > & pos, const Mesh & mesh, const RVector & model ){
     /*! Ensure neighborInfos() */
-    RMatrix Jacobian( pos.size(), mesh.cellCount() );
-
-    Jacobian *= 0.;
-
-    for ( uint i = 0; i < pos.size(); i ++ ){
-        for ( std::vector< Boundary * >::const_iterator it = mesh.boundaries().begin(); it != mesh.boundaries().end(); it ++ ){
-            Boundary *b = *it;
-            double Z = lineIntegraldGdz( b->node( 0 ).pos() - pos[ i ], b->node( 1 ).pos() - pos[ i ] );
-
-            if ( b->leftCell() ) Jacobian[ i ][ b->leftCell()->id() ] = Jacobian[ i ][ b->leftCell()->id() ] - Z;
-            if ( b->rightCell() ) Jacobian[ i ][ b->rightCell()->id() ] = Jacobian[ i ][ b->rightCell()->id() ] + Z;
+    const std::vector< Boundary * > & bounds = mesh.boundaries();
+    RVector ret(pos.size(), 0.0);
+
+    parallelFor(0, pos.size(), 0, [&](Index start, Index end, Index){
+        for (Index i = start; i < end; i ++){
+            double g = 0.0;
+            for (Index j = 0; j < bounds.size(); j ++){
+                Boundary *b = bounds[j];
+                double rho = 0.0;
+                if (b->leftCell()) rho -= model[b->leftCell()->id()];
+                if (b->rightCell()) rho += model[b->rightCell()->id()];
+                if (rho == 0.0) continue;
+                g += rho * lineIntegraldGdz(b->node(0).pos() - pos[i], b->node(1).pos() - pos[i]);
+            }
+            ret[i] = g;
         }
-    }
+    });
 
-    return Jacobian * model * 2.0 * 6.67384e-11 * 1e5;
+    return ret * 2.0 * 6.67384e-11 * 1e5;
 }
 
 double f_gz( const RVector3 & x, const RVector3 & p ){
@@ -121,32 +346,35 @@ double f_gz( const RVector3 & x, const RVector3 & p ){
 }
 
 RVector calcGCells( const std::vector< RVector3 > & pos, const Mesh & mesh, const RVector & model, uint nInt ){
-    /*! Ensure neighborInfos() */
-    RMatrix Jacobian( pos.size(), mesh.cellCount() );
-
-    Jacobian *= 0.;
-
-    for ( uint i = 0; i < pos.size(); i ++ ){
-        for ( std::vector< Cell * >::const_iterator it = mesh.cells().begin(); it != mesh.cells().end(); it ++ ){
-            Cell *c = *it;
-            double Z = 0.;
-            if ( nInt == 0 ){
-                for ( uint j = 0; j < c->nodeCount(); j ++ ){
-                    // negative Z because all cells are numbered counterclockwise
-                    Z -= 2.0 * lineIntegraldGdz( c->node( j ).pos() - pos[ i ], c->node( (j+1)%c->nodeCount() ).pos() - pos[ i ] );
-                }
-            } else {
-                for ( uint j = 0; j < IntegrationRules::instance().triAbscissa( nInt ).size(); j ++ ){
-                    Z += IntegrationRules::instance().triWeights( nInt )[ j ] *
-                                    f_gz( c->shape().xyz( IntegrationRules::instance().triAbscissa( nInt )[ j ] ), pos[ i ] );
+    RVector ret(pos.size(), 0.0);
+    const R3Vector & abscissa = IntegrationRules::instance().triAbscissa(nInt > 0 ? nInt : 1);
+    const RVector & weights = IntegrationRules::instance().triWeights(nInt > 0 ? nInt : 1);
+
+    parallelFor(0, pos.size(), 0, [&](Index start, Index end, Index){
+        for (Index i = start; i < end; i ++){
+            double g = 0.0;
+            for (Index k = 0; k < mesh.cellCount(); k ++){
+                const Cell & c = mesh.cell(k);
+                double rho = model[c.id()];
+                if (rho == 0.0) continue;
+                double Z = 0.;
+                if (nInt == 0){
+                    for (uint j = 0; j < c.nodeCount(); j ++){
+                        // negative Z because all cells are numbered counterclockwise
+                        Z -= 2.0 * lineIntegraldGdz(c.node(j).pos() - pos[i], c.node((j+1)%c.nodeCount()).pos() - pos[i]);
+                    }
+                } else {
+                    for (uint j = 0; j < abscissa.size(); j ++){
+                        Z += weights[j] * f_gz(c.shape().xyz(abscissa[j]), pos[i]);
+                    }
                 }
+                g -= rho * Z;
             }
-
-            Jacobian[ i ][ c->id() ] = -Z;
+            ret[i] = g;
         }
-    }
+    });
 
-    return Jacobian * model * 6.67384e-11 * 1e5;
+    return ret * 6.67384e-11 * 1e5;
 }
 
 } // namespace GIMLI{
@@ -25,28 +25,65 @@
 namespace GIMLI {
 
 //! Modelling class for gravimetry calculation using polygon integration
-/*! Modelling class for gravimetry calculation using polygon integration */
+/*! Modelling class for the vertical component of the gravity [mGal] of a
+ * density contrast [kg/m^3], positive for excess mass below the station.
+ * 2D meshes use the line integral after Won and Bevis (1987), 3D meshes
+ * the analytic solution for polyhedra of constant density, i.e., all
+ * cell types with planar faces like tetrahedra, prisms and hexahedra.
+ * The model is given per cell or per cell marker, see
+ * \ref createMappedModel. */
 class DLLEXPORT GravimetryModelling : public ModellingBase {
 public:
-    GravimetryModelling( Mesh & mesh, DataContainer & dataContainer, bool verbose = false );
+    /*! The stations are the sensor positions of the data container. */
+    GravimetryModelling(Mesh & mesh, DataContainer & dataContainer, bool verbose=false);
+
+    GravimetryModelling(Mesh & mesh, const R3Vector & stations, bool verbose=false);
 
     virtual ~GravimetryModelling() { }
 
-    RVector createDefaultStartModel( );
+    virtual ModellingBase * clone() const { return new GravimetryModelling(*this); }
+
+    RVector createDefaultStartModel();
 
     /*! Interface. Calculate response */
-    virtual RVector response( const RVector & slowness );
+    virtual RVector response(const RVector & density);
 
     /*! Interface. */
-    virtual void createJacobian( const RVector & slowness );
+    virtual void createJacobian(const RVector & density);
 
-    /*! Interface. */
-    virtual void initJacobian( );
+    /*! Set the measuring positions. */
+    void setStations(const R3Vector & stations);
+
+    /*! Return the measuring positions. */
+    const R3Vector & stations() const { return stations_; }
+
+    /*! Calculate the response without the kernel matrix, i.e., memory
+     * only for the response but every call as expensive as the kernel.
+     * Default is false, the kernel is calculated once and reused. */
+    void setMatrixFree(bool matrixFree) { matrixFree_ = matrixFree; }
+
+    bool matrixFree() const { return matrixFree_; }
 
 protected:
+    virtual void updateMeshDependency_() { kernel_.clear(); }
+
+    virtual void updateDataDependency_();
+
+    R3Vector stations_;
+    RMatrix  kernel_;
+    bool     matrixFree_;
 };
 
+/*! Fill kernel with the vertical gravity [mGal] at pos for a unit
+ * density contrast [kg/m^3] in each cell of the 2D or 3D mesh,
+ * see \ref GravimetryModelling. */
+DLLEXPORT void createGravimetryKernel(const R3Vector & pos, const Mesh & mesh,
+                                      RMatrix & kernel);
 
+/*! Vertical gravity [mGal] at pos for a density contrast [kg/m^3] per
+ * cell. Matrix free variant of \ref createGravimetryKernel. */
+DLLEXPORT RVector calcGravimetry(const R3Vector & pos, const Mesh & mesh,
+                                 const RVector & density);
 
 /*! Only for a small TPOC for 2d gravimetry after WonBevis1987
  Do not use until u know what u do. */
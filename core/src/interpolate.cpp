@@ -22,6 +22,8 @@
 #include "mesh.h"
 #include "node.h"
 #include "shape.h"
+#include "sparsematrix.h"
+#include "threadpool.h"
 
 namespace GIMLI{
 
@@ -256,26 +258,52 @@ void triangleMesh_(const Mesh & mesh, Mesh & tmpMesh){
 }
 
 
-RVector cellDataToPointData(const Mesh & mesh, const RVector & cellData){
+/*! Return A * b for a (cached) operator of the mesh, rows in parallel. */
+static RVector multRows_(const RSparseMatrix & A, const RVector & b){
+    RVector ret(A.rows(), 0.0);
+    const std::vector < int > & rowPtr = A.vecColPtr();
+    const std::vector < int > & colIdx = A.vecRowIdx();
+    const RVector & vals = A.vecVals();
+
+    parallelFor(0, A.rows(), 4096, [&](Index start, Index end, Index){
+        for (Index i = start; i < end; i ++){
+            double v = 0.0;
+            for (int k = rowPtr[i]; k < rowPtr[i + 1]; k ++){
+                v += vals[k] * b[colIdx[k]];
+            }
+            ret[i] = v;
+        }
+    });
+    return ret;
+}
+
+RVector cellDataToPointData(const Mesh & mesh, const RVector & cellData,
+                            bool volumeWeighted){
     if (cellData.size() != mesh.cellCount()){
         throwLengthError(" vector size invalid mesh.cellCount "
                         + str(mesh.cellCount()) + " != " + str(cellData.size()));
     }
-
-    RVector ret(mesh.nodeCount());
-
-    std::set < Cell * > cset;
-    for (uint i = 0; i < mesh.nodeCount(); i ++){
-        cset = mesh.node(i).cellSet();
-        for (std::set < Cell * >::iterator it = cset.begin(); it != cset.end(); it ++){
-            ret[i] += cellData[(*it)->id()];
-        }
-        ret[i] /= cset.size();
+    bool moving = volumeWeighted && !mesh.staticGeometry();
+    RSparseMatrix weighted;
+    if (moving) weighted = mesh.createCellToNodeInterpolation(true);
+    const RSparseMatrix & A = moving ? weighted :
+                                mesh.cellToNodeInterpolation(volumeWeighted);
+    RVector ret(multRows_(A, cellData));
+
+    //** nodes without cells have no mean
+    const std::vector < int > & rowPtr = A.vecColPtr();
+    for (Index i = 0; i < ret.size(); i ++){
+        if (rowPtr[i] == rowPtr[i + 1]) ret[i] = std::numeric_limits< double >::quiet_NaN();
     }
-
     return ret;
+}
 
-
+RVector pointDataToCellData(const Mesh & mesh, const RVector & pointData){
+    if (pointData.size() != mesh.nodeCount()){
+        throwLengthError(" vector size invalid mesh.nodeCount "
+                        + str(mesh.nodeCount()) + " != " + str(pointData.size()));
+    }
+    return multRows_(mesh.nodeToCellInterpolation(), pointData);
 }
 
 // double interpolate(const RVector3 & queryPos, const MeshEntity & entity, const RVector & sol){
@@ -82,10 +82,18 @@ DLLEXPORT void interpolate(const Mesh & srcMesh, const RMatrix & inMat,
 DLLEXPORT void interpolateSurface(const Mesh & srcMesh, Mesh & destMesh,
                                   bool verbose=false, double fillValue=0);
 
-/*! Utility function. Convert cell data to point data with the
- * corresponding the cell interpolation function */
+/*! Utility function. Convert cell data to point data, i.e., the mean of
+ * all cells sharing a node, weighted with the cell sizes if volumeWeighted
+ * is set. Nodes without cells get NaN. Uses the cached
+ * \ref Mesh::cellToNodeInterpolation. */
 DLLEXPORT RVector cellDataToPointData(const Mesh & mesh,
-                                      const RVector & cellData);
+                                      const RVector & cellData,
+                                      bool volumeWeighted=false);
+
+/*! Utility function. Convert point data to cell data, i.e., the mean of
+ * the cell nodes. Uses the cached \ref Mesh::nodeToCellInterpolation. */
+DLLEXPORT RVector pointDataToCellData(const Mesh & mesh,
+                                      const RVector & pointData);
 
 DLLEXPORT void triangleMesh_(const Mesh & mesh, Mesh & tmpMesh);
 
@@ -19,8 +19,102 @@
 
 #include "inversion.h"
 
+#include "profiler.h"
+#include "threadpool.h"
+
 namespace GIMLI{
 
+RVector RInversion::cachedResponse(const RVector & model) const {
+    Index key = model.hash();
+    std::map < Index, std::pair < Vec, Vec > >::iterator it = responseCache_.find(key);
+
+    if (it != responseCache_.end() && it->second.first == model){
+        return it->second.second;
+    }
+    Vec resp(forward_->response(model));
+    forwardModel_ = model;
+    responseCache_[key] = std::make_pair(model, resp);
+    return resp;
+}
+
+double RInversion::linesearchForward(const Vec & modelNew,
+                                     const Vec & responseNew) const {
+    Index nTau = max(Index(1), lineSearchResponses_);
+
+    //** tau = 1 is already known
+    std::vector < RVector > models;
+    std::vector < RVector > responses;
+    for (Index i = 1; i < nTau; i ++){
+        Vec model(tM_->update(model_, deltaModelIter_ * (double(i) / nTau)));
+        std::map < Index, std::pair < Vec, Vec > >::iterator it =
+            responseCache_.find(model.hash());
+        if (it == responseCache_.end() || !(it->second.first == model)){
+            models.push_back(model);
+        }
+    }
+
+    if (models.size() > 0){
+        Stopwatch swatch(true);
+        responses.resize(models.size());
+        Index nThreads = max(Index(1), min(Index(models.size()),
+                                           forward_->threadCount()));
+
+        //** one clone per thread keeps the state of forward_ at modelNew,
+        //** serial on forward_ without clone
+        std::vector< std::unique_ptr< ModellingBase > > fops;
+        for (Index i = 0; i < nThreads && nThreads > 1; i ++){
+            ModellingBase * fop = forward_->clone();
+            if (!fop) {
+                log(Debug, "No clone() for the line search, run serial.");
+                fops.clear();
+                nThreads = 1;
+                break;
+            }
+            fops.emplace_back(fop);
+        }
+
+        ALLOW_PYTHON_THREADS
+        ThreadPool::instance().parallelFor(0, models.size(), 1,
+            [&](Index start, Index end, Index slot){
+            ModellingBase * fop = fops.empty() ? forward_ : fops[slot].get();
+            for (Index i = start; i < end; i ++) responses[i] = fop->response(models[i]);
+        }, nThreads);
+        if (fops.empty()) forwardModel_ = models.back();
+
+        for (Index i = 0; i < models.size(); i ++){
+            responseCache_[models[i].hash()] = std::make_pair(models[i], responses[i]);
+        }
+        if (verbose_) std::cout << "Line search: " << models.size()
+                                << " responses in " << swatch.duration() << " s" << std::endl;
+    }
+
+    double minPhi = localRegularization_ ? getPhiD() : getPhi();
+    double tau = 1.0 / nTau;
+    bool found = false;
+
+    for (Index i = 1; i <= nTau; i ++){
+        double t = double(i) / nTau;
+        Vec model(modelNew);
+        Vec resp(responseNew);
+        if (i < nTau){
+            model = tM_->update(model_, deltaModelIter_ * t);
+            resp = cachedResponse(model);
+        }
+        double phi = localRegularization_ ? getPhiD(resp) : getPhi(model, resp);
+        if (verbose_) std::cout << "tau = " << t << " phi = " << phi << std::endl;
+        if (phi < minPhi){
+            minPhi = phi;
+            tau = t;
+            found = true;
+        }
+    }
+    if (!found && verbose_) {
+        std::cout << "No step decreases phi, use smallest tau = " << tau << std::endl;
+    }
+    if (verbose_) std::cout << "Performing line search with tau = " << tau << std::endl;
+    return tau;
+}
+
 void RInversion::checkConstraints() {
     if (forward_->constraints()->cols() == 0 ||
         forward_->constraints()->rows() == 0){
@@ -145,6 +239,7 @@ const RVector & RInversion::run(){ ALLOW_PYTHON_THREADS
 
     //! calculation of initial modelresponse
     response_ = forward_->response(model_);
+    forwardModel_ = model_;
     //response_ = forward_->response(forward_->startModel());
 
     //! () clear the model history
@@ -247,7 +342,9 @@ const RVector & RInversion::run(){ ALLOW_PYTHON_THREADS
 } //** run
 
 bool RInversion::oneStep() {
+    GIMLI_PROFILE_ZONE("Inversion::oneStep");
     iter_++;
+    responseCache_.clear();
     deltaModelIter_.resize(model_.size());
     deltaModelIter_ *= 0.0;
     deltaDataIter_ = (tD_->trans(data_) - tD_->trans(response_));
@@ -351,18 +448,31 @@ bool RInversion::oneStep() {
     }
 
     Vec responseLast(response_);
-    responseNew = forward_->response(modelNew);
+    responseNew = cachedResponse(modelNew);
 
     double tau = 1.0;
     if (useLinesearch_){
-        tau = linesearch(modelNew, responseNew);
+        if (lineSearchResponses_ > 0){
+            tau = linesearchForward(modelNew, responseNew);
+        } else {
+            tau = linesearch(modelNew, responseNew);
+        }
     }
 
     if (tau >= 0.95){ //! full step possible;
         response_ = responseNew;
     } else { //! normal line search parameter between 0.03 and 0.94
         modelNew = tM_->update(model_, deltaModelIter_ * tau);
+        response_ = cachedResponse(modelNew);
+    }
+    responseCache_.clear();
+
+    //** the next Jacobian may reuse the internal state of forward_, so it
+    //** has to belong to the accepted model and not to the last trial
+    if (!(forwardModel_ == modelNew)){
+        if (verbose_) std::cout << "Recalculate the response of the accepted model." << std::endl;
         response_ = forward_->response(modelNew);
+        forwardModel_ = modelNew;
     }
 
     model_ = modelNew;
@@ -379,15 +489,15 @@ bool RInversion::oneStep() {
 //         rank1Update(*J_, u, v);
     }
 
-    //!** temporary stuff
-    if (forward_->mesh()){
+    //!** temporary stuff, export a copy of the maybe shared forward mesh
+    const ModellingBase & cForward = *forward_;
+    if (dosave_ && cForward.mesh()){
+        Mesh fopMesh(*cForward.mesh());
 // this forces pygimli/generatecode.py to create a ugly log10 declaration, which overwrites the valid log10 declarion
         // DOSAVE forward_->mesh()->addData("F-op-model(log10)",
         //                                         log10(forward_->mesh()->cellAttributes()));
-        DOSAVE forward_->mesh()->addData("F-op-model",
-                                                forward_->mesh()->cellAttributes());
-        DOSAVE forward_->mesh()->exportVTK("fop-model" + str(iter_));
-        DOSAVE forward_->mesh()->clearData();
+        DOSAVE fopMesh.addData("F-op-model", fopMesh.cellAttributes());
+        DOSAVE fopMesh.exportVTK("fop-model" + str(iter_));
     }
     return true;
 }
@@ -403,7 +513,7 @@ ALLOW_PYTHON_THREADS
     Vec uroldDModel(oldDModel);
     Vec deltaModel(model_.size());
     Vec tModel(tM_->trans(model_));
-    Vec tResponse(tM_->trans(response_));
+    Vec tResponse(tD_->trans(response_));
     Vec roughness(constraintWeights_.size(), 0.0);
 
     if (!localRegularization_) {
@@ -417,14 +527,20 @@ ALLOW_PYTHON_THREADS
     DOSAVE echoMinMax(constraintsH_, "constraintsH");
     DOSAVE save(constraintsH_, "constraintsH");
 
-//    solveCGLSCDWWtrans(*J_, forward_->constraints(), dataWeight_, deltaData, deltaModel, constraintWeights_,
-//                        modelWeight_, tM_->deriv(model_), tD_->deriv(response_),
-//                        lambda_, deltaModel0, maxCGLSIter_, verbose_);
-    solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
-                        dataWeight_, deltaDataIter_, deltaModel,
-                        constraintWeights_, modelWeight_,
-                        tM_->deriv(model_), tD_->deriv(response_),
-                        lambda_, roughness, maxCGLSIter_, dosave_);
+    //** all lambda candidates lambda_ * 0.8^i share one Krylov basis of the
+    //** Jacobian, so the whole L-curve costs about one CGLS solve
+    Index nLambda = 30;
+    Vec lambdas(nLambda);
+    for (Index i = 0; i < nLambda; i ++) lambdas[i] = lambda_ * std::pow(0.8, double(i));
+
+    std::vector < Vec > deltaModels, deltaResponses;
+    solveMultiLambdaCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
+                               dataWeight_, deltaDataIter_,
+                               constraintWeights_, modelWeight_,
+                               tM_->deriv(model_), tD_->deriv(response_),
+                               lambdas, roughness, deltaModels, deltaResponses,
+                               maxCGLSIter_, CGLStol_, dosave_);
+    deltaModel = deltaModels[0];
 
     Vec appModelStart(tM_->invTrans(tModel + deltaModel));
     DOSAVE save(appModelStart, "appModel");
@@ -440,20 +556,13 @@ ALLOW_PYTHON_THREADS
     if(verbose_) std::cout << "lambda(0) = inf" << " PhiD = " << phiD.back() << " PhiM = " << phiM.back()  << std::endl;
 
     int lambdaIter = 0;
-    while (lambdaIter < 30) {
+    while (lambdaIter < int(nLambda)) {
         lambdaIter++;
         if(verbose_) std::cout << lambdaIter << "lambda = " << lambda_ << std::endl;
-//        solveCGLSCDWWtrans(*J_, forward_->constraints(), dataWeight_, deltaData, deltaModel, constraintWeights_,
-//                          modelWeight_, tM_->deriv(model_), tD_->deriv(response_),
-//                          lambda_, deltaModel0, maxCGLSIter_, verbose_);
-        solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
-                            dataWeight_, deltaDataIter_, deltaModel,
-                            constraintWeights_, modelWeight_,
-                            tM_->deriv(model_), tD_->deriv(response_),
-                            lambda_, roughness, maxCGLSIter_, dosave_);
+        deltaModel = deltaModels[lambdaIter - 1];
 
         Vec appModel(tM_->invTrans(tModel + deltaModel));
-        Vec appResponse(tD_->invTrans(tResponse + *forward_->jacobian() * deltaModel));
+        Vec appResponse(tD_->invTrans(tResponse + deltaResponses[lambdaIter - 1]));
 
         if (lambdaIter == 1) { //* normalize on 1st iteration
 //      	 phiMNorm = getPhiM(appModel);
@@ -186,6 +186,7 @@ protected:
         dPhiAbortPercent_   = 2.0;
 
         CGLStol_            = -1.0; //** -1 means automatic scaled
+        lineSearchResponses_ = 0;
     }
 
 public:
@@ -314,6 +315,17 @@ public:
 
     /*! Set and get line search */
     inline void setLineSearch(bool linesearch) { useLinesearch_ = linesearch; }
+
+    /*! Evaluate n step lengths tau = i/n in the line search with forward
+     * responses instead of the linearized response. The responses are
+     * calculated concurrently on forward->threadCount() threads, each with
+     * its own \ref ModellingBase::clone. Without clone they are calculated
+     * serially, e.g., for DCMultiElectrodeModelling. Default 0 uses the
+     * linearized line search. */
+    inline void setLineSearchResponses(Index n) { lineSearchResponses_ = n; }
+
+    /*! Return the number of forward responses evaluated per line search. */
+    inline Index lineSearchResponses() const { return lineSearchResponses_; }
     inline bool lineSearch() const { return useLinesearch_; }
 
     /*! Set and get blocky model behaviour (by L1 reweighting of constraints) */
@@ -530,7 +542,8 @@ public:
     Vec modelCellResolution(const RVector3 & pos){
         Index ipos = 0;
         double mindist = 9e99;
-        R3Vector cellCenters = forward_->mesh()->cellCenter();
+        const ModellingBase & fop = *forward_;
+        R3Vector cellCenters = fop.mesh()->cellCenter();
 
         for (Index i = 0 ; i < model_.size() ; i++){
             double dist = cellCenters[i].distance(pos);
@@ -650,7 +663,7 @@ public:
             if (verbose_) std::cout << "tau = " << tau
                             << ". Trying parabolic line search with step length " << tauquad;
             RVector modelQuad(tM_->update(model_, dModel * tauquad));
-            RVector responseQuad (forward_->response(modelQuad));
+            RVector responseQuad (cachedResponse(modelQuad));
             tau = linesearchQuad(modelNew, responseNew, modelQuad, responseQuad, tauquad);
             if (verbose_) std::cout << " ==> tau = " << tau;
             if (tau > 1.0) { //! too large
@@ -674,6 +687,18 @@ public:
         return tau;
     }
 
+    /*! Line search with forward responses for \ref lineSearchResponses
+     * step lengths, calculated concurrently on clones of the forward
+     * operator, or serial if it has no \ref ModellingBase::clone. Returns
+     * the step length with the smallest objective function. All responses
+     * are cached. The accepted step needs another forward calculation only
+     * if the forward operator itself calculated a different model last. */
+    double linesearchForward(const Vec & modelNew, const Vec & responseNew) const;
+
+    /*! Return the forward response for model. Responses calculated
+     * before within the current iteration are reused. */
+    Vec cachedResponse(const Vec & model) const;
+
     /*! Compute objective function for old (tau=0), new (tau=1) and another model */
     double linesearchQuad(const Vec & modelNew, const Vec & responseNew,
                            const Vec & modelQuad, const Vec & responseQuad,
@@ -823,6 +848,15 @@ protected:
     /*! Hold old models, for debuging */
     std::vector < RVector > modelHist_;
 
+    Index lineSearchResponses_;
+
+    /*! Forward responses of the current iteration, keyed by model hash */
+    mutable std::map < Index, std::pair < Vec, Vec > > responseCache_;
+
+    /*! Model of the last response of forward_, i.e., the model its
+     * internal state, e.g., potentials reused for the Jacobian, belongs to */
+    mutable Vec forwardModel_;
+
 };
 
 } // namespace GIMLI
@@ -0,0 +1,94 @@
+/******************************************************************************
+ *   Copyright (C) 2012-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#ifdef WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace GIMLI {
+
+MappedFile::MappedFile(const std::string & fileName)
+    : fileName_(fileName), data_(NULL), size_(0), mapped_(false){
+
+#ifdef WIN32_LEAN_AND_MEAN
+    std::ifstream file(fileName_.c_str(), std::ios::in | std::ios::binary);
+    if (!file) {
+        throwError(WHERE_AM_I + " " + fileName_ + ": " + strerror(errno));
+    }
+    file.seekg(0, std::ios::end);
+    size_ = (Index)file.tellg();
+    file.seekg(0, std::ios::beg);
+    buffer_.resize(size_);
+    if (size_ > 0) file.read(&buffer_[0], size_);
+    data_ = buffer_.data();
+#else
+    int fd = open(fileName_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throwError(WHERE_AM_I + " " + fileName_ + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        close(fd);
+        throwError(WHERE_AM_I + " " + fileName_ + ": " + strerror(errno));
+    }
+    size_ = (Index)st.st_size;
+
+    if (size_ > 0){
+        void * addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED){
+            close(fd);
+            throwError(WHERE_AM_I + " " + fileName_ + ": mmap failed: "
+                       + strerror(errno));
+        }
+        data_ = static_cast< const char * >(addr);
+        mapped_ = true;
+    }
+    //** the mapping stays valid after closing the descriptor
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile(){
+#ifndef WIN32_LEAN_AND_MEAN
+    if (mapped_) munmap(const_cast< char * >(data_), size_);
+#endif
+}
+
+void MappedFile::willNeed(Index offset, Index length) const {
+#ifndef WIN32_LEAN_AND_MEAN
+    if (!mapped_ || length == 0) return;
+    //** madvise needs page aligned start address
+    Index page = (Index)sysconf(_SC_PAGESIZE);
+    Index start = (offset / page) * page;
+    madvise(const_cast< char * >(data_) + start,
+            std::min(size_, offset + length) - start, MADV_WILLNEED);
+#endif
+}
+
+} // namespace GIMLI
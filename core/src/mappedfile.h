@@ -0,0 +1,84 @@
+/******************************************************************************
+ *   Copyright (C) 2012-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_MAPPEDFILE__H
+#define _GIMLI_MAPPEDFILE__H
+
+#include "gimli.h"
+
+namespace GIMLI{
+
+//! Read-only memory mapped file.
+/*! Maps a whole file read-only into the address space so large binary
+ * arrays (mesh connectivity, matrices) can be used in place without
+ * copying them through fread. On systems without mmap the file content
+ * is read into an internal buffer instead, so the interface stays the same.
+ * The mapping is released with the object. */
+class DLLEXPORT MappedFile {
+public:
+    /*! Map the file fileName. Throws if the file cannot be opened. */
+    MappedFile(const std::string & fileName);
+
+    ~MappedFile();
+
+    /*! Return the name of the mapped file. */
+    inline const std::string & fileName() const { return fileName_; }
+
+    /*! Return the file size in byte. */
+    inline Index size() const { return size_; }
+
+    /*! Return a pointer to the first byte of the file. */
+    inline const char * data() const { return data_; }
+
+    /*! Return true if the content is really mapped and not buffered. */
+    inline bool isMapped() const { return mapped_; }
+
+    /*! Return a typed pointer to the byte offset. Throws if count values
+     * of ValueType starting at offset don't fit into the file. */
+    template < class ValueType > const ValueType * at(Index offset,
+                                                      Index count=1) const {
+        //** no products or sums that can wrap for corrupt counts
+        if (offset > size_ || count > (size_ - offset) / sizeof(ValueType)){
+            throwError(WHERE_AM_I + " " + fileName_ + ": access beyond file size "
+                       + str(offset) + " + " + str(count) + " x "
+                       + str(sizeof(ValueType)) + " > " + str(size_));
+        }
+        return reinterpret_cast< const ValueType * >(data_ + offset);
+    }
+
+    /*! Advise the kernel that the range will be read sequentially and soon.
+     * No-op if the content is not mapped. */
+    void willNeed(Index offset, Index length) const;
+
+protected:
+    std::string fileName_;
+    const char * data_;
+    Index size_;
+    bool mapped_;
+    std::vector < char > buffer_;
+
+private:
+    /*! Copy constructor is private, so don't use it */
+    MappedFile(const MappedFile &){};
+    /*! Assignment operator is private, so don't use it */
+    void operator = (const MappedFile &){ };
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_MAPPEDFILE__H
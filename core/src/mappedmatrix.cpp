@@ -0,0 +1,204 @@
+/******************************************************************************
+ *   Copyright (C) 2012-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "mappedmatrix.h"
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace GIMLI{
+
+template < class ValueType >
+MappedMatrix< ValueType >::MappedMatrix(const std::string & filename)
+    : MatrixBase(), cols_(0){
+    addFile_(filename, true);
+}
+
+template < class ValueType >
+MappedMatrix< ValueType >::MappedMatrix(const std::string & filenameBody,
+                                        Index kCount)
+    : MatrixBase(), cols_(0){
+    std::string filename;
+
+    //** same naming scheme as loadMatrixVectorsBin
+    for (Index i = 0; i < kCount; i++){
+        Index count = 0;
+        while (1){
+            if (kCount > 1){
+                filename = filenameBody + "." + str(count) + "_" + str(i) + ".pot";
+            } else {
+                filename = filenameBody + "." + str(count) + ".pot";
+            }
+            if (!fileExist(filename)){
+                filename = filenameBody + "." + str(count);
+                if (!fileExist(filename)) break;
+            }
+            addFile_(filename, false);
+            count ++;
+        }
+    }
+    if (rows_.empty()){
+        throwError(WHERE_AM_I + " no vector files found for: " + filenameBody);
+    }
+}
+
+template < class ValueType >
+MappedMatrix< ValueType >::~MappedMatrix(){
+    for (Index i = 0; i < files_.size(); i ++) delete files_[i];
+}
+
+template < class ValueType >
+void MappedMatrix< ValueType >::addFile_(const std::string & filename,
+                                         bool matrix){
+    MappedFile * mf = new MappedFile(filename);
+    files_.push_back(mf);
+
+    Index rows = 1;
+    Index cols = 0;
+    Index offset = 0;
+
+    if (matrix){
+        const uint32 * dim = mf->at< uint32 >(0, 2);
+        rows = dim[0];
+        cols = dim[1];
+        offset = 2 * sizeof(uint32);
+    } else {
+        int64 len = *mf->at< int64 >(0);
+        if (len < 0){
+            throwError(WHERE_AM_I + " " + filename + ": negative length " + str(len));
+        }
+        cols = (Index)len;
+        offset = sizeof(int64);
+    }
+    //** compare by division, the stored lengths can overflow the product
+    Index rest = mf->size() - offset;
+    Index rowSize = rows * sizeof(ValueType);
+    if (rows == 0 ? rest != 0 : (rest % rowSize != 0 || cols != rest / rowSize)){
+        throwError(WHERE_AM_I + " " + filename + ": size invalid. rows: "
+                   + str(rows) + " cols: " + str(cols) + " fsize: "
+                   + str(mf->size()));
+    }
+    if (!rows_.empty() && cols != cols_){
+        throwError(WHERE_AM_I + " " + filename + ": row length " + str(cols)
+                   + " differs from " + str(cols_));
+    }
+    cols_ = cols;
+
+    const ValueType * vals = mf->at< ValueType >(offset, rows * cols);
+    for (Index i = 0; i < rows; i ++) rows_.push_back(vals + i * cols);
+}
+
+template < class ValueType > Vector < ValueType >
+MappedMatrix< ValueType >::row(Index i) const {
+    const ValueType * r = rowData(i);
+    Vector < ValueType > ret(cols_);
+    if (cols_ > 0) std::memcpy(&ret[0], r, cols_ * sizeof(ValueType));
+    return ret;
+}
+
+template < class ValueType > Vector < ValueType >
+MappedMatrix< ValueType >::col(Index i) const {
+    ASSERT_RANGE(i, 0, cols())
+    Vector < ValueType > ret(rows());
+    for (Index j = 0; j < rows(); j ++) ret[j] = rows_[j][i];
+    return ret;
+}
+
+template < class ValueType > Vector < ValueType >
+MappedMatrix< ValueType >::mult(const Vector < ValueType > & b) const {
+    return this->mult(b, 0, b.size());
+}
+
+template < class ValueType > Vector < ValueType >
+MappedMatrix< ValueType >::mult(const Vector < ValueType > & b,
+                                Index startI, Index endI) const {
+    if (endI - startI != cols_ || endI > b.size()) {
+        throwLengthError(WHERE_AM_I + " " + str(cols_) + " != "
+                         + str(endI) + "-" + str(startI));
+    }
+    SIndex nRows = rows();
+    Vector < ValueType > ret(nRows, ValueType(0.0));
+    const ValueType * x = &b[startI];
+
+#pragma omp parallel for schedule(static) if (useOMP() && nRows > 64)
+    for (SIndex i = 0; i < nRows; i ++){
+        const ValueType * r = rows_[i];
+        ValueType s(0.0);
+        for (Index j = 0; j < cols_; j ++) s += r[j] * x[j];
+        ret[i] = s;
+    }
+    return ret;
+}
+
+template < class ValueType > Vector < ValueType >
+MappedMatrix< ValueType >::transMult(const Vector < ValueType > & b) const {
+    if (b.size() != rows()) {
+        throwLengthError(WHERE_AM_I + " " + str(rows()) + " != " + str(b.size()));
+    }
+    Vector < ValueType > ret(cols_, ValueType(0.0));
+
+    //** every thread sums over all rows for its own block of columns
+    Index blockSize = 4096;
+    SIndex nBlocks = (cols_ + blockSize - 1) / blockSize;
+
+#pragma omp parallel for schedule(dynamic) if (useOMP() && nBlocks > 1)
+    for (SIndex k = 0; k < nBlocks; k ++){
+        Index start = k * blockSize;
+        Index end = std::min(start + blockSize, cols_);
+        ValueType * y = &ret[0];
+        for (Index i = 0; i < rows(); i ++){
+            const ValueType * r = rows_[i];
+            const ValueType bi = b[i];
+            for (Index j = start; j < end; j ++) y[j] += r[j] * bi;
+        }
+    }
+    return ret;
+}
+
+template < class ValueType >
+void MappedMatrix< ValueType >::toMatrix(Matrix < ValueType > & A) const {
+    A.resize(rows(), cols_);
+    for (Index i = 0; i < rows(); i ++){
+        if (cols_ > 0) std::memcpy(&A[i][0], rows_[i], cols_ * sizeof(ValueType));
+    }
+    A.rowFlag().fill(1);
+}
+
+template < class ValueType >
+void MappedMatrix< ValueType >::save(const std::string & filename) const {
+    std::string fname(filename);
+    if (fname.rfind('.') == std::string::npos) fname += MATRIXBINSUFFIX;
+
+    FILE *file; file = fopen(fname.c_str(), "w+b");
+    if (!file){
+        throwError(WHERE_AM_I + " " + fname + ": " + strerror(errno));
+    }
+    uint32 dim[2] = {(uint32)rows(), (uint32)cols_};
+    Index ret = fwrite(dim, sizeof(uint32), 2, file);
+    for (Index i = 0; i < rows() && ret > 0; i ++){
+        if (cols_ > 0) ret = fwrite(rows_[i], sizeof(ValueType), cols_, file);
+    }
+    fclose(file);
+    if (ret == 0) throwError(WHERE_AM_I + " fail writing file " + fname);
+}
+
+template class MappedMatrix< double >;
+template class MappedMatrix< Complex >;
+
+} // namespace GIMLI
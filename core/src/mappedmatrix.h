@@ -0,0 +1,103 @@
+/******************************************************************************
+ *   Copyright (C) 2012-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_MAPPEDMATRIX__H
+#define _GIMLI_MAPPEDMATRIX__H
+
+#include "gimli.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace GIMLI{
+
+//! Read-only dense matrix view on binary matrix or vector files.
+/*! The values are not loaded into memory but used in place from a
+ * memory mapped file (\ref MappedFile), so large saved Jacobians or
+ * primary potentials can be reused without the need to hold them in RAM.
+ * Pages are read by the operating system on first access.
+ *
+ * A view can be created from a single matrix file
+ * (see \ref saveMatrix, rows(uint32) cols(uint32) vals(rows*cols))
+ * or from a series of binary vector files
+ * (see \ref Vector::save, size(int64) vals(size)) where every file
+ * becomes one row, following the naming scheme of \ref loadMatrixVectorsBin.
+ * All rows need to have the same length. */
+template < class ValueType > class DLLEXPORT MappedMatrix : public MatrixBase {
+public:
+    /*! Map the single binary matrix file filename. */
+    MappedMatrix(const std::string & filename);
+
+    /*! Map the binary vector files filenameBody.0 .. filenameBody.n (with or
+     * without .pot suffix) as rows. kCount is used as sub counter like in
+     * \ref loadMatrixVectorsBin. */
+    MappedMatrix(const std::string & filenameBody, Index kCount);
+
+    virtual ~MappedMatrix();
+
+    /*! Return entity rtti value. */
+    virtual uint rtti() const { return GIMLI_MAPPEDMATRIX_RTTI; }
+
+    virtual Index rows() const { return rows_.size(); }
+
+    virtual Index cols() const { return cols_; }
+
+    /*! Return pointer to the first value of row i. */
+    inline const ValueType * rowData(Index i) const {
+        ASSERT_RANGE(i, 0, rows())
+        return rows_[i];
+    }
+
+    /*! Return a copy of row i. */
+    Vector < ValueType > row(Index i) const;
+
+    /*! Return a copy of column i. */
+    Vector < ValueType > col(Index i) const;
+
+    /*! Return this * b */
+    virtual Vector < ValueType > mult(const Vector < ValueType > & b) const;
+
+    /*! Return this * b[startI, endI) */
+    virtual Vector < ValueType > mult(const Vector < ValueType > & b,
+                                      Index startI, Index endI) const;
+
+    /*! Return this.T * b */
+    virtual Vector < ValueType > transMult(const Vector < ValueType > & b) const;
+
+    /*! Copy the content into the dense matrix A. */
+    void toMatrix(Matrix < ValueType > & A) const;
+
+    /*! Save a copy in the single binary matrix format. */
+    virtual void save(const std::string & filename) const;
+
+protected:
+    void addFile_(const std::string & filename, bool matrix);
+
+    std::vector < MappedFile * > files_;
+    std::vector < const ValueType * > rows_;
+    Index cols_;
+
+private:
+    /*! Copy constructor is private, so don't use it */
+    MappedMatrix(const MappedMatrix &){};
+    /*! Assignment operator is private, so don't use it */
+    void operator = (const MappedMatrix &){ };
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_MAPPEDMATRIX__H
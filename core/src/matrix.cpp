@@ -23,6 +23,9 @@
 #include "matrix.h"
 #include "vector.h"
 #include "stopwatch.h"
+#include "mappedfile.h"
+
+#include <cstring>
 
 #if OPENBLAS_CBLAS_FOUND
     #include <cblas.h>
@@ -295,41 +298,25 @@ template < class ValueType >
 bool loadMatrixSingleBin_T(Matrix < ValueType > & A,
                           const std::string & filename){
 
-    std::ifstream testFile(filename, std::ios::binary);
-    const auto begin = testFile.tellg();
-    testFile.seekg (0, std::ios::end);
-    const auto end = testFile.tellg();
-    SIndex fsize = (end-begin);
-    testFile.close();
-    FILE *file; file = fopen(filename.c_str(), "r+b");
-    if (!file) {
-        throwError(WHERE_AM_I + " " +
-                   filename + ": " + strerror(errno));
-    }
-
-    Index ret;
-    uint32 rows = 0;
-    ret = fread(&rows, sizeof(uint32), 1, file);
-    if (ret == 0) throwError("fail reading file " + filename);
-    uint32 cols = 0;
-    ret = fread(&cols, sizeof(uint32), 1, file);
-    if (ret == 0) throwError("fail reading file " + filename);
+    //** read through a mapping instead of value by value fread
+    MappedFile file(filename);
+    const uint32 * dim = file.at< uint32 >(0, 2);
+    uint32 rows = dim[0];
+    uint32 cols = dim[1];
 
-    if ((SIndex)(rows*cols*sizeof(ValueType) + 2*sizeof(uint32)) != fsize){
-        __MS("rows: " << str(rows) << " cols: " <<  str(cols) << " fsize: " << str(fsize))
+    if (Index(rows) * cols * sizeof(ValueType) + 2 * sizeof(uint32) != file.size()){
+        __MS("rows: " << str(rows) << " cols: " <<  str(cols) << " fsize: " << str(file.size()))
         __MS(" filesize needed: " << str(rows*cols*sizeof(ValueType)+2*sizeof(uint32)))
-        fclose(file);
         throwError(WHERE_AM_I + " " + filename + ": size invalid");
     }
 
+    const ValueType * vals = file.at< ValueType >(2 * sizeof(uint32),
+                                                  Index(rows) * cols);
     A.resize(rows, cols);
     for (uint32 i = 0; i < rows; i ++){
-        for (uint32 j = 0; j < cols; j ++){
-            ret = fread((char*)&A[i][j], sizeof(ValueType), 1, file);
-            if (ret == 0) throwError("fail reading file " + filename);
-        }
+        if (cols > 0) std::memcpy(&A[i][0], vals + Index(i) * cols,
+                                  cols * sizeof(ValueType));
     }
-    fclose(file);
     A.rowFlag().fill(1);
     return true;
 }
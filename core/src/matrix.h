@@ -609,6 +609,15 @@ public:
             std::memcpy(&mat_[i][0], &src[i*n], sizeof(ValueType) * n);
         }
     }
+
+    /*! Use the row-major values at src as matrix content without copying
+     * them. Every row becomes a view, see \ref Vector::attach. */
+    void attach(ValueType * src, Index m, Index n){
+        mat_.clear();
+        mat_.resize(m);
+        for (Index i = 0; i < m; i ++) mat_[i].attach(&src[i*n], n);
+        rowFlag_.resize(m);
+    }
 protected:
 
     void allocate_(Index rows, Index cols){
@@ -812,9 +821,7 @@ bool saveMatrix(const Matrix < ValueType > & A, const std::string & filename, IO
     ret = fwrite(& cols, sizeof(uint32), 1, file);
 
     for (uint i = 0; i < rows; i ++){
-        for (uint j = 0; j < cols; j ++){
-            ret = fwrite(&A[i][j], sizeof(ValueType), 1, file);
-        }
+        if (cols > 0) ret = fwrite(&A[i][0], sizeof(ValueType), cols, file);
     }
     fclose(file);
     return true;
@@ -19,6 +19,7 @@
 #include "memwatch.h"
 #include "stopwatch.h"
 
+#include <fstream>
 #include <iostream>
 
 #ifdef WIN32_LEAN_AND_MEAN
@@ -90,6 +91,11 @@ double MemWatch::inUse() {
 //      __MS("rss: " << usage.rss/1024)
     double ret = MByte(usage.vsize);
     return ret;
+#elif defined(__linux__)
+    // no libproc, first field of statm is the size in pages as vsize above
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    if (statm >> pages) return MByte(pages * sysconf(_SC_PAGE_SIZE));
 #else
     // no windows and no libproc
 #endif
@@ -101,7 +107,7 @@ double MemWatch::inUse() {
 
 void MemWatch::info(const std::string & str){
     if (debug()){
-#if defined(WIN32_LEAN_AND_MEAN) || USE_PROC_READPROC
+#if defined(WIN32_LEAN_AND_MEAN) || USE_PROC_READPROC || defined(__linux__)
         std::cout << "\t" << str << " Memory "
 #if USE_BOOST_THREAD
                     << "(mt)"
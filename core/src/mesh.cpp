@@ -24,14 +24,20 @@
 #include "meshentities.h"
 #include "node.h"
 #include "plane.h"
+#include "profiler.h"
 #include "shape.h"
 #include "sparsematrix.h"
 #include "stopwatch.h"
 
+#include <algorithm>
 #include <map>
+#include <mutex>
 
 namespace GIMLI{
 
+//** guards the lazy build of the node cell averaging operators
+static std::mutex __GIMLIMeshInterpolationCacheMutex__;
+
 std::ostream & operator << (std::ostream & str, const Mesh & mesh){
     str << "\tNodes: " << mesh.nodeCount() << "\tCells: " << mesh.cellCount() << "\tBoundaries: " << mesh.boundaryCount();
     return str;
@@ -47,6 +53,9 @@ Mesh::Mesh(Index dim, bool isGeometry)
 
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellToNodeCache_ = 0;
+    cellToNodeWeightedCache_ = 0;
+    nodeToCellCache_ = 0;
 }
 
 Mesh::Mesh(const std::string & filename, bool createNeighborInfos)
@@ -58,6 +67,9 @@ Mesh::Mesh(const std::string & filename, bool createNeighborInfos)
     dimension_ = 3;
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellToNodeCache_ = 0;
+    cellToNodeWeightedCache_ = 0;
+    nodeToCellCache_ = 0;
     load(filename, createNeighborInfos);
 }
 
@@ -70,6 +82,9 @@ Mesh::Mesh(const Mesh & mesh)
 
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellToNodeCache_ = 0;
+    cellToNodeWeightedCache_ = 0;
+    nodeToCellCache_ = 0;
     copy_(mesh);
 }
 
@@ -86,6 +101,8 @@ void Mesh::copy_(const Mesh & mesh){
     dimension_ = mesh.dim();
     nodeVector_.reserve(mesh.nodeCount());
     secNodeVector_.reserve(mesh.secondaryNodeCount());
+    nodeArena_.reserve((mesh.nodeCount() + mesh.secondaryNodeCount())
+                       * sizeof(Node));
 
     for (Index i = 0; i < mesh.nodeCount(); i ++){
         this->createNode(mesh.node(i));
@@ -141,30 +158,174 @@ void Mesh::clear(){
         tree_ = nullptr;
     }
 
-    for_each(cellVector_.begin(), cellVector_.end(), deletePtr());
+    //** entities live in the arenas, so only destroy them here
+    for (auto * c: cellVector_) c->~Cell();
     cellVector_.clear();
+    cellArena_.clear();
 
-    for_each(boundaryVector_.begin(), boundaryVector_.end(), deletePtr());
+    for (auto * b: boundaryVector_) b->~Boundary();
     boundaryVector_.clear();
+    boundaryArena_.clear();
 
-    for_each(nodeVector_.begin(), nodeVector_.end(), deletePtr());
+    for (auto * n: nodeVector_) n->~Node();
     nodeVector_.clear();
 
-    for_each(secNodeVector_.begin(), secNodeVector_.end(), deletePtr());
+    for (auto * n: secNodeVector_) n->~Node();
     secNodeVector_.clear();
+    nodeArena_.clear();
 
     if (cellToBoundaryInterpolationCache_){
         delete cellToBoundaryInterpolationCache_;
+        cellToBoundaryInterpolationCache_ = 0;
     }
+    topologyChanged_();
+    boundIndex_.clear();
 
     rangesKnown_ = false;
     neighborsKnown_ = false;
 }
 
+void EntityArena::newSlab_(Index minSize){
+    //** grow geometrically from 64 KiB up to 64 MiB per block
+    nextSize_ = std::min(std::max(nextSize_ * 2, Index(1) << 16), Index(1) << 26);
+    Index size = std::max(nextSize_, minSize);
+    slabs_.push_back(static_cast< char * >(::operator new(size)));
+    pos_ = 0;
+    capacity_ = size;
+    allocated_ += size;
+}
+
+void * EntityArena::allocate_(Index size, Index align){
+    Index start = (pos_ + align - 1) / align * align;
+    if (slabs_.empty() || start + size > capacity_){
+        newSlab_(size + align);
+        start = 0;
+    }
+    pos_ = start + size;
+    return slabs_.back() + start;
+}
+
+void EntityArena::reserve(Index nBytes){
+    if (slabs_.empty() || pos_ + nBytes > capacity_) newSlab_(nBytes);
+}
+
+void EntityArena::clear(){
+    for (auto * s: slabs_) ::operator delete(s);
+    slabs_.clear();
+    pos_ = 0;
+    capacity_ = 0;
+    nextSize_ = 0;
+    allocated_ = 0;
+}
+
+namespace {
+
+inline void boundaryBox_(const Boundary * b, RVector3 & min, RVector3 & max){
+    min = b->node(0).pos();
+    max = min;
+    for (Index i = 1; i < b->nodeCount(); i ++){
+        const RVector3 & p = b->node(i).pos();
+        for (Index d = 0; d < 3; d ++){
+            min[d] = std::min(min[d], p[d]);
+            max[d] = std::max(max[d], p[d]);
+        }
+    }
+    //** the touch checks use a tolerance
+    double pad = 1e-6 * std::max(1.0, min.distance(max));
+    for (Index d = 0; d < 3; d ++){
+        min[d] -= pad;
+        max[d] += pad;
+    }
+}
+
+} // namespace
+
+void BoundaryBoxIndex::clear(){
+    cells_.clear();
+    large_.clear();
+    cellSize_ = 0.0;
+    count_ = 0;
+}
+
+void BoundaryBoxIndex::build(const std::vector< Boundary * > & bounds){
+    this->clear();
+    RVector3 min, max;
+    double sum = 0.0;
+    for (auto * b: bounds){
+        boundaryBox_(b, min, max);
+        sum += std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+    }
+    //** a grid cell should hold a few boundaries of mean size
+    cellSize_ = bounds.size() ? 2.0 * sum / bounds.size() : 1.0;
+    if (cellSize_ <= 0.0) cellSize_ = 1.0;
+
+    cells_.reserve(bounds.size());
+    for (auto * b: bounds) this->insert(b);
+}
+
+SIndex BoundaryBoxIndex::grid_(double v) const {
+    return (SIndex)std::floor(v / cellSize_);
+}
+
+uint64 BoundaryBoxIndex::key_(SIndex i, SIndex j, SIndex k) const {
+    //** collisions only give more candidates
+    uint64 h = (uint64)i * 0x9e3779b97f4a7c15ULL;
+    h ^= (uint64)j * 0xbf58476d1ce4e5b9ULL + (h << 6) + (h >> 2);
+    h ^= (uint64)k * 0x94d049bb133111ebULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+void BoundaryBoxIndex::insert(Boundary * b){
+    if (cellSize_ <= 0.0) cellSize_ = 1.0;
+    RVector3 min, max;
+    boundaryBox_(b, min, max);
+
+    std::pair< Index, Boundary * > entry(count_, b);
+    count_ ++;
+
+    SIndex i0 = grid_(min[0]), i1 = grid_(max[0]);
+    SIndex j0 = grid_(min[1]), j1 = grid_(max[1]);
+    SIndex k0 = grid_(min[2]), k1 = grid_(max[2]);
+
+    if ((i1 - i0 + 1) * (j1 - j0 + 1) * (k1 - k0 + 1) > 64){
+        large_.push_back(entry);
+        return;
+    }
+    for (SIndex i = i0; i <= i1; i ++){
+        for (SIndex j = j0; j <= j1; j ++){
+            for (SIndex k = k0; k <= k1; k ++){
+                cells_[key_(i, j, k)].push_back(entry);
+            }
+        }
+    }
+}
+
+void BoundaryBoxIndex::candidates(const RVector3 & pos,
+                                  std::vector< Boundary * > & ret) const {
+    ret.clear();
+    if (count_ == 0) return;
+
+    std::vector< std::pair< Index, Boundary * > > c(large_);
+    auto it = cells_.find(key_(grid_(pos[0]), grid_(pos[1]), grid_(pos[2])));
+    if (it != cells_.end()) c.insert(c.end(), it->second.begin(), it->second.end());
+
+    std::sort(c.begin(), c.end());
+    c.erase(std::unique(c.begin(), c.end()), c.end());
+
+    RVector3 min, max;
+    for (auto & e: c){
+        boundaryBox_(e.second, min, max);
+        if (pos[0] >= min[0] && pos[0] <= max[0] &&
+            pos[1] >= min[1] && pos[1] <= max[1] &&
+            pos[2] >= min[2] && pos[2] <= max[2]) ret.push_back(e.second);
+    }
+}
+
 Node * Mesh::createNode_(const RVector3 & pos, int marker){
     rangesKnown_ = false;
+    topologyChanged_();
     Index id = nodeCount();
-    nodeVector_.push_back(new Node(pos));
+    nodeVector_.push_back(nodeArena_.create< Node >(pos));
     nodeVector_.back()->setMarker(marker);
     nodeVector_.back()->setId(id);
     return nodeVector_.back();
@@ -183,9 +344,12 @@ Node * Mesh::createNodeGC_(const RVector3 & pos, int marker){
 
         if ((this->dim() == 3) and (this->nodeCount() > oldCount)){
 
-            for (auto *b: this->boundaryVector_){
-            // for (Index i = 0; i < this->boundaryVector_.size(); i ++ ){
-            //     Boundary *b = this->boundaryVector_[i];
+            //** only faces whose bounding box contains the node can touch it
+            std::vector< Boundary * > bounds;
+            this->fillBoundaryIndex_();
+            boundIndex_.candidates(n->pos(), bounds);
+
+            for (auto *b: bounds){
                 // __MS(b->rtti())
                 if (b->rtti() == MESH_POLYGON_FACE_RTTI){
                     // __MS(pos)
@@ -233,7 +397,7 @@ Node & Mesh::secondaryNode(Index i) const {
 
 Node * Mesh::createSecondaryNode_(const RVector3 & pos){
     Index id = this->secondaryNodeCount();
-    secNodeVector_.push_back(new Node(pos));
+    secNodeVector_.push_back(nodeArena_.create< Node >(pos));
     secNodeVector_.back()->setId(this->nodeCount() + id);
     return secNodeVector_.back();
 }
@@ -284,9 +448,13 @@ Node * Mesh::createNodeWithCheck(const RVector3 & pos, double tol, bool warn, bo
             if (warn || debug()) log(LogType::Warning,
                 "edgeCheck is currently only supported for 2d meshes");
         } else {
-            ///// TODO refaktor in extra function
-            for (Index i = 0; i < this->boundaryVector_.size(); i ++ ){
-                Boundary *b = this->boundaryVector_[i];
+            //** only edges whose bounding box contains the node can be split
+            std::vector< Boundary * > bounds;
+            this->fillBoundaryIndex_();
+            boundIndex_.candidates(newNode->pos(), bounds);
+
+            for (Index i = 0; i < bounds.size(); i ++ ){
+                Boundary *b = bounds[i];
                 if (b->rtti() == MESH_EDGE_RTTI){
                     int pIn;
                     Line(b->node(0).pos(), b->node(1).pos()).touch1(newNode->pos(), pIn);
@@ -943,6 +1111,7 @@ Cell * Mesh::findCell(const RVector3 & pos, size_t & count,
         
             //         exportVTK("slopesearch");
             //         exit(0);
+            GIMLI_PROFILE_COUNT("Mesh::findCell slope search", 1);
             cell = findCellBySlopeSearch_(pos, *refNode->cellSet().begin(),
                                           count, false);
             if (cell) return cell;
@@ -953,6 +1122,7 @@ Cell * Mesh::findCell(const RVector3 & pos, size_t & count,
             }
         }
 
+        GIMLI_PROFILE_COUNT("Mesh::findCell misses", 1);
         if (extensive || 0){
 //             __M
 //             std::cout << "More expensive test here" << std::endl;
@@ -1185,6 +1355,7 @@ IndexArray Mesh::nodeIDs(bool withSecNodes) const{
     return ids;
 }
 void Mesh::setNodeIDs(IndexArray & ids){
+    topologyChanged_();
     for (Index i = 0; i < ids.size(); i ++) {
         nodeVector_[i]->setId(ids[i]);
     }
@@ -1264,6 +1435,7 @@ PosVector & Mesh::boundarySizedNormals() const {
 }
 
 void Mesh::sortNodes(const IndexArray & perm){
+    topologyChanged_();
 
     for (Index i = 0; i < nodeVector_.size(); i ++) nodeVector_[i]->setId(perm[i]);
   //    sort(nodeVector_.begin(), nodeVector_.end(), std::less< int >(mem_fn(&BaseEntity::id)));
@@ -1272,6 +1444,7 @@ void Mesh::sortNodes(const IndexArray & perm){
 
 void Mesh::recountNodes(){
     __MS("is in use?")
+    topologyChanged_();
     for (Index i = 0; i < nodeVector_.size(); i ++) nodeVector_[i]->setId(i);
 }
 
@@ -1644,21 +1817,246 @@ void Mesh::cleanNeighborInfos(){
     }
 }
 
+namespace {
+
+//! One cell face for the face hash.
+struct FaceEntry_ {
+    uint64 hash;
+    Index cell;
+    Index face;
+    bool operator < (const FaceEntry_ & e) const {
+        if (hash != e.hash) return hash < e.hash;
+        if (cell != e.cell) return cell < e.cell;
+        return face < e.face;
+    }
+};
+
+/*! Number of corner nodes for a face of the cell c with nNodes nodes, the
+ * corners come first. The face dimension follows from the cell shape and
+ * not from the mesh dimension. Same face types as in
+ * \ref Mesh::createBoundary. */
+inline Index faceCorners_(const Cell & c, Index nNodes){
+    int faceDim = c.shape().dim() - 1;
+    if (faceDim < 2) return faceDim + 1;
+    switch (nNodes){
+        case 6: return 3;
+        case 8: return 4;
+        default: return nNodes;
+    }
+}
+
+/*! Sorted corner node ids of a face, i.e., the key for the face hash.
+ * Quadratic boundaries are found for the linear faces of their cells,
+ * like findBoundary does. */
+inline void faceKey_(const std::vector < Node * > & nodes, Index nCorners,
+                     std::vector < Index > & key){
+    key.resize(nCorners);
+    for (Index i = 0; i < nCorners; i ++) key[i] = nodes[i]->id();
+    std::sort(key.begin(), key.end());
+}
+
+inline uint64 faceHash_(const std::vector < Index > & key){
+    uint64 h = key.size();
+    for (Index i = 0; i < key.size(); i ++){
+        uint64 x = key[i] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        h ^= x ^ (x >> 31);
+    }
+    return h;
+}
+
+} // namespace
+
 void Mesh::createNeighborInfos(bool force){
     if (!neighborsKnown_ || force){
         this->cleanNeighborInfos();
 
-//         Stopwatch sw(true);
+        //** polygon faces can contain the faces of their cells, this needs the
+        //** old node based search
+        bool polyFaces = false;
+        for (auto * b: boundaryVector_){
+            if (b->rtti() == MESH_POLYGON_FACE_RTTI) { polyFaces = true; break; }
+        }
 
-        for (Index i = 0; i < cellCount(); i ++){
-            createNeighborInfosCell_(&cell(i));
+        if (polyFaces){
+            for (Index i = 0; i < cellCount(); i ++){
+                createNeighborInfosCell_(&cell(i));
+            }
+        } else {
+            createNeighborInfosHashed_();
         }
         neighborsKnown_ = true;
-    } else {
-//         __M
+    }
+}
+
+Index Mesh::createNeighborInfosHashed_(){
+    //** Same result as createNeighborInfosCell_ for all cells, but faces
+    //** are matched by sorted node ids instead of intersecting the node
+    //** cell and boundary sets.
+    SIndex nCells = cellCount();
+    std::vector < Index > faceStart(nCells + 1, 0);
+    for (SIndex i = 0; i < nCells; i ++){
+        faceStart[i + 1] = faceStart[i] + cellVector_[i]->boundaryCount();
+    }
+    Index nFaces = faceStart[nCells];
+    std::vector < FaceEntry_ > faces(nFaces);
+
+    #pragma omp parallel if (useOMP() && nCells > 1000)
+    {
+        std::vector < Index > key;
+        #pragma omp for schedule(static)
+        for (SIndex i = 0; i < nCells; i ++){
+            Cell * c = cellVector_[i];
+            for (Index j = 0; j < c->boundaryCount(); j ++){
+                std::vector < Node * > nodes(c->boundaryNodes(j));
+                faceKey_(nodes, faceCorners_(*c, nodes.size()), key);
+                FaceEntry_ & e = faces[faceStart[i] + j];
+                e.hash = faceHash_(key);
+                e.cell = i;
+                e.face = j;
+            }
+        }
+    }
+    std::sort(faces.begin(), faces.end());
+
+    //** group equal faces, split groups with a hash collision
+    std::vector < Index > groupStart;
+    std::vector < Index > groupOf(nFaces);
+    groupStart.reserve(nFaces / 2 + 1);
+    {
+        std::vector < Index > key, keyJ;
+        Index i = 0;
+        while (i < nFaces){
+            Index end = i + 1;
+            while (end < nFaces && faces[end].hash == faces[i].hash) end ++;
+
+            bool same = (end - i == 2);
+            if (same){
+                //** the common case, a face shared by two cells
+                std::vector < Node * > n0(cellVector_[faces[i].cell]->boundaryNodes(faces[i].face));
+                std::vector < Node * > n1(cellVector_[faces[i + 1].cell]->boundaryNodes(faces[i + 1].face));
+                faceKey_(n0, faceCorners_(*cellVector_[faces[i].cell], n0.size()), key);
+                faceKey_(n1, faceCorners_(*cellVector_[faces[i + 1].cell], n1.size()), keyJ);
+                same = (key == keyJ);
+            }
+
+            if (end - i > 1 && !same){
+                //** verify the keys and bring equal keys together
+                std::vector < std::vector < Index > > keys(end - i);
+                for (Index k = i; k < end; k ++){
+                    std::vector < Node * > nodes(
+                        cellVector_[faces[k].cell]->boundaryNodes(faces[k].face));
+                    faceKey_(nodes, faceCorners_(*cellVector_[faces[k].cell], nodes.size()),
+                             keys[k - i]);
+                }
+                std::vector < Index > perm(end - i);
+                for (Index k = 0; k < perm.size(); k ++) perm[k] = k;
+                std::stable_sort(perm.begin(), perm.end(),
+                                 [&keys](Index a, Index b){ return keys[a] < keys[b]; });
+                std::vector < FaceEntry_ > tmp(faces.begin() + i, faces.begin() + end);
+                for (Index k = 0; k < perm.size(); k ++){
+                    faces[i + k] = tmp[perm[k]];
+                    if (k == 0 || keys[perm[k]] != keys[perm[k - 1]]){
+                        groupStart.push_back(i + k);
+                    }
+                }
+            } else {
+                groupStart.push_back(i);
+            }
+            i = end;
+        }
+        groupStart.push_back(nFaces);
+
+        for (Index g = 0; g + 1 < groupStart.size(); g ++){
+            for (Index k = groupStart[g]; k < groupStart[g + 1]; k ++){
+                groupOf[faceStart[faces[k].cell] + faces[k].face] = g;
+            }
+        }
+    }
+
+    //** already existing boundaries, hashed the same way
+    std::vector < std::pair< uint64, Index > > bounds(boundaryCount());
+    {
+        std::vector < Index > key;
+        for (Index i = 0; i < bounds.size(); i ++){
+            Boundary * b = boundaryVector_[i];
+            faceKey_(b->nodes(), b->shape().nodeCount(), key);
+            bounds[i] = std::make_pair(faceHash_(key), i);
+        }
+        std::sort(bounds.begin(), bounds.end());
     }
 
-//     std::cout << med << " " << med/cellCount() << std::endl;
+    std::vector < Boundary * > groupBound(groupStart.size(), 0);
+    std::vector < Index > key, keyB;
+    Index nNonManifold = 0;
+
+    for (SIndex i = 0; i < nCells; i ++){
+        Cell * c = cellVector_[i];
+
+        for (Index j = 0; j < c->boundaryCount(); j ++){
+            Index e = faceStart[i] + j;
+            Index g = groupOf[e];
+
+            //** a face shared by exactly two cells gives the neighbor
+            Cell * neighbor = 0;
+            if (groupStart[g + 1] - groupStart[g] == 2){
+                const FaceEntry_ & f0 = faces[groupStart[g]];
+                const FaceEntry_ & f1 = faces[groupStart[g] + 1];
+                Index n = (f0.cell == (Index)i && f0.face == j) ? f1.cell : f0.cell;
+                if (n != (Index)i) neighbor = cellVector_[n];
+            }
+            c->setNeighborCell(j, neighbor);
+
+            std::vector < Node * > nodes(c->boundaryNodes(j));
+            Boundary * bound = groupBound[g];
+
+            if (!bound){
+                faceKey_(nodes, faceCorners_(*c, nodes.size()), key);
+                uint64 h = faceHash_(key);
+                auto it = std::lower_bound(bounds.begin(), bounds.end(),
+                                           std::make_pair(h, Index(0)));
+                for (; it != bounds.end() && it->first == h; it ++){
+                    Boundary * b = boundaryVector_[it->second];
+                    faceKey_(b->nodes(), b->shape().nodeCount(), keyB);
+                    if (keyB == key) { bound = boundaryVector_[it->second]; break; }
+                }
+                if (!bound) bound = createBoundary(nodes, 0, false);
+                groupBound[g] = bound;
+            }
+
+            bool cellIsLeft = true;
+            if (bound->shape().nodeCount() == 2) {
+                cellIsLeft = (nodes[0]->id() == bound->node(0).id());
+            } else if (bound->shape().nodeCount() > 2) {
+                // normal vector of boundary shows outside for left cell ... every boundary needs a left cell
+                cellIsLeft = bound->normShowsOutside(*c);
+            }
+
+            if (bound->leftCell() == NULL && cellIsLeft) {
+                if (bound->rightCell() == c) continue;
+                bound->setLeftCell(c);
+                if (neighbor && bound->rightCell() == NULL) bound->setRightCell(neighbor);
+
+            } else if (bound->rightCell() == NULL){
+                if (bound->leftCell() == c) continue;
+                bound->setRightCell(c);
+                if (neighbor && bound->leftCell() == NULL) bound->setLeftCell(neighbor);
+            }
+
+            //** cross check: a third cell on an already paired face, i.e.,
+            //** a duplicated cell or a non-manifold face
+            if (((bound->leftCell() != c) && (bound->rightCell() != c)) ||
+                (bound->leftCell() == bound->rightCell())){
+                nNonManifold ++;
+            }
+        }
+    }
+    if (nNonManifold > 0){
+        log(Warning, "createNeighborInfos: faces of", nNonManifold,
+            "cells are already shared by two other cells (duplicated cells or non-manifold faces).");
+    }
+    return nNonManifold;
 }
 
 void Mesh::fixBoundaryDirections(){
@@ -2316,6 +2714,7 @@ void Mesh::prolongateEmptyCellsValues(RVector & vals, double background) const {
 }
 void Mesh::geometryChanged(){
     rangesKnown_ = false;
+    boundIndex_.clear();
     staticGeometry_ = false;
 }
 Mesh & Mesh::transform(const RMatrix & mat){
@@ -2550,6 +2949,19 @@ void Mesh::fillKDTree_() const {
     }
 }
 
+void Mesh::fillBoundaryIndex_() const {
+    //** boundaries are only appended, so index the new ones and rebuild
+    //** from time to time to adapt the grid size
+    Index n = boundaryCount();
+    if (boundIndex_.size() > n || n > 2 * boundIndex_.size() + 64){
+        boundIndex_.build(boundaryVector_);
+    } else {
+        for (Index i = boundIndex_.size(); i < n; i ++){
+            boundIndex_.insert(boundaryVector_[i]);
+        }
+    }
+}
+
 void Mesh::addRegionMarker(const RegionMarker & reg){
     regionMarker_.push_back(reg);
 }
@@ -2637,6 +3049,100 @@ RSparseMapMatrix & Mesh::cellToBoundaryInterpolation() const {
     return *cellToBoundaryInterpolationCache_;
 }
 
+void Mesh::topologyChanged_(){
+    if (cellToNodeCache_){
+        delete cellToNodeCache_;
+        cellToNodeCache_ = 0;
+    }
+    if (cellToNodeWeightedCache_){
+        delete cellToNodeWeightedCache_;
+        cellToNodeWeightedCache_ = 0;
+    }
+    if (nodeToCellCache_){
+        delete nodeToCellCache_;
+        nodeToCellCache_ = 0;
+    }
+}
+
+RSparseMatrix Mesh::createCellToNodeInterpolation(bool volumeWeighted) const {
+    //** count the cells per node, then fill the rows in cell order
+    std::vector < int > rowPtr(nodeCount() + 1, 0);
+    for (auto * c: cellVector_){
+        for (auto * n: c->nodes()) rowPtr[n->id() + 1] ++;
+    }
+    for (Index i = 0; i < nodeCount(); i ++) rowPtr[i + 1] += rowPtr[i];
+
+    std::vector < int > colIdx(rowPtr.back());
+    RVector vals(rowPtr.back());
+    std::vector < int > fill(rowPtr.begin(), rowPtr.end() - 1);
+    RVector weight(nodeCount(), 0.0);
+
+    RVector sizes;
+    if (volumeWeighted) sizes = this->cellSizes();
+    for (auto * c: cellVector_){
+        double w = volumeWeighted ? sizes[c->id()] : 1.0;
+        for (auto * n: c->nodes()){
+            int k = fill[n->id()] ++;
+            colIdx[k] = c->id();
+            vals[k] = w;
+            weight[n->id()] += w;
+        }
+    }
+    for (Index i = 0; i < nodeCount(); i ++){
+        //** nodes of degenerated cells only keep zero weights
+        if (weight[i] > 0.0){
+            for (int k = rowPtr[i]; k < rowPtr[i + 1]; k ++) vals[k] /= weight[i];
+        }
+    }
+    return RSparseMatrix(rowPtr, colIdx, vals, 0, cellCount());
+}
+
+const RSparseMatrix & Mesh::cellToNodeInterpolation(bool volumeWeighted) const {
+    if (volumeWeighted && !staticGeometry_){
+        throwError("The mesh geometry is not static, "
+                   "use createCellToNodeInterpolation(true) instead.");
+    }
+    RSparseMatrix *& cache = volumeWeighted ? cellToNodeWeightedCache_ : cellToNodeCache_;
+
+    std::lock_guard< std::mutex > lock(__GIMLIMeshInterpolationCacheMutex__);
+    if (cache && (cache->rows() != nodeCount() || cache->cols() != cellCount())){
+        delete cache;
+        cache = 0;
+    }
+
+    if (!cache){
+        cache = new RSparseMatrix(createCellToNodeInterpolation(volumeWeighted));
+    }
+    return *cache;
+}
+
+const RSparseMatrix & Mesh::nodeToCellInterpolation() const {
+    std::lock_guard< std::mutex > lock(__GIMLIMeshInterpolationCacheMutex__);
+    if (nodeToCellCache_ && (nodeToCellCache_->rows() != cellCount() ||
+                             nodeToCellCache_->cols() != nodeCount())){
+        delete nodeToCellCache_;
+        nodeToCellCache_ = 0;
+    }
+
+    if (!nodeToCellCache_){
+        std::vector < int > rowPtr(cellCount() + 1, 0);
+        for (auto * c: cellVector_) rowPtr[c->id() + 1] = c->nodeCount();
+        for (Index i = 0; i < cellCount(); i ++) rowPtr[i + 1] += rowPtr[i];
+
+        std::vector < int > colIdx(rowPtr.back());
+        RVector vals(rowPtr.back());
+        for (auto * c: cellVector_){
+            int k = rowPtr[c->id()];
+            for (auto * n: c->nodes()){
+                colIdx[k] = n->id();
+                vals[k ++] = 1.0 / c->nodeCount();
+            }
+        }
+        nodeToCellCache_ = new RSparseMatrix(rowPtr, colIdx, vals, 0, nodeCount());
+    }
+    return *nodeToCellCache_;
+}
+
 PosVector Mesh::cellDataToBoundaryGradient(const RVector & cellData) const {
     return cellDataToBoundaryGradient(cellData,
       boundaryDataToCellGradient(this->cellToBoundaryInterpolation()*cellData));
@@ -28,7 +28,10 @@
 #include <list>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <fstream>
+#include <new>
+#include <utility>
 
 namespace GIMLI{
 
@@ -123,6 +126,90 @@ inline std::ostream & operator << (std::ostream & str, const BoundingBox & bb){
     return str;
 }
 
+//! Slab allocator for mesh entities.
+/*! Entities are placed one after another into few large memory blocks
+ * instead of one heap allocation each. Entities of one kind sit contiguously
+ * in memory and creating, copying and destroying large meshes needs only a
+ * handful of allocations. The memory is released all at once with
+ * \ref clear, the owner has to call the entity destructors before. */
+class DLLEXPORT EntityArena {
+public:
+    EntityArena() : pos_(0), capacity_(0), nextSize_(0), allocated_(0) {}
+
+    ~EntityArena(){ clear(); }
+
+    /*! Construct a new T with args inside the arena. */
+    template < class T, class... Args > T * create(Args &&... args){
+        return new (allocate_(sizeof(T), alignof(T))) T(std::forward< Args >(args)...);
+    }
+
+    /*! Make sure the next nBytes can be taken from a single block. */
+    void reserve(Index nBytes);
+
+    /*! Release all memory blocks. Entities need to be destroyed before. */
+    void clear();
+
+    /*! Return the amount of reserved memory in byte. */
+    Index allocated() const { return allocated_; }
+
+protected:
+    void * allocate_(Index size, Index align);
+
+    void newSlab_(Index minSize);
+
+    std::vector< char * > slabs_;
+    Index pos_;
+    Index capacity_;
+    Index nextSize_;
+    Index allocated_;
+
+private:
+    /*! Copy constructor is private, so don't use it */
+    EntityArena(const EntityArena &){};
+    /*! Assignment operator is private, so don't use it */
+    void operator = (const EntityArena &){ };
+};
+
+//! Bounding box index for boundaries.
+/*! Uniform hashed grid over the bounding boxes of boundaries. Returns the
+ * boundaries that possibly touch a position without testing all of them.
+ * Boundaries can be added one by one. A boundary that shrinks after
+ * insertion (e.g., a split edge) stays in its old grid cells, which is
+ * harmless because the candidates need an exact test anyway. Boundaries
+ * much larger than the grid size are kept in an extra list and are always
+ * returned. */
+class DLLEXPORT BoundaryBoxIndex {
+public:
+    BoundaryBoxIndex() : cellSize_(0.0), count_(0) {}
+
+    /*! Rebuild the index for all bounds. The grid size is chosen from the
+     * mean boundary size. */
+    void build(const std::vector< Boundary * > & bounds);
+
+    /*! Add a single boundary to the index. */
+    void insert(Boundary * b);
+
+    /*! Fill ret with all boundaries whose bounding box contains pos,
+     * sorted by their position in the index. */
+    void candidates(const RVector3 & pos, std::vector< Boundary * > & ret) const;
+
+    /*! Return the number of indexed boundaries. */
+    Index size() const { return count_; }
+
+    /*! Remove all boundaries. */
+    void clear();
+
+protected:
+    uint64 key_(SIndex i, SIndex j, SIndex k) const;
+
+    SIndex grid_(double v) const;
+
+    double cellSize_;
+    Index count_;
+    std::unordered_map< uint64, std::vector< std::pair< Index, Boundary * > > > cells_;
+    std::vector< std::pair< Index, Boundary * > > large_;
+};
+
 DLLEXPORT std::ostream & operator << (std::ostream & str, const Mesh & mesh);
 
 class DLLEXPORT Mesh {
@@ -459,6 +546,12 @@ public:
     /*! Create and store boundaries and neighboring information for this cell.*/
     void createNeighborInfosCell_(Cell *c);
 
+    /*! Create all boundaries and neighboring information at once, with
+     * faces matched through a hash of their sorted node ids. Returns the
+     * number of cell faces found already paired by two other cells, i.e.,
+     * duplicated cells or non-manifold faces, which are also warned. */
+    Index createNeighborInfosHashed_();
+
     void relax();
 
     /*! Smooth the mesh via moving all free nodes into the average of all neighboring nodes. Repeat this smoothIteration times. There is currently only this smoothFunction. EdgeSwapping is deactivated.*/
@@ -541,6 +634,50 @@ public:
         If something goes wrong while reading, an exception is thrown. */
     void loadBinaryV2(const std::string & fbody);
 
+    /*! Save mesh in binary format v.4. Little endian, all counts and indices
+     * are 64 bit and every array is stored in its own 8 byte aligned section
+     * so the file can be memory mapped and used in place.
+     * If the neighbor infos of the mesh are known, they are stored too
+     * (cell neighbors, left and right cells of the boundaries) and don't need
+     * to be rebuilt after loading.
+     * If something goes wrong while writing, an exception is thrown.
+
+    Format:
+    \code
+    uint8[1] dimension
+    uint8[1] file format version (4)
+    uint8[1] isGeometry
+    uint8[1] flags (1: neighbor infos stored)
+    uint32[1] magic "GBMS"
+    uint64[8] counts: nNodes, nCells, nCellIdx, nCellNeighbors,
+                      nBounds, nBoundIdx, nData, fileSize
+    uint64[16] section offsets in byte from file start (0 if empty)
+    padding to 256 byte header
+    section 0:  double[3 * nNodes] coordinates (x, y, z)
+    section 1:  int32[nNodes] node markers
+    section 2:  uint64[nCells + 1] cell offsets into cell idx
+    section 3:  uint64[nCellIdx] cell node idx
+    section 4:  int32[nCells] cell markers
+    section 5:  int64[nCellNeighbors] neighbor cell idx for each cell
+                boundary in cell order (-1 for none)
+    section 6:  uint64[nBounds + 1] boundary offsets into boundary idx
+    section 7:  uint64[nBoundIdx] boundary node idx
+    section 8:  int32[nBounds] boundary markers
+    section 9:  int64[nBounds] left cell idx (-1 for none)
+    section 10: int64[nBounds] right cell idx (-1 for none)
+    section 11: nData times: uint64 name length, char[] name, padding,
+                uint64 data length, double[] data
+    \endcode
+    */
+    void saveBinaryV4(const std::string & fbody) const;
+
+    /*! Load mesh in binary format v.4 (see \ref saveBinaryV4).
+     * The file is memory mapped and the entities are created directly from
+     * the mapped arrays. Stored neighbor infos are restored so
+     * \ref createNeighborInfos becomes a no-op.
+     * If something goes wrong while reading, an exception is thrown. */
+    void loadBinaryV4(const std::string & fbody);
+
     int exportSimple(const std::string & fbody, const RVector & data) const ;
 
     /*! Very simple export filter. Write to file fileName:
@@ -575,24 +712,27 @@ public:
     /*! Export mesh with one additional array that will called 'arr' */
     void exportVTK(const std::string & fbody, const RVector & arr) const;
 
-    void readVTKPoints_(std::fstream & file, const std::vector < std::string > & row);
-    void readVTKCells_(std::fstream & file, const std::vector < std::string > & row);
-    void readVTKScalars_(std::fstream & file, const std::vector < std::string > & row);
-    void readVTKPolygons_(std::fstream & file, const std::vector < std::string > & row);
-
     /*! Export the mesh in filename using vtu format:
     Visualization Toolkit Unstructured Points Data (http://www.vtk.org)
-    Set binary to true writes the data content in binary format.
+    Set binary to true writes all arrays as appended binary data with
+    64 bit headers. compress packs them in zlib compressed blocks (if
+    libgimli is built with zlib) and base64 encodes the appended data so
+    the file stays valid XML.
     The file suffix .vtu will be added or substituted if .vtu or .vtk is found.
     \ref data, cell.markers and cell.attribute will be exported as data. */
-    void exportVTU(const std::string & filename, bool binary = false) const ;
+    void exportVTU(const std::string & filename, bool binary=false,
+                   bool compress=false, bool base64=false) const ;
 
     /*! Export the boundary of this mesh in vtu format: Visualization Toolkit Unstructured Points Data (http://www.vtk.org) Set Binary to true writes the datacontent in binary format. The file suffix .vtu will be added or substituted if .vtu or .vtk is found. */
-    void exportBoundaryVTU(const std::string & fbody, bool binary = false) const ;
+    void exportBoundaryVTU(const std::string & fbody, bool binary=false,
+                           bool compress=false) const ;
 
-    /*! Internal function for exporting VTU */
-    void addVTUPiece_(std::fstream & file, const Mesh & mesh,
-                        const std::map < std::string, RVector > & data) const;
+    /*! Export the mesh as parallel vtu: The cells are split into nPieces
+     * consecutive ranges, each written with its used nodes into
+     * fbody_i.vtu, and fbody.pvtu references all pieces.
+     * Format options see \ref exportVTU. */
+    void exportPVTU(const std::string & fbody, Index nPieces,
+                    bool binary=true, bool compress=false) const ;
 
     void exportAsTetgenPolyFile(const std::string & filename);
     //** end I/O stuff
@@ -708,6 +848,28 @@ public:
     /*! Return the reference to the matrix for cell value to boundary value interpolation matrix. */
     RSparseMapMatrix & cellToBoundaryInterpolation() const;
 
+    /*! Return the reference to the (nodeCount x cellCount) CRS matrix that
+     * averages cell values to the nodes, i.e., each node gets the mean of all
+     * cells sharing this node. With volumeWeighted the cells are weighted by
+     * their size. The sparsity pattern is the node to cell adjacency.
+     * Cached and rebuild if nodes are created or renumbered or cells are
+     * created. Building the cache is thread safe for const callers, but
+     * the mesh must not be changed meanwhile. The weighted variant needs
+     * a mesh with static geometry and throws otherwise, see
+     * \ref createCellToNodeInterpolation. */
+    const RSparseMatrix & cellToNodeInterpolation(bool volumeWeighted=false) const;
+
+    /*! Return a new matrix like \ref cellToNodeInterpolation without
+     * caching, e.g., for volume weights of a mesh with moving nodes.
+     * Nodes that only touch cells of zero size get zero weights. */
+    RSparseMatrix createCellToNodeInterpolation(bool volumeWeighted=false) const;
+
+    /*! Return the reference to the (cellCount x nodeCount) CRS matrix that
+     * averages node values to the cells, i.e., the transposed adjacency of
+     * \ref cellToNodeInterpolation scaled by the node count of each cell.
+     * Cached like \ref cellToNodeInterpolation. */
+    const RSparseMatrix & nodeToCellInterpolation() const;
+
     /*!Return the divergence for each cell of a given vector field for each
      * boundary.
      * The divergence is calculated by simple 1 point boundary integration
@@ -763,7 +925,7 @@ protected:
         std::vector < Node * > & nodes, int marker, int id){
 
         if (id == -1) id = boundaryCount();
-        boundaryVector_.push_back(new B(nodes));
+        boundaryVector_.push_back(boundaryArena_.create< B >(nodes));
         boundaryVector_.back()->setMarker(marker);
         boundaryVector_.back()->setId(id);
         return boundaryVector_.back();
@@ -787,12 +949,16 @@ protected:
         std::vector < Node * > & nodes, int marker, int id){
 
         if (id == -1) id = cellCount();
-        cellVector_.push_back(new C(nodes));
+        topologyChanged_();
+        cellVector_.push_back(cellArena_.create< C >(nodes));
         cellVector_.back()->setMarker(marker);
         cellVector_.back()->setId(id);
         return cellVector_.back();
     }
 
+    /*! Data map for vtu export including cell markers and attributes. */
+    std::map< std::string, RVector > vtuData_() const;
+
 //    Node * createRefinementNode_(Node * n0, Node * n1, SparseMapMatrix < Node *, Index > & nodeMatrix);
     Node * createRefinementNode_(Node * n0, Node * n1, std::map< std::pair < Index, Index >, Node * > & nodeMatrix);
 
@@ -802,11 +968,22 @@ protected:
 
     void fillKDTree_() const;
 
+    /*! Nodes or cells changed, drop the caches that depend on the topology. */
+    void topologyChanged_();
+
+    /*! Bring the boundary index up to date with boundaryVector_. */
+    void fillBoundaryIndex_() const;
+
     std::vector< Node * >     nodeVector_;
     std::vector< Node * >     secNodeVector_;
     std::vector< Boundary * > boundaryVector_;
     std::vector< Cell * >     cellVector_;
 
+    /*! Storage for the entities, they are never deleted one by one. */
+    EntityArena nodeArena_;
+    EntityArena boundaryArena_;
+    EntityArena cellArena_;
+
     uint dimension_;
 
     mutable RVector3 minRange_;
@@ -816,6 +993,7 @@ protected:
     bool neighborsKnown_;
 
     mutable KDTreeWrapper * tree_;
+    mutable BoundaryBoxIndex boundIndex_;
 
     /*! A static geometry mesh caches geometry informations. */
     bool staticGeometry_;
@@ -825,6 +1003,10 @@ protected:
     mutable PosVector boundarySizedNormCache_;
 
     mutable RSparseMapMatrix * cellToBoundaryInterpolationCache_;
+    /*! Node cell averaging operators, see \ref cellToNodeInterpolation. */
+    mutable RSparseMatrix * cellToNodeCache_;
+    mutable RSparseMatrix * cellToNodeWeightedCache_;
+    mutable RSparseMatrix * nodeToCellCache_;
 
     bool oldTet10NumberingStyle_;
 
@@ -21,12 +21,21 @@
 #include "matrix.h"
 #include "pos.h"
 #include "vectortemplates.h"
+#include "mappedfile.h"
 
 #include <map>
+#include <set>
 #include <fstream>
+#include <cctype>
+
+#if USE_ZLIB
+    #include <zlib.h>
+#endif
 
 namespace GIMLI{
 
+static bool isBinaryMeshV4_(const std::string & fbody);
+
 void Mesh::load(const std::string & fbody, bool createNeighbors, IOFormat format){
     if (fbody.find(".mod") != std::string::npos){
         importMod(fbody);
@@ -38,6 +47,8 @@ void Mesh::load(const std::string & fbody, bool createNeighbors, IOFormat format
         try {
              loadBinaryV2(fbody);
         } catch(std::exception & e){
+            //** v4 files are no v1 files, keep their validation errors
+            if (isBinaryMeshV4_(fbody)) throw;
             //std::cout << "Failed to loadBinary " << e.what() << std::endl;
             //std::cout << "try load bms.v2" << std::endl;
             loadBinary(fbody);
@@ -548,11 +559,19 @@ void Mesh::loadBinaryV2(const std::string & fbody) {
         throwError(WHERE_AM_I + " " + fileName + ": " + strerror(errno));
     }
     uint8 dim; readFromFile(file, dim);
+    uint8 version; readFromFile(file, version);
+
+    //** v4 checks its dimension itself and also knows 1D meshes
+    if (version == 4){
+        fclose(file);
+        return loadBinaryV4(fbody);
+    }
+
     if (dim !=2 && dim !=3){
+        fclose(file);
         throwError(WHERE_AM_I + " cannot determine dimension " + str(dim));
     }
     this->setDimension(dim);
-    uint8 version; readFromFile(file, version);
 
     if (version == 3){
         uint8 *dummy = new uint8[128]; readFromFile(file, dummy[0], 128);
@@ -647,6 +666,309 @@ void Mesh::loadBinaryV2(const std::string & fbody) {
     fclose(file);
 }
 
+static const uint32 MESHBINV4_MAGIC = 0x534D4247; // "GBMS"
+static const uint64 MESHBINV4_HEADERSIZE = 256;
+
+/*! Return true if the file starts with the header of format v.4. */
+static bool isBinaryMeshV4_(const std::string & fbody){
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    uint8 header[8];
+    if (!file.read((char*)header, 8)) return false;
+    uint32 magic; std::memcpy(&magic, header + 4, sizeof(uint32));
+    return header[1] == 4 && magic == MESHBINV4_MAGIC;
+}
+
+namespace {
+
+inline uint64 alignTo8_(uint64 offset){ return (offset + 7) & ~uint64(7); }
+
+template < class ValueType > void writeSectionToFile_(FILE * file,
+                                                      const std::vector < ValueType > & v){
+    if (v.size() > 0){
+        if (fwrite(&v[0], sizeof(ValueType), v.size(), file) != v.size()){
+            throwError(WHERE_AM_I + strerror(errno) + " " + str(errno));
+        }
+    }
+    uint64 nBytes = v.size() * sizeof(ValueType);
+    uint64 pad = alignTo8_(nBytes) - nBytes;
+    if (pad > 0){
+        uint8 zero[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        writeToFile(file, zero[0], pad);
+    }
+}
+
+} // namespace
+
+void Mesh::saveBinaryV4(const std::string & fbody) const {
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    Index nNodes = this->nodeCount();
+    Index nCells = this->cellCount();
+    Index nBounds = this->boundaryCount();
+
+    //** collect all arrays first so the section offsets are known
+    std::vector < double > coords(3 * nNodes);
+    std::vector < int32 > nodeMarker(nNodes);
+    for (Index i = 0; i < nNodes; i ++){
+        const RVector3 & p = nodeVector_[i]->pos();
+        coords[3 * i] = p[0]; coords[3 * i + 1] = p[1]; coords[3 * i + 2] = p[2];
+        nodeMarker[i] = nodeVector_[i]->marker();
+    }
+
+    bool withNeighbors = neighborsKnown_;
+
+    std::vector < uint64 > cellPtr(nCells + 1, 0);
+    std::vector < uint64 > cellIdx;
+    std::vector < int32 > cellMarker(nCells);
+    std::vector < int64 > cellNeighbors;
+    for (Index i = 0; i < nCells; i ++){
+        Cell * c = cellVector_[i];
+        for (Index j = 0; j < c->nodeCount(); j ++) cellIdx.push_back(c->node(j).id());
+        cellPtr[i + 1] = cellIdx.size();
+        cellMarker[i] = c->marker();
+        if (withNeighbors){
+            for (uint j = 0; j < c->neighborCellCount(); j ++){
+                Cell * n = c->neighborCell(j);
+                cellNeighbors.push_back(n ? int64(n->id()) : -1);
+            }
+        }
+    }
+
+    std::vector < uint64 > boundPtr(nBounds + 1, 0);
+    std::vector < uint64 > boundIdx;
+    std::vector < int32 > boundMarker(nBounds);
+    std::vector < int64 > leftCells(nBounds);
+    std::vector < int64 > rightCells(nBounds);
+    for (Index i = 0; i < nBounds; i ++){
+        Boundary * b = boundaryVector_[i];
+        for (Index j = 0; j < b->nodeCount(); j ++) boundIdx.push_back(b->node(j).id());
+        boundPtr[i + 1] = boundIdx.size();
+        boundMarker[i] = b->marker();
+        leftCells[i] = b->leftCell() ? int64(b->leftCell()->id()) : -1;
+        rightCells[i] = b->rightCell() ? int64(b->rightCell()->id()) : -1;
+    }
+
+    std::vector < std::pair < std::string, const RVector * > > data;
+    for (auto & x: dataMap_){
+        if (x.first.length() > 0 && x.second.size() > 0){
+            data.push_back(std::make_pair(x.first, &x.second));
+        } else {
+            log(Warning, "Export data map invalid: " + x.first);
+        }
+    }
+
+    //** section layout
+    uint64 sizes[11] = {coords.size() * sizeof(double),
+                        nodeMarker.size() * sizeof(int32),
+                        cellPtr.size() * sizeof(uint64),
+                        cellIdx.size() * sizeof(uint64),
+                        cellMarker.size() * sizeof(int32),
+                        cellNeighbors.size() * sizeof(int64),
+                        boundPtr.size() * sizeof(uint64),
+                        boundIdx.size() * sizeof(uint64),
+                        boundMarker.size() * sizeof(int32),
+                        leftCells.size() * sizeof(int64),
+                        rightCells.size() * sizeof(int64)};
+
+    uint64 offsets[16];
+    std::memset(offsets, 0, 16 * sizeof(uint64));
+    uint64 pos = MESHBINV4_HEADERSIZE;
+    for (Index i = 0; i < 11; i ++){
+        offsets[i] = sizes[i] > 0 ? pos : 0;
+        pos += alignTo8_(sizes[i]);
+    }
+    offsets[11] = pos;
+    for (auto & d: data){
+        pos += sizeof(uint64) + alignTo8_(d.first.length());
+        pos += sizeof(uint64) + d.second->size() * sizeof(double);
+    }
+
+    uint64 counts[8] = {nNodes, nCells, cellIdx.size(), cellNeighbors.size(),
+                        nBounds, boundIdx.size(), data.size(), pos};
+
+    FILE *file;
+    file = fopen(fileName.c_str(), "w+b");
+    if (!file) {
+        throwError(WHERE_AM_I + " " + fileName + ": " + strerror(errno));
+    }
+
+    //** write header
+    uint8 header[MESHBINV4_HEADERSIZE];
+    std::memset(header, 0, MESHBINV4_HEADERSIZE);
+    header[0] = (uint8)this->dimension();
+    header[1] = 4;
+    header[2] = (uint8)this->isGeometry();
+    header[3] = withNeighbors ? 1 : 0;
+    std::memcpy(header + 4, &MESHBINV4_MAGIC, sizeof(uint32));
+    std::memcpy(header + 8, counts, 8 * sizeof(uint64));
+    std::memcpy(header + 72, offsets, 16 * sizeof(uint64));
+    writeToFile(file, header[0], MESHBINV4_HEADERSIZE);
+
+    writeSectionToFile_(file, coords);
+    writeSectionToFile_(file, nodeMarker);
+    writeSectionToFile_(file, cellPtr);
+    writeSectionToFile_(file, cellIdx);
+    writeSectionToFile_(file, cellMarker);
+    writeSectionToFile_(file, cellNeighbors);
+    writeSectionToFile_(file, boundPtr);
+    writeSectionToFile_(file, boundIdx);
+    writeSectionToFile_(file, boundMarker);
+    writeSectionToFile_(file, leftCells);
+    writeSectionToFile_(file, rightCells);
+
+    for (auto & d: data){
+        writeToFile(file, uint64(d.first.length()));
+        writeSectionToFile_(file, std::vector < char >(d.first.begin(), d.first.end()));
+        writeToFile(file, uint64(d.second->size()));
+        writeToFile(file, (*d.second)[0], d.second->size());
+    }
+
+    fclose(file);
+}
+
+void Mesh::loadBinaryV4(const std::string & fbody) {
+    this->clear();
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    MappedFile mf(fileName);
+
+    const uint8 * header = mf.at< uint8 >(0, MESHBINV4_HEADERSIZE);
+    uint32 magic; std::memcpy(&magic, header + 4, sizeof(uint32));
+    if (header[1] != 4 || magic != MESHBINV4_MAGIC){
+        throwError(WHERE_AM_I + " " + fileName + " is no binary mesh v4.");
+    }
+    uint8 dim = header[0];
+    if (dim != 1 && dim != 2 && dim != 3){
+        throwError(WHERE_AM_I + " cannot determine dimension " + str(dim));
+    }
+    const uint64 * counts = mf.at< uint64 >(8, 8);
+    const uint64 * offsets = mf.at< uint64 >(72, 16);
+    if (counts[7] != mf.size()){
+        throwError(WHERE_AM_I + " " + fileName + ": file size mismatch "
+                   + str(mf.size()) + " != " + str(counts[7]) + ". File truncated?");
+    }
+    this->setDimension(dim);
+    this->setGeometry(bool(header[2]));
+    bool withNeighbors = header[3] & 1;
+
+    Index nNodes = counts[0];
+    Index nCells = counts[1];
+    Index nBounds = counts[4];
+
+    //** stored cell indices, -1 for none
+    auto cellAt = [&](int64 id) -> Cell * {
+        if (id < -1 || id >= int64(nCells)){
+            throwError(WHERE_AM_I + " " + fileName + ": cell index out of range "
+                       + str(id));
+        }
+        return id > -1 ? cellVector_[id] : NULL;
+    };
+
+    mf.willNeed(MESHBINV4_HEADERSIZE, mf.size());
+
+    //** nodes
+    if (nNodes > 0){
+        const double * coords = mf.at< double >(offsets[0], 3 * nNodes);
+        const int32 * marker = mf.at< int32 >(offsets[1], nNodes);
+        nodeVector_.reserve(nNodes);
+        for (Index i = 0; i < nNodes; i ++){
+            this->createNode(coords[3 * i], coords[3 * i + 1], coords[3 * i + 2],
+                             marker[i]);
+        }
+    }
+
+    //** cells
+    if (nCells > 0){
+        const uint64 * ptr = mf.at< uint64 >(offsets[2], nCells + 1);
+        const uint64 * idx = mf.at< uint64 >(offsets[3], counts[2]);
+        const int32 * marker = mf.at< int32 >(offsets[4], nCells);
+        if (ptr[nCells] != counts[2]){
+            throwError(WHERE_AM_I + " " + fileName + ": corrupt cell offsets.");
+        }
+        cellVector_.reserve(nCells);
+        std::vector < Node * > nodes;
+        for (Index i = 0; i < nCells; i ++){
+            if (ptr[i + 1] < ptr[i]){
+                throwError(WHERE_AM_I + " " + fileName + ": corrupt offsets.");
+            }
+            nodes.resize(ptr[i + 1] - ptr[i]);
+            for (Index j = 0; j < nodes.size(); j ++) {
+                Index id = idx[ptr[i] + j];
+                if (id >= nNodes){
+                    throwError(WHERE_AM_I + " " + fileName + ": node index out of range "
+                               + str(id));
+                }
+                nodes[j] = nodeVector_[id];
+            }
+            this->createCell(nodes, marker[i]);
+        }
+    }
+
+    //** bounds
+    if (nBounds > 0){
+        const uint64 * ptr = mf.at< uint64 >(offsets[6], nBounds + 1);
+        const uint64 * idx = mf.at< uint64 >(offsets[7], counts[5]);
+        const int32 * marker = mf.at< int32 >(offsets[8], nBounds);
+        const int64 * left = mf.at< int64 >(offsets[9], nBounds);
+        const int64 * right = mf.at< int64 >(offsets[10], nBounds);
+        if (ptr[nBounds] != counts[5]){
+            throwError(WHERE_AM_I + " " + fileName + ": corrupt boundary offsets.");
+        }
+        boundaryVector_.reserve(nBounds);
+        std::vector < Node * > nodes;
+        for (Index i = 0; i < nBounds; i ++){
+            if (ptr[i + 1] < ptr[i]){
+                throwError(WHERE_AM_I + " " + fileName + ": corrupt offsets.");
+            }
+            nodes.resize(ptr[i + 1] - ptr[i]);
+            for (Index j = 0; j < nodes.size(); j ++) {
+                Index id = idx[ptr[i] + j];
+                if (id >= nNodes){
+                    throwError(WHERE_AM_I + " " + fileName + ": node index out of range "
+                               + str(id));
+                }
+                nodes[j] = nodeVector_[id];
+            }
+            //** stored boundaries are unique, so skip the duplicate search
+            Boundary * bound = this->createBoundary(nodes, marker[i], false);
+            bound->setLeftCell(cellAt(left[i]));
+            bound->setRightCell(cellAt(right[i]));
+        }
+    }
+
+    //** restore neighbor infos without searching the node-cell sets
+    if (withNeighbors){
+        const int64 * neigh = mf.at< int64 >(offsets[5], counts[3]);
+        Index count = 0;
+        for (Index i = 0; i < nCells; i ++){
+            Cell * c = cellVector_[i];
+            if (count + c->neighborCellCount() > counts[3]){
+                throwError(WHERE_AM_I + " " + fileName + ": corrupt neighbor infos.");
+            }
+            for (uint j = 0; j < c->neighborCellCount(); j ++){
+                c->setNeighborCell(j, cellAt(neigh[count]));
+                count ++;
+            }
+        }
+        neighborsKnown_ = true;
+    }
+
+    //** data
+    uint64 pos = offsets[11];
+    for (Index i = 0; i < counts[6]; i ++){
+        uint64 strLen = *mf.at< uint64 >(pos); pos += sizeof(uint64);
+        std::string name(mf.at< char >(pos, strLen), strLen);
+        pos += alignTo8_(strLen);
+        uint64 datLen = *mf.at< uint64 >(pos); pos += sizeof(uint64);
+        const double * dat = mf.at< double >(pos, datLen);
+        pos += datLen * sizeof(double);
+        RVector v(datLen);
+        if (datLen > 0) std::memcpy(&v[0], dat, datLen * sizeof(double));
+        this->addData(name, v);
+    }
+}
+
 int Mesh::exportSimple(const std::string & fbody, const RVector & data) const {
   //output x y x y x y rhoa file
   std::fstream file; if (!openOutFile(fbody , & file)){ throwError("can't open file"); }
@@ -996,16 +1318,174 @@ void Mesh::exportVTK(const std::string & fbody,
     file.close();
 }
 
+namespace {
+
+//! Tokenizer for legacy vtk files.
+/*! Works on the whole (memory mapped) file content. Keyword lines are
+ * read as lines, ascii values are parsed in place without creating
+ * string objects per token and binary values are converted from big
+ * endian as the legacy format requires. */
+class LegacyVTKReader_ {
+public:
+    LegacyVTKReader_(const MappedFile & mf)
+        : p_(mf.data()), end_(mf.data() + mf.size()), binary_(false){}
+
+    inline void setBinary(bool binary){ binary_ = binary; }
+    inline bool binary() const { return binary_; }
+
+    /*! Return the rest of the current line without trailing \r. */
+    std::string line(){
+        const char * b = p_;
+        while (p_ < end_ && *p_ != '\n') p_ ++;
+        const char * e = p_;
+        if (p_ < end_) p_ ++;
+        if (e > b && *(e - 1) == '\r') e --;
+        return std::string(b, e);
+    }
+
+    /*! Skip empty lines and return the next non empty line split
+     * into words. Empty if the end of the file is reached. */
+    std::vector < std::string > keywordLine(){
+        skipSpace_();
+        return getSubstrings(line());
+    }
+
+    /*! Return the next keyword line without consuming it. */
+    std::vector < std::string > peekKeywordLine(){
+        const char * p = p_;
+        std::vector < std::string > row(keywordLine());
+        p_ = p;
+        return row;
+    }
+
+    /*! Read n values of the vtk data type into v. */
+    template < class ValueType > void read(ValueType * v, Index n,
+                                           const std::string & type){
+        if (!binary_){
+            for (Index i = 0; i < n; i ++) v[i] = (ValueType)ascii_();
+            return;
+        }
+        if (type == "float")               readBinary_< float >(v, n);
+        else if (type == "double")         readBinary_< double >(v, n);
+        else if (type == "int")            readBinary_< int32 >(v, n);
+        else if (type == "unsigned_int")   readBinary_< uint32 >(v, n);
+        else if (type == "long" ||
+                 type == "vtktypeint64")   readBinary_< int64 >(v, n);
+        else if (type == "unsigned_long" ||
+                 type == "vtktypeuint64")  readBinary_< uint64 >(v, n);
+        else if (type == "short")          readBinary_< int16 >(v, n);
+        else if (type == "unsigned_short") readBinary_< uint16 >(v, n);
+        else if (type == "char")           readBinary_< int8 >(v, n);
+        else if (type == "unsigned_char" ||
+                 type == "bit")            readBinary_< uint8 >(v, n);
+        else throwError(WHERE_AM_I + " unknown vtk data type: " + type);
+    }
+
+    /*! Read ascii values until the next keyword or end of file. */
+    void readAll(std::vector < double > & v){
+        while (!atKeyword_()) v.push_back(ascii_());
+    }
+
+    /*! Skip ascii lines until the next keyword line. */
+    void skipData(){
+        while (!atKeyword_()) line();
+    }
+
+protected:
+    inline void skipSpace_(){
+        while (p_ < end_ && isspace(*p_)) p_ ++;
+    }
+
+    /*! True at the end of the file or if the next token is a section
+     * keyword. Values like nan or inf also start with a letter, so letter
+     * tokens are keywords only if known or not convertible to a number. */
+    bool atKeyword_(){
+        skipSpace_();
+        if (p_ == end_) return true;
+        if (!isalpha(*p_)) return false;
+
+        const char * e = p_;
+        while (e < end_ && !isspace(*e)) e ++;
+        std::string token(p_, e);
+
+        static const std::set < std::string > keywords{
+            "POINTS", "CELLS", "CELL_TYPES", "POLYGONS", "LINES", "VERTICES",
+            "TRIANGLE_STRIPS", "OFFSETS", "CONNECTIVITY", "POINT_DATA",
+            "CELL_DATA", "SCALARS", "COLOR_SCALARS", "VECTORS", "NORMALS",
+            "TENSORS", "TEXTURE_COORDINATES", "FIELD", "LOOKUP_TABLE",
+            "METADATA", "INFORMATION", "DIMENSIONS", "ORIGIN", "SPACING",
+            "ASPECT_RATIO", "X_COORDINATES", "Y_COORDINATES", "Z_COORDINATES"};
+        if (keywords.count(token)) return true;
+
+        char * end = NULL;
+        std::strtod(token.c_str(), &end);
+        return end != token.c_str() + token.size();
+    }
+
+    double ascii_(){
+        skipSpace_();
+        const char * b = p_;
+        while (p_ < end_ && !isspace(*p_)) p_ ++;
+        Index len = p_ - b;
+        if (len == 0){
+            throwError(WHERE_AM_I + " unexpected end of vtk file.");
+        }
+
+        //** fast path for plain integers (connectivity, counts)
+        const char * c = b;
+        bool neg = (*c == '-');
+        if (neg || *c == '+') c ++;
+        int64 iv = 0;
+        while (c < p_ && *c >= '0' && *c <= '9') iv = iv * 10 + (*c++ - '0');
+        if (c == p_ && len < 19) return neg ? -double(iv) : double(iv);
+
+        //** the mapped buffer is not null terminated
+        char buf[64];
+        std::string token;
+        const char * cstr = buf;
+        if (len < 64){
+            std::memcpy(buf, b, len);
+            buf[len] = '\0';
+        } else {
+            token.assign(b, len);
+            cstr = token.c_str();
+        }
+        char * e = NULL;
+        double v = std::strtod(cstr, &e);
+        if (e != cstr + len){
+            throwError(WHERE_AM_I + " cannot convert to number: " + std::string(b, len));
+        }
+        return v;
+    }
+
+    template < class T, class ValueType > void readBinary_(ValueType * v, Index n){
+        if (p_ + n * sizeof(T) > end_){
+            throwError(WHERE_AM_I + " unexpected end of binary vtk file.");
+        }
+        uint8 tmp[sizeof(T)];
+        for (Index i = 0; i < n; i ++){
+            //** legacy vtk binary data is big endian
+            for (Index j = 0; j < sizeof(T); j ++) tmp[j] = p_[sizeof(T) - 1 - j];
+            T t; std::memcpy(&t, tmp, sizeof(T));
+            v[i] = (ValueType)t;
+            p_ += sizeof(T);
+        }
+    }
+
+    const char * p_;
+    const char * end_;
+    bool binary_;
+};
+
+} // namespace
+
 void Mesh::importVTK(const std::string & fbody) {
-//     __MS(dimension_)
     this->clear();
-    std::fstream file; openInFile(fbody.substr(0, fbody.rfind(".vtk")) + ".vtk",
-                                  &file);
-
-    std::vector < std::string > row;
-    getline(file, commentString_); //** vtk version line
-    getline(file, commentString_); //** comment line
+    MappedFile mf(fbody.substr(0, fbody.rfind(".vtk")) + ".vtk");
+    LegacyVTKReader_ vtk(mf);
 
+    vtk.line(); //** vtk version line
+    commentString_ = vtk.line(); //** comment line
 
     if (commentString_.find("d-2__") != std::string::npos){
         dimension_ = 2;
@@ -1013,299 +1493,598 @@ void Mesh::importVTK(const std::string & fbody) {
         dimension_ = 3;
     }
 
-    while (!file.eof()){
-        row = getRowSubstrings(file);
-      //  std::cout << row.size() << std::endl;
-        if (row.size()){
-            if (row[0] == "ASCII"){
-                break;
-            } else if (row[0] == "BINARY"){
-                THROW_TO_IMPL
-                break;
-            }
+    std::vector < std::string > row;
+    while (true){
+        row = vtk.keywordLine();
+        if (row.size() == 0){
+            throwError(WHERE_AM_I + " no ASCII or BINARY tag found.");
+        }
+        if (row[0] == "ASCII"){
+            break;
+        } else if (row[0] == "BINARY"){
+            vtk.setBinary(true);
+            break;
         }
     }
-    row = getRowSubstrings(file);
-    //std::cout << row.size() << std::endl;
-    if (row.back() == "UNSTRUCTURED_GRID"){
 
-        //** End reading header
-        while (!file.eof()){
-            row = getRowSubstrings(file);
-            if (row.size()){
-                if (row[0] == "POINTS") readVTKPoints_(file, row);
-                else if (row[0] == "CELLS") readVTKCells_(file, row);
-                else if (row[0] == "SCALARS") readVTKScalars_(file, row);
-                else if (row[0] == "FIELD") {
-                    if (row.size() == 3){
-                        std::string dataName(row[1]);
-                        Index numArray(toInt(row[2]));
-                        for (Index i = 0; i < numArray; i ++ ){
-                            std::vector < std::string > r(getNonEmptyRow(file));
-
-                            if (r.size() == 4){
-                                std::string arrayName(r[0]);
-                                Index numComponents(toInt(r[1]));
-                                Index numTuples(toInt(r[2]));
-                                std::string dataType(r[3]);
-
-                                for (Index j = 0; j < numComponents; j ++ ){
-                                    //u 1 2601 double
-                                    RVector field(numTuples);
-                                    for (Index k = 0; k < numTuples; k ++) {
-                                        file >> field[k];
-                                    }
-
-                                    addData(dataName + "_" + str(i) + "_" +
-                                            arrayName + "_" + str(j), field);
-                                }
-                            }
-                        }
-                    }
+    row = vtk.keywordLine();
+    if (row.size() == 0) throwError(WHERE_AM_I + " no DATASET found.");
+    std::string dataset(row.back());
+    if (dataset != "UNSTRUCTURED_GRID" && dataset != "POLYDATA" &&
+        dataset != "STRUCTURED_GRID"){
+        __MS(row)
+        THROW_TO_IMPL
+    }
+
+    Index nx = 0, ny = 0, nz = 0;
+    //** number of tuples in the current POINT_DATA or CELL_DATA section
+    Index nTuples = 0;
+
+    while (true){
+        row = vtk.keywordLine();
+        if (row.size() == 0) break;
+        const std::string & key = row[0];
+
+        if (key == "POINTS" && row.size() > 2){
+            Index nVerts = toInt(row[1]);
+            std::vector < double > coords(3 * nVerts);
+            if (nVerts > 0) vtk.read(&coords[0], 3 * nVerts, row[2]);
+
+            if (dataset == "STRUCTURED_GRID"){
+                RVector vx(nVerts), vy(nVerts), vz(nVerts);
+                for (Index i = 0; i < nVerts; i ++) {
+                    vx[i] = coords[3 * i];
+                    vy[i] = coords[3 * i + 1];
+                    vz[i] = coords[3 * i + 2];
                 }
-                else if (row[0] == "VECTORS") {
-                    log(Warning, " .. clean up VTK vector data read");
-                    std::string name(row[1]);
-                    std::vector < std::string > r(getRowSubstrings(file));
-                    if (r.size()){
-                        if (r[0] == "LOOKUP_TABLE"){
-                            r = getRowSubstrings(file);
-                        }
-                    }
-                    RVector data_x(nodeCount());
-                    RVector data_y(nodeCount());
-                    RVector data_z(nodeCount());
-                    for (uint i = 0; i < data_x.size(); i ++) {
-                        // __MS(r.size())
-                        if (r.size() == 3){
-                            // __MS(r[0] << " " << r[1] << " " << r[2])
-                            data_x[i] = toDouble(r[0]);
-                            data_y[i] = toDouble(r[1]);
-                            data_z[i] = toDouble(r[2]);
-                        }
-                        r = getRowSubstrings(file);
-                    }
-                    addData(name + "_x", data_x);
-                    addData(name + "_y", data_y);
-                    addData(name + "_z", data_z);
+                RVector gvx(nx+1), gvy(ny+1), gvz(nz+1);
+                for (Index i = 0; i < nx+1; i ++){
+                    gvx[i] = min(vx) + i * (max(vx) - min(vx))/nx;
                 }
+                for (Index i = 0; i < ny+1; i ++){
+                    gvy[i] = min(vy) + i * (max(vy) - min(vy))/ny;
+                }
+                for (Index i = 0; i < nz+1; i ++){
+                    gvz[i] = min(vz) + i * (max(vz) - min(vz))/nz;
+                }
+                this->create3DGrid(gvx, gvy, gvz);
+                continue;
             }
-        }
 
-    } else if (row.back() == "POLYDATA"){
-        while (!file.eof()){
-            row = getRowSubstrings(file);
-            if (row.size()){
-                if (row[0] == "POINTS") readVTKPoints_(file, row);
-                else if (row[0] == "POLYGONS") readVTKPolygons_(file, row);
+            nodeVector_.reserve(nodeVector_.size() + nVerts);
+            bool nonZeroY = false, nonZeroZ = false;
+            for (Index i = 0; i < nVerts; i ++) {
+                this->createNode(coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]);
+                nonZeroY = nonZeroY || coords[3 * i + 1] != 0.0;
+                nonZeroZ = nonZeroZ || coords[3 * i + 2] != 0.0;
             }
-        }
-    } else if (row.back() == "STRUCTURED_GRID"){
-        Index nx = 0;
-        Index ny = 0;
-        Index nz = 0;
 
-        while (!file.eof()){
-            row = getRowSubstrings(file);
-
-            if (row.size()){
-                if (row[0] == "DIMENSIONS"){
-                    if (row.size() == 4){
-                        nx = toInt(row[1]);
-                        ny = toInt(row[2]);
-                        nz = toInt(row[3]);
-                    } else {
-                        __MS(row)
-                        THROW_TO_IMPL
+            if (!nonZeroY && nonZeroZ){
+                dimension_ = 2;
+                // swap y and z
+                for (Index i = 0; i < nodeCount(); i ++ ){
+                    nodeVector_[i]->pos()[1] = nodeVector_[i]->pos()[2];
+                    nodeVector_[i]->pos()[2] = 0.0;
+                }
+            } else if (!nonZeroZ) dimension_ = 2;
+
+        } else if ((key == "CELLS" || key == "POLYGONS") && row.size() > 2){
+            Index n = toInt(row[1]);
+            Index size = toInt(row[2]);
+
+            //** offsets and connectivity per cell: [start, end) in conn
+            std::vector < int64 > offsets;
+            std::vector < int64 > conn;
+
+            std::vector < std::string > next(vtk.peekKeywordLine());
+            if (next.size() > 0 && next[0] == "OFFSETS"){
+                //** vtk 5.1 layout: n offsets and size connectivity entries
+                vtk.keywordLine();
+                offsets.resize(n);
+                if (n > 0) vtk.read(&offsets[0], n, next.size() > 1 ? next[1] : "");
+                next = vtk.keywordLine();
+                if (next.size() == 0 || next[0] != "CONNECTIVITY"){
+                    throwError(WHERE_AM_I + " CONNECTIVITY expected.");
+                }
+                conn.resize(size);
+                if (size > 0) vtk.read(&conn[0], size, next.size() > 1 ? next[1] : "");
+
+                for (Index i = 0; i < offsets.size(); i ++){
+                    if (offsets[i] < (i > 0 ? offsets[i - 1] : 0) ||
+                        offsets[i] > int64(size)){
+                        throwError(WHERE_AM_I + " corrupt OFFSETS: " + str(offsets[i])
+                                   + " at " + str(i) + " is decreasing or beyond the "
+                                   + str(size) + " CONNECTIVITY entries.");
                     }
-                } else if (row[0] == "POINTS"){
-                    //POINTS 1331 double
-                    Index nVerts = toInt(row[1]);
-                    RVector vx(nVerts);
-                    RVector vy(nVerts);
-                    RVector vz(nVerts);
-                    for (Index i = 0; i < nVerts; i ++) {
-                        file >> vx[i] >> vy[i] >> vz[i];
+                }
+            } else {
+                std::vector < int64 > raw(size);
+                if (size > 0) vtk.read(&raw[0], size, "int");
+                offsets.reserve(n + 1);
+                conn.reserve(size);
+                offsets.push_back(0);
+                for (Index i = 0, pos = 0; i < n; i ++){
+                    if (pos >= size) throwError(WHERE_AM_I + " corrupt CELLS section.");
+                    int64 nNodes = raw[pos ++];
+                    if (nNodes < 0 || nNodes > int64(size - pos)){
+                        throwError(WHERE_AM_I + " corrupt CELLS section: cell " + str(i)
+                                   + " with " + str(nNodes) + " nodes exceeds the "
+                                   + str(size) + " entries.");
                     }
+                    for (int64 j = 0; j < nNodes; j ++) conn.push_back(raw[pos ++]);
+                    offsets.push_back(conn.size());
+                }
+            }
 
-                    RVector gvx(nx+1), gvy(ny+1), gvz(nz+1);
-                    for (Index i = 0; i < nx+1; i ++){
-                        gvx[i] = min(vx) + i * (max(vx) - min(vx))/nx;
-                    }
-                    for (Index i = 0; i < ny+1; i ++){
-                        gvy[i] = min(vy) + i * (max(vy) - min(vy))/ny;
-                    }
-                    for (Index i = 0; i < nz+1; i ++){
-                        gvz[i] = min(vz) + i * (max(vz) - min(vz))/nz;
+            Index nCells = offsets.size() > 0 ? offsets.size() - 1 : 0;
+            if (key == "CELLS") cellVector_.reserve(cellVector_.size() + nCells);
+            else boundaryVector_.reserve(boundaryVector_.size() + nCells);
+
+            std::vector < Node * > nodes;
+            for (Index i = 0; i < nCells; i ++){
+                nodes.resize(offsets[i + 1] - offsets[i]);
+                for (Index j = 0; j < nodes.size(); j ++) {
+                    int64 id = conn[offsets[i] + j];
+                    if (id < 0 || id >= int64(nodeCount())){
+                        throwError(WHERE_AM_I + " node index " + str(id) + " of cell "
+                                   + str(i) + " out of range [0, " + str(nodeCount()) + ").");
                     }
+                    nodes[j] = &this->node(id);
+                }
+                if (key == "CELLS") this->createCell(nodes);
+                else this->createBoundary(nodes);
+            }
+
+        } else if (key == "CELL_TYPES" && row.size() > 1){
+            Index n = toInt(row[1]);
+            std::vector < int32 > types(n);
+            if (n > 0) vtk.read(&types[0], n, "int");
+
+        } else if ((key == "POINT_DATA" || key == "CELL_DATA") && row.size() > 1){
+            nTuples = toInt(row[1]);
 
-                    this->create3DGrid(gvx, gvy, gvz);
+        } else if (key == "DIMENSIONS"){
+            if (row.size() == 4){
+                nx = toInt(row[1]);
+                ny = toInt(row[2]);
+                nz = toInt(row[3]);
+            } else {
+                __MS(row)
+                THROW_TO_IMPL
+            }
+
+        } else if (key == "SCALARS" && row.size() > 1){
+            std::string name(row[1]);
+            std::string type(row.size() > 2 ? row[2] : "float");
+            Index nComp = row.size() > 3 ? toInt(row[3]) : 1;
+
+            std::vector < std::string > next(vtk.peekKeywordLine());
+            if (next.size() > 0 && next[0] == "LOOKUP_TABLE") vtk.keywordLine();
+
+            std::vector < double > v;
+            if (nTuples > 0){
+                v.resize(nTuples * nComp);
+                vtk.read(&v[0], v.size(), type);
+            } else if (!vtk.binary()){
+                vtk.readAll(v);
+            } else {
+                throwError(WHERE_AM_I + " SCALARS without POINT_DATA or CELL_DATA.");
+            }
+
+            RVector data(v);
+            addData(name, data);
+            if (name == "Marker"){
+                if (data.size() == this->cellCount()) this->setCellMarkers(data);
+                if (data.size() == this->boundaryCount()) this->setBoundaryMarkers(data);
+            }
 
-                } else if (row[0] == "SCALARS") {
-                    readVTKScalars_(file, row);
+        } else if (key == "VECTORS" && row.size() > 1){
+            std::string name(row[1]);
+            Index n = nTuples > 0 ? nTuples : nodeCount();
+            std::vector < double > v(3 * n);
+            if (n > 0) vtk.read(&v[0], 3 * n, row.size() > 2 ? row[2] : "float");
+
+            RVector data_x(n), data_y(n), data_z(n);
+            for (Index i = 0; i < n; i ++) {
+                data_x[i] = v[3 * i];
+                data_y[i] = v[3 * i + 1];
+                data_z[i] = v[3 * i + 2];
+            }
+            addData(name + "_x", data_x);
+            addData(name + "_y", data_y);
+            addData(name + "_z", data_z);
+
+        } else if (key == "FIELD" && row.size() == 3){
+            std::string dataName(row[1]);
+            Index numArray(toInt(row[2]));
+            for (Index i = 0; i < numArray; i ++ ){
+                std::vector < std::string > r(vtk.keywordLine());
+
+                if (r.size() == 4){
+                    std::string arrayName(r[0]);
+                    Index numComponents(toInt(r[1]));
+                    Index numTuples(toInt(r[2]));
+                    //u 1 2601 double
+                    std::vector < double > v(numComponents * numTuples);
+                    if (v.size() > 0) vtk.read(&v[0], v.size(), r[3]);
+
+                    for (Index j = 0; j < numComponents; j ++ ){
+                        RVector field(numTuples);
+                        for (Index k = 0; k < numTuples; k ++) {
+                            field[k] = v[j * numTuples + k];
+                        }
+                        addData(dataName + "_" + str(i) + "_" +
+                                arrayName + "_" + str(j), field);
+                    }
                 }
             }
+
+        } else if (key == "LOOKUP_TABLE" && row.size() > 2){
+            //** color table: 4 values per entry
+            Index n = toInt(row[2]);
+            std::vector < double > v(4 * n);
+            if (n > 0) vtk.read(&v[0], 4 * n, "unsigned_char");
+
+        } else if (key == "METADATA"){
+            //** vtk 9: skip until the empty line closing the block
+            while (vtk.line().length() > 0){}
+
+        } else {
+            if (vtk.binary()){
+                throwError(WHERE_AM_I + " cannot skip unknown binary vtk section: " + key);
+            }
+            log(Warning, "skipping unknown vtk section: " + key);
+            vtk.skipData();
         }
-    } else {
-        __MS(row)
-        THROW_TO_IMPL
     }
-//     __MS(dimension_)
-    //this->showInfos();
-    file.close();
+}
+
+void Mesh::importVTU(const std::string & fbody) {
+    this->clear();
+    THROW_TO_IMPL
+}
 
+namespace {
+
+//! Flat arrays of one unstructured grid piece in vtu ordering.
+struct VTUPiece_ {
+    std::vector < double > points;
+    std::vector < int64 > connectivity;
+    std::vector < int64 > offsets;
+    std::vector < uint8 > types;
+    std::vector < std::pair < std::string, RVector > > pointData;
+    std::vector < std::pair < std::string, RVector > > cellData;
+
+    Index nodeCount() const { return points.size() / 3; }
+    Index cellCount() const { return types.size(); }
+};
+
+uint8 vtkCellType_(uint rtti){
+    switch (rtti){
+        case MESH_BOUNDARY_NODE_RTTI:   return 1;
+        case MESH_EDGE_CELL_RTTI:
+        case MESH_EDGE_RTTI:            return 3;
+        case MESH_EDGE3_CELL_RTTI:
+        case MESH_EDGE3_RTTI:           return 21;
+        case MESH_TRIANGLEFACE_RTTI:
+        case MESH_TRIANGLE_RTTI:        return 5;
+        case MESH_TRIANGLEFACE6_RTTI:
+        case MESH_TRIANGLE6_RTTI:       return 22;
+        case MESH_QUADRANGLEFACE_RTTI:
+        case MESH_QUADRANGLE_RTTI:      return 9;
+        case MESH_QUADRANGLEFACE8_RTTI:
+        case MESH_QUADRANGLE8_RTTI:     return 23;
+        case MESH_TETRAHEDRON_RTTI:     return 10;
+        case MESH_TETRAHEDRON10_RTTI:   return 24;
+        case MESH_HEXAHEDRON_RTTI:      return 12;
+        case MESH_HEXAHEDRON20_RTTI:    return 25;
+        case MESH_POLYGON_FACE_RTTI:    return 7; // VTK_POLYGON
+        default: std::cerr << WHERE_AM_I << " nothing know about." << rtti << std::endl;
+    }
+    return 0;
 }
 
-void Mesh::readVTKPoints_(std::fstream & file,
-                          const std::vector < std::string > & row){
-    uint nVerts = toInt(row[1]);
-    //std::cout << "nVerts: " << nVerts << std::endl;
-    double x = 0.0, y = 0.0, z = 0.0;
-    for (uint i = 0; i < nVerts; i ++) {
-        file >> x >> y >> z;
-        this->createNode(x, y, z);
-    }
-
-//     std::cout << GIMLI::z(positions()) << std::endl;
-//     std::cout << (min(abs(GIMLI::z(positions()))) << std::endl;
-//     __MS(nonZero(GIMLI::x(positions())))
-//     __MS(nonZero(GIMLI::y(positions())))
-//     __MS(nonZero(GIMLI::z(positions())))
-    if (!nonZero(GIMLI::y(positions())) && nonZero(GIMLI::z(positions()))){
-        dimension_ = 2;
-        // swap y and z
-        for (Index i = 0; i < nodeCount(); i ++ ){
-            nodeVector_[i]->pos()[1] = nodeVector_[i]->pos()[2];
-            nodeVector_[i]->pos()[2] = 0.0;
+/*! Fill the piece arrays from the mesh. If the mesh has no cells, its
+ * boundaries are exported as cells. */
+void fillVTUPiece_(const Mesh & mesh,
+                   const std::map < std::string, RVector > & data,
+                   VTUPiece_ & p){
+    bool cellsAreBoundaries = false;
+
+    std::vector < MeshEntity * > cells;
+
+    if (mesh.cellCount() == 0 && mesh.boundaryCount() > 0){
+        cellsAreBoundaries = true;
+        cells.reserve(mesh.boundaryCount());
+        for (Index i = 0; i < mesh.boundaryCount(); i ++) cells.push_back(& mesh.boundary(i));
+    } else {
+        cells.reserve(mesh.cellCount());
+        for (Index i = 0; i < mesh.cellCount(); i ++) cells.push_back(& mesh.cell(i));
+    }
+
+    Index nNodes = mesh.nodeCount();
+    Index nCells = cells.size();
+
+    p.points.resize(3 * nNodes);
+    for (Index i = 0; i < nNodes; i ++) {
+        const RVector3 & pos = mesh.node(i).pos();
+        p.points[3 * i] = pos[0];
+        p.points[3 * i + 1] = pos[1];
+        p.points[3 * i + 2] = pos[2];
+    }
+
+    p.offsets.resize(nCells);
+    p.types.resize(nCells);
+    for (Index i = 0; i < nCells; i ++) {
+        MeshEntity * cell = cells[i];
+        if (cell->rtti() == MESH_TETRAHEDRON10_RTTI){
+            //** vtk edge node ordering differs
+            static const Index tet10[10] = {0, 1, 2, 3, 4, 7, 5, 6, 9, 8};
+            for (Index j = 0; j < 10; j ++) {
+                p.connectivity.push_back(cell->node(tet10[j]).id());
+            }
+        } else {
+            for (Index j = 0; j < cell->nodeCount(); j ++) {
+                p.connectivity.push_back(cell->node(j).id());
+            }
         }
+        p.offsets[i] = p.connectivity.size();
+        p.types[i] = vtkCellType_(cell->rtti());
+    }
 
-    } else if (!nonZero(GIMLI::z(positions()))) dimension_ = 2;
+    for (auto & it: data){
+        if (it.second.size() == nNodes && !cellsAreBoundaries) {
+            //NodeCount == Cellcount for cellsAreBoundaries(2d)
+            p.pointData.push_back(it);
+        } else if (it.second.size() == nCells) {
+            p.cellData.push_back(it);
+        } else {
+            std::cerr << WHERE_AM_I << " dont know how to handle data array: " << it.first
+                        << " with size " << it.second.size() << " nodesize = " << nNodes
+                        << " cellsize = " << nCells << std::endl;
+        }
+    }
 }
 
-void Mesh::readVTKCells_(std::fstream & file,
-                         const std::vector < std::string > & row){
-    uint nCells = toInt(row[1]);
-    //std::cout << "nCells: " << nCells << std::endl;
-    uint nNodes = 0;
-    uint id;
-    std::vector < Node * > nodes;
-    for (uint i = 0; i < nCells; i ++) {
-        file >> nNodes;
-        nodes.resize(nNodes);
-        for (uint j = 0; j < nNodes; j ++) {
-            file >> id;
-            nodes[j] = &this->node(id);
+/*! Extract the cells [start, end) of the piece all with its used nodes. */
+void subVTUPiece_(const VTUPiece_ & all, Index start, Index end, VTUPiece_ & p){
+    std::vector < int64 > nodeMap(all.nodeCount(), -1);
+    std::vector < Index > nodes;
+
+    //** an empty piece, e.g., of a mesh without cells, keeps its data arrays
+    if (end > start){
+        Index first = start > 0 ? all.offsets[start - 1] : 0;
+        p.connectivity.reserve(all.offsets[end - 1] - first);
+    }
+    p.offsets.reserve(end - start);
+    p.types.assign(all.types.begin() + start, all.types.begin() + end);
+
+    for (Index i = start; i < end; i ++){
+        for (Index j = (i > 0 ? all.offsets[i - 1] : 0); j < (Index)all.offsets[i]; j ++){
+            int64 n = all.connectivity[j];
+            if (nodeMap[n] < 0) {
+                nodeMap[n] = nodes.size();
+                nodes.push_back(n);
+            }
+            p.connectivity.push_back(nodeMap[n]);
         }
-        this->createCell(nodes);
+        p.offsets.push_back(p.connectivity.size());
+    }
+
+    p.points.resize(3 * nodes.size());
+    for (Index i = 0; i < nodes.size(); i ++){
+        for (Index k = 0; k < 3; k ++) p.points[3 * i + k] = all.points[3 * nodes[i] + k];
+    }
+
+    for (auto & it: all.pointData){
+        RVector v(nodes.size());
+        for (Index i = 0; i < nodes.size(); i ++) v[i] = it.second[nodes[i]];
+        p.pointData.push_back(std::make_pair(it.first, v));
+    }
+    for (auto & it: all.cellData){
+        p.cellData.push_back(std::make_pair(it.first, it.second.getVal(start, end)));
     }
 }
 
-void Mesh::readVTKPolygons_(std::fstream & file, const std::vector < std::string > & row){
-    uint nPoly = toInt(row[1]);
-    uint nNodes = 0;
-    uint id;
-    std::vector < Node * > nodes;
-    for (uint i = 0; i < nPoly; i ++) {
-        file >> nNodes;
-        nodes.resize(nNodes);
-        for (uint j = 0; j < nNodes; j ++) {
-            file >> id;
-            nodes[j] = &this->node(id);
+std::string base64Encode_(const uint8 * in, Index n){
+    static const char * table =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    out.reserve(((n + 2) / 3) * 4);
+
+    Index i = 0;
+    for (; i + 2 < n; i += 3){
+        uint32 v = (uint32(in[i]) << 16) | (uint32(in[i + 1]) << 8) | in[i + 2];
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += table[(v >> 6) & 63];
+        out += table[v & 63];
+    }
+    if (i < n){
+        uint32 v = uint32(in[i]) << 16;
+        if (i + 1 < n) v |= uint32(in[i + 1]) << 8;
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += (i + 1 < n) ? table[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+//! Writes the DataArray elements of a vtu file.
+/*! In ascii mode the values are streamed inline. Otherwise the arrays are
+ * collected as appended data blocks with UInt64 headers, raw or base64
+ * encoded and, if zlib is available, compressed in blocks of 32 KiB like
+ * vtkZLibDataCompressor does. */
+class VTUWriter_ {
+public:
+    VTUWriter_(std::fstream & file, bool binary, bool compress, bool base64)
+        : file_(file), binary_(binary), compress_(compress), base64_(base64){
+#if !USE_ZLIB
+        if (compress_){
+            log(Warning, "libgimli is built without zlib, vtu will be written uncompressed.");
+            compress_ = false;
         }
-        this->createBoundary(nodes);
+#endif
     }
-}
 
-// template <class Arg, class Result> class bind : std::unary_function< Arg, Result >{
-// public:
-//     Result operator() (Arg & o) { return toDouble(o); }
-// };
-//   struct unary_function{
-//     typedef Arg argument_type;
-//     typedef Result result_type;
-//   };
-// template < class ret > class bind{
-// public:
-//     bind() {
-//         funct_ = &toDouble;
-//     }
-//     template < class type > ret operator() (type & o) { return toDouble(o); }
-// protected:
-//     //void (Region::*)
-//     size_t &funct_;
-//     //(toDouble*) funct_;
-// };
-
-void Mesh::readVTKScalars_(std::fstream & file, const std::vector < std::string > & row){
-    std::string name(row[1]);
-    // __MS(str(row[0]) + " " + str(row[1]))
-    std::vector < std::string > r(getRowSubstrings(file));
-    // __MS(r)
-    if (r.size()){
-        if (r[0] == "LOOKUP_TABLE"){
-            r = getRowSubstrings(file);
+    /*! Return the vtk type name used for double data arrays. Point data
+     * were always exported as Float32 in ascii mode. */
+    std::string pointDataType() const { return binary_ ? "Float64" : "Float32"; }
+
+    std::string intType() const { return binary_ ? "Int64" : "Int32"; }
+
+    void header(const std::string & type){
+        if (binary_){
+            file_ << "<VTKFile type=\"" << type << "\" version=\"1.0\" "
+                  << "byte_order=\"LittleEndian\" header_type=\"UInt64\"";
+            if (compress_) file_ << " compressor=\"vtkZLibDataCompressor\"";
+            file_ << ">" << std::endl;
+        } else {
+            file_ << "<VTKFile type=\"" << type << "\" version=\"0.1\" "
+                  << "byte_order=\"LittleEndian\">" << std::endl;
         }
     }
-    // __MS(r)
-    // __MS(r.size())
-    // __MS((cellCount() > 1 || boundaryCount() > 1 || nodeCount() > 1))
 
-    std::vector < std::string > ri;
-    
-    if (r.size() == 1 && (cellCount() > 1 || boundaryCount() > 1 || nodeCount() > 1)){
-        // __M
-        bool go=true;
-        while (go){
-            ri = getNonEmptyRow(file);
-            if (ri.size() == 0){
-                go=false;
-            } else if (ri.size() > 1){
-                file.unget();
-                go=false;
-            } else{
-                r.push_back(ri[0]);
+    template < class ValueType >
+    void dataArray(const std::string & type, const std::string & name,
+                   const ValueType * v, Index n, Index nComponents=1){
+        file_ << "<DataArray type=\"" << type << "\"";
+        if (name.length() > 0) file_ << " Name=\"" << name << "\"";
+        if (nComponents > 1) file_ << " NumberOfComponents=\"" << nComponents << "\"";
+
+        if (!binary_){
+            file_ << " format=\"ascii\">" << std::endl;
+            for (Index i = 0; i < n; i ++) ascii_(v[i]);
+            file_ << std::endl << "</DataArray>" << std::endl;
+        } else {
+            file_ << " format=\"appended\" offset=\"" << appended_.size() << "\"/>" << std::endl;
+            appendBlock_(reinterpret_cast< const uint8 * >(v), n * sizeof(ValueType));
+        }
+    }
+
+    /*! Write the collected appended data. Call after the grid element is closed. */
+    void finish(){
+        if (!binary_) return;
+        file_ << "<AppendedData encoding=\"" << (base64_ ? "base64" : "raw") << "\">"
+              << std::endl << "_";
+        file_.write(appended_.data(), appended_.size());
+        file_ << std::endl << "</AppendedData>" << std::endl;
+    }
+
+protected:
+    template < class ValueType > void ascii_(const ValueType & v){ file_ << v << " "; }
+    void ascii_(const uint8 & v){ file_ << int(v) << " "; }
+
+    void append_(const uint8 * v, Index n){
+        if (base64_){
+            appended_ += base64Encode_(v, n);
+        } else {
+            appended_.append(reinterpret_cast< const char * >(v), n);
+        }
+    }
+
+    void appendBlock_(const uint8 * v, Index nBytes){
+        if (!compress_){
+            uint64 head = nBytes;
+            append_(reinterpret_cast< const uint8 * >(&head), sizeof(uint64));
+            append_(v, nBytes);
+            return;
+        }
+#if USE_ZLIB
+        const uint64 blockSize = 32768;
+        uint64 nBlocks = (nBytes + blockSize - 1) / blockSize;
+
+        std::vector < uint64 > head(3 + nBlocks);
+        head[0] = nBlocks;
+        head[1] = blockSize;
+        head[2] = nBytes % blockSize;
+
+        std::vector < uint8 > comp;
+        comp.reserve(compressBound(nBytes));
+        std::vector < uint8 > buf(compressBound(blockSize));
+        for (uint64 i = 0; i < nBlocks; i ++){
+            uint64 len = std::min(blockSize, nBytes - i * blockSize);
+            uLongf cLen = buf.size();
+            if (compress2(&buf[0], &cLen, v + i * blockSize, len, Z_DEFAULT_COMPRESSION) != Z_OK){
+                throwError(WHERE_AM_I + " zlib compression failed.");
             }
+            head[3 + i] = cLen;
+            comp.insert(comp.end(), buf.begin(), buf.begin() + cLen);
         }
-        // std::vector < std::string > r(getRowSubstrings(file));
-        // THROW_TO_IMPL
+        append_(reinterpret_cast< const uint8 * >(&head[0]), head.size() * sizeof(uint64));
+        append_(comp.data(), comp.size());
+#endif
     }
 
-    // __MS(r)
-    // __MS(r.size())
+    std::fstream & file_;
+    bool binary_;
+    bool compress_;
+    bool base64_;
+    std::string appended_;
+};
 
-    RVector data(r.size());
-//     std::cout.precision(14);
-//     std::cout << *r.begin() << std::endl;
-//     std::cout << toDouble(*r.begin()) << std::endl;
-//     std::cout << std::bind1st(&toDouble)(*r.begin()) << std::endl;
-    //std::cout << bind< double, toDouble >(&toDouble)(*r.begin()) << std::endl;
+void writeVTUPiece_(std::fstream & file, VTUWriter_ & w, const VTUPiece_ & p){
+    file << "<Piece NumberOfPoints=\"" << p.nodeCount()
+         << "\" NumberOfCells=\"" << p.cellCount() << "\">" << std::endl;
 
-    //std::copy(r.begin(), r.end(), data.begin(), bind< double >(toDouble);
-    for (uint i = 0; i < data.size(); i ++) data[i] = toDouble(r[i]);
-    
-    addData(name, data);
-    if (name == "Marker"){
-        if (data.size() == this->cellCount()) this->setCellMarkers(data);
-        if (data.size() == this->boundaryCount()) this->setBoundaryMarkers(data);
+    file << "<Points>" << std::endl;
+    w.dataArray("Float64", "", p.points.data(), p.points.size(), 3);
+    file << "</Points>" << std::endl;
+
+    file << "<Cells>" << std::endl;
+    w.dataArray(w.intType(), "connectivity", p.connectivity.data(), p.connectivity.size());
+    w.dataArray(w.intType(), "offsets", p.offsets.data(), p.offsets.size());
+    w.dataArray("UInt8", "types", p.types.data(), p.types.size());
+    file << "</Cells>" << std::endl;
+
+    if (p.pointData.size() > 0){
+        file << "<PointData>" << std::endl;
+        for (auto & it: p.pointData){
+            w.dataArray(w.pointDataType(), it.first, &it.second[0], it.second.size());
+        }
+        file << "</PointData>" << std::endl;
+    }
+
+    if (p.cellData.size() > 0){
+        file << "<CellData>" << std::endl;
+        for (auto & it: p.cellData){
+            w.dataArray("Float64", it.first, &it.second[0], it.second.size());
+        }
+        file << "</CellData>" << std::endl;
     }
+
+    file << "</Piece>" << std::endl;
 }
 
+void writeVTU_(const std::string & fileName, const VTUPiece_ & p,
+               bool binary, bool compress, bool base64, int precision=-1){
+    std::fstream file;
+    if (!openFile(fileName, &file, std::ios::out | std::ios::binary, true)) return;
+    if (precision > 0) file.precision(precision);
 
-void Mesh::importVTU(const std::string & fbody) {
-    this->clear();
-    THROW_TO_IMPL
+    VTUWriter_ w(file, binary, compress, base64);
+    w.header("UnstructuredGrid");
+    file << "<UnstructuredGrid>" << std::endl;
+    writeVTUPiece_(file, w, p);
+    file << "</UnstructuredGrid>" << std::endl;
+    w.finish();
+    file << "</VTKFile>" << std::endl;
+    file.close();
 }
 
-void Mesh::exportVTU(const std::string & fbody, bool binary) const {
+std::string vtuFileName_(const std::string & fbody){
     std::string filename(fbody);
     if (filename.rfind(".vtu") == std::string::npos){
         filename = fbody.substr(0, filename.rfind(".vtk")) + ".vtu";
     }
-    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
-    file.precision(14);
-    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
-    file << "<UnstructuredGrid>" << std::endl;
+    return filename;
+}
 
+} // namespace
+
+std::map< std::string, RVector > Mesh::vtuData_() const {
     std::map< std::string, RVector > data(dataMap_);
     if (cellCount() > 0){
         if (!data.count("_Marker")) {
@@ -1313,187 +2092,89 @@ void Mesh::exportVTU(const std::string & fbody, bool binary) const {
         }
         if (!data.count("_Attribute")) data.insert(std::make_pair("_Attribute",  cellAttributes()));
     }
-    addVTUPiece_(file, *this, data);
-
-    file << "</UnstructuredGrid>" << std::endl;
-    file << "</VTKFile>" << std::endl;
-    file.close();
+    return data;
 }
 
-void Mesh::exportBoundaryVTU(const std::string & fbody, bool binary) const {
-    std::string filename(fbody);
-    if (filename.rfind(".vtu") == std::string::npos){
-        filename = fbody.substr(0, filename.rfind(".vtk")) + ".vtu";
-    }
-    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
-
-    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
-    file << "<UnstructuredGrid>" << std::endl;
+void Mesh::exportVTU(const std::string & fbody, bool binary,
+                     bool compress, bool base64) const {
+    VTUPiece_ p;
+    fillVTUPiece_(*this, vtuData_(), p);
+    writeVTU_(vtuFileName_(fbody), p, binary, compress, base64, 14);
+}
 
+void Mesh::exportBoundaryVTU(const std::string & fbody, bool binary,
+                             bool compress) const {
     std::vector < Boundary * > bs;
     for (uint i = 0; i < boundaryCount(); i ++) {
         if (boundary(i).marker() != 0.0) {
             bs.push_back(&boundary(i));
         }
-//         if (boundary(i).marker() == -2) {
-//             std::cout << boundary(i)<< " " << boundary(i).center() << " " << boundary(i).marker() << std::endl;
-//         }
     }
 
     Mesh boundMesh;
     boundMesh.createMeshByBoundaries(*this, bs);
-//    boundMesh.showInfos();
-    //for (uint i =0; i < boundMesh.nodeCount(); i ++) std::cout << boundMesh.node(i)<< std::endl;
     std::map< std::string, RVector > boundData;
 
     if (!boundData.count("_BoundaryMarker")) {
-        boundData.insert(std::make_pair("_BoundaryMarker", 
+        boundData.insert(std::make_pair("_BoundaryMarker",
                          boundMesh.boundaryMarkers()));
     }
 
-    //boundMesh.exportVTK(fbody, boundData);
-    addVTUPiece_(file, boundMesh, boundData);
-
-    file << "</UnstructuredGrid>" << std::endl;
-    file << "</VTKFile>" << std::endl;
-    file.close();
+    VTUPiece_ p;
+    fillVTUPiece_(boundMesh, boundData, p);
+    writeVTU_(vtuFileName_(fbody), p, binary, compress, false);
 }
 
-void Mesh::addVTUPiece_(std::fstream & file, const Mesh & mesh,
-                  const std::map < std::string, RVector > & data) const{
+void Mesh::exportPVTU(const std::string & fbody, Index nPieces,
+                      bool binary, bool compress) const {
+    std::string body(fbody.substr(0, fbody.rfind(".pvtu")));
+    std::string base(body.substr(body.rfind(PATHSEPARATOR) == std::string::npos ?
+                                 0 : body.rfind(PATHSEPARATOR) + 1));
 
-    bool binary = false;
-    bool cellsAreBoundaries = false;
+    VTUPiece_ all;
+    fillVTUPiece_(*this, vtuData_(), all);
 
-    std::vector < MeshEntity * > cells;
+    Index nCells = all.cellCount();
+    nPieces = std::max(Index(1), std::min(nPieces, nCells));
 
-    if (mesh.cellCount() == 0 && mesh.boundaryCount() > 0){
-        cellsAreBoundaries = true;
-        cells.reserve(mesh.boundaryCount());
-        for (uint i = 0; i < mesh.boundaryCount(); i ++) cells.push_back(& mesh.boundary(i));
-    } else {
-        cells.reserve(mesh.cellCount());
-        for (uint i = 0; i < mesh.cellCount(); i ++) cells.push_back(& mesh.cell(i));
+    for (Index i = 0; i < nPieces; i ++){
+        Index start = (nCells * i) / nPieces;
+        Index end = (nCells * (i + 1)) / nPieces;
+        VTUPiece_ p;
+        subVTUPiece_(all, start, end, p);
+        writeVTU_(body + "_" + str(i) + ".vtu", p, binary, compress, false, 14);
     }
 
-    uint nNodes = mesh.nodeCount();
-    uint nCells = cells.size();
-
-    file << "<Piece NumberOfPoints=\"" << nNodes << "\" NumberOfCells=\"" << nCells << "\">" << std::endl;
-
-    file << "<Points>" << std::endl;
-    file << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"ascii\">" << std::endl;
-    for (uint i = 0; i < mesh.nodeCount(); i ++) {
-        file << mesh.node(i).x() << " " << mesh.node(i).y() << " " << mesh.node(i).z() << " ";
-    }
-    file << std::endl << "</DataArray>" << std::endl;
-    file << "</Points>" << std::endl;
-
-    file << "<Cells>" << std::endl;
-    file << "<DataArray type=\"Int32\" Name=\"connectivity\" format=\"ascii\">" << std::endl;
-    for (uint i = 0; i < nCells; i ++) {
-        MeshEntity * cell = cells[i];
-        if (cell->rtti() == MESH_TETRAHEDRON10_RTTI){
-
-            file << cell->node(0).id() << " " << cell->node(1).id() << " "
-                << cell->node(2).id() << " " << cell->node(3).id() << " "
-                << cell->node(4).id() << " " << cell->node(7).id() << " "
-                << cell->node(5).id() << " " << cell->node(6).id() << " "
-                << cell->node(9).id() << " " << cell->node(8).id() << " ";
-        } else for (uint j = 0; j < cell->nodeCount(); j ++) file << cell->node(j).id() << " ";
-    }
-    file << std::endl << "</DataArray>" << std::endl;
-    file << "<DataArray type=\"Int32\" Name=\"offsets\" format=\"ascii\">" << std::endl;
-    uint count = 0;
-
-    for (uint i = 0; i < nCells; i ++) {
-        count += cells[i]->nodeCount();
-        file << count << " ";
-    }
-    file << std::endl << "</DataArray>" << std::endl;
-    file << "<DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">" << std::endl;
-
-    for (uint i = 0; i < nCells; i ++) {
-        switch (cells[i]->rtti()){
-            case MESH_BOUNDARY_NODE_RTTI: file     << "1 "; break;
-            case MESH_EDGE_CELL_RTTI:
-            case MESH_EDGE_RTTI: file          << "3 "; break;
-            case MESH_EDGE3_CELL_RTTI:
-            case MESH_EDGE3_RTTI: file         << "21 "; break;
-            case MESH_TRIANGLEFACE_RTTI:
-            case MESH_TRIANGLE_RTTI: file      << "5 "; break;
-            case MESH_TRIANGLEFACE6_RTTI:
-            case MESH_TRIANGLE6_RTTI: file     << "22 "; break;
-            case MESH_QUADRANGLEFACE_RTTI:
-            case MESH_QUADRANGLE_RTTI: file    << "9 "; break;
-            case MESH_QUADRANGLEFACE8_RTTI:
-            case MESH_QUADRANGLE8_RTTI: file   << "23 "; break;
-            case MESH_TETRAHEDRON_RTTI: file   << "10 "; break;
-            case MESH_TETRAHEDRON10_RTTI: file << "24 "; break;
-            case MESH_HEXAHEDRON_RTTI: file    << "12 "; break;
-            case MESH_HEXAHEDRON20_RTTI: file  << "25 "; break;
-            case MESH_POLYGON_FACE_RTTI: file  << "7 "; break; // VTK_POLYGON
-            default: std::cerr << WHERE_AM_I << " nothing know about." << cells[i]->rtti() << std::endl;
-        }
-    }
-    file << std::endl << "</DataArray>" << std::endl;
-    file << "</Cells>" << std::endl;
-
-    uint nodeData = 0, cellData = 0;
-
-    for (std::map < std::string, RVector >::const_iterator it = data.begin();
-         it != data.end(); it ++){
-
-
-        if (it->second.size() == nNodes && !cellsAreBoundaries) {
-            //NodeCount == Cellcount for cellsAreBoundaries(2d)
-            nodeData++;
-        } else if (it->second.size() == nCells) {
-            cellData++;
-        } else {
-            std::cerr << WHERE_AM_I << " dont know how to handle data array: " << it->first
-                        << " with size " << it->second.size() << " nodesize = " << nNodes
-                        << " cellsize = " << nCells << std::endl;
+    std::fstream file;
+    if (!openOutFile(body + ".pvtu", &file)) return;
+
+    VTUWriter_ w(file, binary, compress, false);
+    w.header("PUnstructuredGrid");
+    file << "<PUnstructuredGrid GhostLevel=\"0\">" << std::endl;
+    if (all.pointData.size() > 0){
+        file << "<PPointData>" << std::endl;
+        for (auto & it: all.pointData){
+            file << "<PDataArray type=\"" << w.pointDataType() << "\" Name=\""
+                 << it.first << "\"/>" << std::endl;
         }
+        file << "</PPointData>" << std::endl;
     }
-
-    if (nodeData > 0){
-        file << "<PointData>" << std::endl;
-        for (std::map < std::string, RVector >::const_iterator it = data.begin();
-              it != data.end(); it ++){
-            if (it->second.size() == nNodes && !cellsAreBoundaries ) {
-                 file << "<DataArray type=\"Float32\" Name=\""
-                      << it->first << "\" format=\"ascii\">" << std::endl;
-                 for (uint i = 0; i < it->second.size(); i ++) file << it->second[i] << " ";
-                 file << std::endl << "</DataArray>" << std::endl;
-            }
+    if (all.cellData.size() > 0){
+        file << "<PCellData>" << std::endl;
+        for (auto & it: all.cellData){
+            file << "<PDataArray type=\"Float64\" Name=\"" << it.first << "\"/>" << std::endl;
         }
-        file << "</PointData>" << std::endl;
+        file << "</PCellData>" << std::endl;
     }
-
-     if (cellData > 0){
-        file << "<CellData>" << std::endl;
-        for (std::map < std::string, RVector >::const_iterator it = data.begin();
-             it != data.end(); it ++){
-
-            if (it->second.size() == nCells) {
-                 file << "<DataArray type=\"Float64\" Name=\"" << it->first;
-                 if (!binary){
-                    file << "\" format=\"ascii\">" << std::endl;
-                    for (uint i = 0; i < it->second.size(); i ++) file << it->second[i] << " ";
-                 } else {
-                    file << "\" format=\"binary\">";
-                    file.write((char*)&it->second[0], it->second.size() * sizeof(double));
-                 }
-
-
-                 file << std::endl << "</DataArray>" << std::endl;
-            }
-        }
-        file << "</CellData>" << std::endl;
+    file << "<PPoints>" << std::endl
+         << "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>" << std::endl
+         << "</PPoints>" << std::endl;
+    for (Index i = 0; i < nPieces; i ++){
+        file << "<Piece Source=\"" << base << "_" << i << ".vtu\"/>" << std::endl;
     }
-
-    file << "</Piece>" << std::endl;
+    file << "</PUnstructuredGrid>" << std::endl;
+    file << "</VTKFile>" << std::endl;
+    file.close();
 }
 
 void Mesh::importMod(const std::string & filename){
@@ -293,6 +293,10 @@ public:
      * If no cell can be found NULL is returned. */
     inline Cell * neighborCell(uint i){ return neighborCells_[i]; }
 
+    /*! Set the direct neighbor cell for the i-th boundary. Used to restore
+     * known neighbor relationships, e.g., from a stored mesh. */
+    inline void setNeighborCell(uint i, Cell * cell){ neighborCells_[i] = cell; }
+
     /*! Find neighbor cell regarding to the i-th Boundary and store them
      * in neighborCells_. */
     virtual void findNeighborCell(uint i);
@@ -20,13 +20,14 @@
 
 #include "datacontainer.h"
 #include "mesh.h"
+#include "profiler.h"
 #include "regionManager.h"
 #include "stopwatch.h"
 #include "vector.h"
 #include "vectortemplates.h"
 #include "sparsematrix.h"
 
-#include "calculateMultiThread.h"
+#include "threadpool.h"
 
 namespace GIMLI{
 
@@ -54,10 +55,32 @@ ModellingBase::ModellingBase(const Mesh & mesh, DataContainer & data, bool verbo
     setMesh(mesh);
 }
 
+ModellingBase::ModellingBase(const ModellingBase & fop)
+    : sharedMesh_(fop.sharedMesh_), dataContainer_(fop.dataContainer_),
+      startModel_(fop.startModel_), verbose_(false){
+    mesh_               = fop.mesh_;
+    regionManager_      = fop.regionManager_;
+    regionManagerInUse_ = fop.regionManagerInUse_;
+    ownRegionManager_   = false;
+
+    jacobian_           = 0;
+    constraints_        = 0;
+    ownJacobian_        = false;
+    ownConstraints_     = false;
+
+    nThreads_           = fop.nThreads_;
+    nThreadsJacobian_   = 1;
+    jacobianStep_       = fop.jacobianStep_;
+    jacobianMinStep_    = fop.jacobianMinStep_;
+    jacobianCentral_    = fop.jacobianCentral_;
+
+    initJacobian();
+    initConstraints();
+}
+
 ModellingBase::~ModellingBase() {
     // __MS("delete: " << this)
     if (ownRegionManager_) delete regionManager_;
-    if (mesh_) delete mesh_;
     if (jacobian_ && ownJacobian_) delete jacobian_;
     if (constraints_ && ownConstraints_) delete constraints_;
 
@@ -74,8 +97,11 @@ void ModellingBase::init_() {
     constraints_        = 0;
     dataContainer_      = 0;
 
-    nThreads_           = min(8, numberOfCPU()-2);
+    nThreads_           = max(1, min(8, numberOfCPU()-2));
     nThreadsJacobian_   = 1;
+    jacobianStep_       = 0.05;
+    jacobianMinStep_    = 0.0;
+    jacobianCentral_    = false;
 
     ownJacobian_        = false;
     ownConstraints_     = false;
@@ -158,7 +184,7 @@ void ModellingBase::setStartModel(const RVector & startModel){
 void ModellingBase::createRefinedForwardMesh(bool refine, bool pRefine){
     this->initRegionManager();
 
-    if (regionManager_->pMesh()){
+    if (regionManager_->sharedMesh()){
         if (refine){
             if (pRefine){
                 log(Info, "Create P2 refined mesh for forward tasks.");
@@ -201,17 +227,62 @@ void ModellingBase::setMesh(const Mesh & mesh, bool ignoreRegionManager) {
 }
 
 void ModellingBase::setMesh_(const Mesh & mesh, bool update){
-    this->clearConstraints();
+    //** the region manager mesh is shared and not copied
+    const std::shared_ptr< Mesh > & rmMesh = regionManager_->sharedMesh();
+    if (rmMesh && &mesh == rmMesh.get()){
+        this->setMesh_(rmMesh, update);
+        return;
+    }
+    //** shared meshes are not changed, so the private copy gets its
+    //** neighbor infos now, see createNeighborInfos_
+    std::shared_ptr< Mesh > copy(new Mesh(mesh));
+    copy->createNeighborInfos();
+    this->setMesh_(copy, update);
+}
 
-    if (!mesh_) mesh_ = new Mesh();
+void ModellingBase::setMesh_(const std::shared_ptr< Mesh > & mesh, bool update){
+    this->clearConstraints();
 
     if (update) deleteMeshDependency_();
-    (*mesh_) = mesh;
+    sharedMesh_ = mesh;
+    mesh_ = sharedMesh_.get();
     if (update) updateMeshDependency_();
 }
 
+void ModellingBase::detachMesh_(bool update){
+    if (!sharedMesh_ || sharedMesh_.use_count() == 1) return;
+
+    //** copy first, so calls to mesh() from the dependency updates find
+    //** the private mesh
+    sharedMesh_.reset(new Mesh(*sharedMesh_));
+    mesh_ = sharedMesh_.get();
+    if (update) {
+        deleteMeshDependency_();
+        updateMeshDependency_();
+    }
+}
+
+Mesh * ModellingBase::attributeMesh_(){
+    if (!sharedMesh_) return mesh_;
+
+    //** the region manager is not owned by clones but never changes its
+    //** mesh while they respond, so reading it from a thread is fine
+    long owners = 1;
+    if (regionManager_ && regionManager_->sharedMesh() == sharedMesh_) owners ++;
+    if (sharedMesh_.use_count() > owners) this->detachMesh_();
+    return mesh_;
+}
+
+void ModellingBase::createNeighborInfos_() const {
+    if (!mesh_ || mesh_->neighborsKnown()) return;
+    if (sharedMesh_.use_count() > 1){
+        throwError(WHERE_AM_I + " the shared forward mesh has no neighbor infos.");
+    }
+    mesh_->createNeighborInfos();
+}
+
 void ModellingBase::deleteMesh(){
-    if (mesh_) delete mesh_;
+    sharedMesh_.reset();
     mesh_ = 0;
 }
 
@@ -234,57 +305,115 @@ void ModellingBase::setMultiThreadJacobian(Index nThreads){
     nThreadsJacobian_ = max(1, nThreads);
 }
 
-class JacobianBaseMT : public GIMLI::BaseCalcMT{
-public:
-    JacobianBaseMT(MatrixBase * J,
-                   const ModellingBase & fop,
-                   const RVector & resp,
-                   const RVector & model,
-                   bool verbose)
-    : BaseCalcMT(verbose), J_(J), fop_(&fop), _resp(&resp),
-      _model(&model) {
+void ModellingBase::setJacobianStep(double relStep, double absStep){
+    if (relStep <= 0.0 || absStep < 0.0){
+        throwError(WHERE_AM_I + " perturbation need to be positive: " +
+                   str(relStep) + " " + str(absStep));
     }
+    jacobianStep_ = relStep;
+    jacobianMinStep_ = absStep;
+}
 
-    virtual ~JacobianBaseMT(){}
-
-    virtual void calc(){
-        log(Debug, "Thread #" + str(_threadNumber) + ": on CPU " + str(schedGetCPU()) +
-                   " slice " + str(start_) + ":" + str(end_));
+void ModellingBase::createJacobianFD_(const RVector & model,
+                                      const RVector & resp, Index nThreads){
+    GIMLI_PROFILE_ZONE("ModellingBase::createJacobianFD");
+    if (!jacobian_){
+        this->initJacobian();
+    }
+    RMatrix *J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J){
+        throwError(WHERE_AM_I + " brute force Jacobian needs a RMatrix.");
+    }
+    Index nData = resp.size();
+    Index nModel = model.size();
+    if (J->rows() != nData || J->cols() != nModel) J->resize(nData, nModel);
+    if (nModel == 0) return;
+
+    nThreads = max(Index(1), min(nThreads, nModel));
+
+    //** one forward operator per thread, fall back to response_mt without
+    std::vector< std::unique_ptr< ModellingBase > > fops;
+    bool useClones = true;
+    for (Index i = 1; i < nThreads; i ++){
+        ModellingBase * fop = this->clone();
+        if (!fop) {
+            useClones = false;
+            fops.clear();
+            break;
+        }
+        fops.emplace_back(fop);
+    }
+    if (nThreads > 1 && !useClones){
+        log(Debug, "No clone() for the brute force Jacobian, use response_mt.");
+    }
 
-        RMatrix *J = dynamic_cast< RMatrix * >(J_);
+    std::vector< RVector > models(nThreads, model);
+    bool central = jacobianCentral_;
 
-        for (Index i = start_; i < end_; i ++) {
-            RVector modelChange(*_model);
-            modelChange[i] *= 1.05;
-            RVector respChange(fop_->response_mt(modelChange, i));
-            J->setCol(i, (respChange - *_resp) / (modelChange[i] - (*_model)[i]));
+    auto perturbed = [&](Index slot) -> RVector {
+        if (nThreads > 1 && !useClones){
+            return this->response_mt(models[slot], slot);
+        }
+        ModellingBase * fop = (slot == 0) ? this : fops[slot - 1].get();
+        RVector r(fop->response(models[slot]));
+        if (r.size() != nData){
+            throwError(WHERE_AM_I + " response size changed: " +
+                       str(r.size()) + " != " + str(nData));
+        }
+        return r;
+    };
+
+    //** columns of a chunk are collected contiguously and written at once
+    Index grain = max(Index(1), min(Index(32), nModel / (4 * nThreads)));
+
+    ThreadPool::instance().parallelFor(0, nModel, grain,
+        [&](Index start, Index end, Index slot){
+        RVector & m = models[slot];
+        Index width = end - start;
+        std::vector< double > block(width * nData, 0.0);
+
+        for (Index i = start; i < end; i ++){
+            double m0 = m[i];
+            double h = max(jacobianStep_ * std::fabs(m0), jacobianMinStep_);
+            double mp = m0 + h;
+            double * col = &block[(i - start) * nData];
+
+            //** parameters without perturbation, e.g. zero, stay inactive
+            if (h <= TOLERANCE) continue;
+
+            m[i] = mp;
+            RVector rp(perturbed(slot));
+
+            if (central){
+                double mm = m0 - h;
+                m[i] = mm;
+                RVector rm(perturbed(slot));
+                double dm = mp - mm;
+                for (Index k = 0; k < nData; k ++) col[k] = (rp[k] - rm[k]) / dm;
+            } else {
+                //** the step that is exactly representable
+                double dm = mp - m0;
+                for (Index k = 0; k < nData; k ++) col[k] = (rp[k] - resp[k]) / dm;
+            }
+            m[i] = m0;
         }
-    }
 
-protected:
-    MatrixBase              * J_;
-    const ModellingBase     * fop_;
-    const RVector           * _resp;
-    const RVector           * _model;
-};
+        for (Index k = 0; k < nData; k ++){
+            double * row = &(*J)[k][start];
+            for (Index j = 0; j < width; j ++) row[j] = block[j * nData + k];
+        }
+    }, nThreads);
+}
 
 void ModellingBase::createJacobian_mt(const RVector & model,
                                       const RVector & resp){
-    THROW_TO_IMPL
     if (verbose_) std::cout << "Create Jacobian matrix (brute force, mt) ...";
 
     Stopwatch swatch(true);
-    // double fak = 1.05;
-
-    if (!jacobian_){
-        this->initJacobian();
-    }
-    RMatrix *J = dynamic_cast< RMatrix * >(jacobian_);
-    if (J->rows() != resp.size()){ J->resize(resp.size(), model.size()); }
 
     ALLOW_PYTHON_THREADS
-    distributeCalc(JacobianBaseMT(jacobian_, *this, resp, model, verbose_),
-                   jacobian_->rows(), nThreadsJacobian_, verbose_);
+    this->createJacobianFD_(model, resp, nThreadsJacobian_);
+
     swatch.stop();
     if (verbose_) std::cout << " ... " << swatch.duration() << " s." << std::endl;
 }
@@ -294,48 +423,15 @@ void ModellingBase::createJacobian(const RVector & model,
     if (verbose_) std::cout << "Create Jacobian matrix (brute force) ...";
 
     Stopwatch swatch(true);
-    double fak = 1.05;
 
-    if (!jacobian_){
-        this->initJacobian();
-    }
-    RMatrix *J = dynamic_cast< RMatrix * >(jacobian_);
-    if (J->rows() != resp.size()){ J->resize(resp.size(), model.size()); }
-
-    for (size_t i = 0; i < model.size(); i++) {
-        RVector modelChange(model);
-        modelChange[i] *= fak;
-
-        RVector respChange(response(modelChange));
-
-        if (::fabs(modelChange[i] - model[i]) > TOLERANCE){
-            J->setCol(i, (respChange - resp) / (modelChange[i] - model[i]));
-        } else {
-            J->setCol(i, RVector(resp.size(), 0.0));
-        }
-
-//         __MS(i << " " << min(J->col(i)) << " " << max(J->col(i)))
-
-//         for (size_t j = 0; j < resp.size(); j++){
-//             if (::fabs(modelChange[i] - model[i]) > TOLERANCE){
-//                 (*J)[j][i] = (respChange[j] - resp[j]) / (modelChange[i] - model[i]);
-//             } else {
-//                 (*J)[j][i] = 0.0;
-//             }
-//         }
-    }
+    this->createJacobianFD_(model, resp, 1);
 
     swatch.stop();
     if (verbose_) std::cout << " ... " << swatch.duration() << " s." << std::endl;
 }
 
 void ModellingBase::createJacobian(const RVector & model){
-    RVector resp;
-    if (nThreadsJacobian_ > 1){
-        resp = response_mt(model);
-    } else {
-        resp = response(model);
-    }
+    RVector resp(response(model));
 
     if (!jacobian_){
         this->initJacobian();
@@ -417,7 +513,7 @@ RVector ModellingBase::createMappedModel(const RVector & model,
 
     int marker = -1;
     std::vector< Cell * > emptyList;
-    mesh_->createNeighborInfos();
+    this->createNeighborInfos_();
 
     for (Index i = 0, imax = mesh_->cellCount(); i < imax; i ++){
         marker = mesh_->cell(i).marker();
@@ -498,7 +594,8 @@ RVector ModellingBase::createMappedModel(const RVector & model,
 
 void ModellingBase::mapModel(const RVector & model, double background){
     // non readonly version"!!!!!!!!!!!
-    mesh_->setCellAttributes(createMappedModel(model, background));
+    RVector atts(createMappedModel(model, background));
+    this->attributeMesh_()->setCellAttributes(atts);
 }
 
 void ModellingBase::initRegionManager() {
@@ -21,6 +21,8 @@
 
 #include "gimli.h"
 #include "matrix.h"
+
+#include <memory>
 //#include "blockmatrix.h"
 
 namespace GIMLI{
@@ -39,8 +41,19 @@ public:
 
     ModellingBase(const Mesh & mesh, DataContainer & dataContainer, bool verbose=false);
 
+    /*! Shallow copy for \ref clone. Mesh, data container and region manager
+     * are shared with fop, Jacobian and constraints are not copied. */
+    ModellingBase(const ModellingBase & fop);
+
     virtual ~ModellingBase();
 
+    /*! Return a new forward operator that gives the same response as this
+     * one and can be used in parallel to it. Overload this to allow the
+     * brute force Jacobian to run on multiple threads, see
+     * \ref setMultiThreadJacobian. The caller owns the returned object.
+     * Default returns NULL, i.e., no cloning possible. */
+    virtual ModellingBase * clone() const { return NULL; }
+
     /*! Set verbose state. */
     void setVerbose(bool verbose);
 
@@ -85,7 +98,15 @@ public:
      * for the new mesh (i.e. for roll a long) */
     void setMesh(const Mesh & mesh, bool ignoreRegionManager=false);
 
-    inline Mesh * mesh() { return mesh_; }
+    /*! Return the forward mesh for write access. If the mesh is shared
+     * with the region manager or a clone, a private copy is made first
+     * and the mesh dependencies are recreated. Use the const version for
+     * read access, it never copies. */
+    inline Mesh * mesh() { this->detachMesh_(); return mesh_; }
+
+    /*! Return the forward mesh for read access. It may be shared with the
+     * region manager or clones of this forward operator. */
+    inline const Mesh * mesh() const { return mesh_; }
 
     void createRefinedForwardMesh(bool refine=true, bool pRefine=false);
 
@@ -107,10 +128,29 @@ public:
     /*! Create and fill the Jacobian matrix with a given model vector.
      * Multi-threaded version.
      * Will be called if setMultiThreadJacobian has been set > 1.
-     * For thread safe reasons response_mt, a read only variant of the response
-     * method need to be implemented. */
+     * Every thread uses its own forward operator from \ref clone.
+     * If clone is not implemented, response_mt, a read only variant of the
+     * response method, need to be implemented for thread safe reasons. */
     virtual void createJacobian_mt(const RVector & model, const RVector & resp);
 
+    /*! Set the perturbation for the brute force Jacobian. Parameter i is
+     * changed by max(relStep * |model[i]|, absStep). Default is 0.05 and
+     * 0.0, i.e., the column of a zero parameter is zero. */
+    void setJacobianStep(double relStep, double absStep=0.0);
+
+    /*! Return the relative perturbation for the brute force Jacobian. */
+    inline double jacobianStep() const { return jacobianStep_; }
+
+    /*! Use central instead of forward differences for the brute force
+     * Jacobian. Twice the number of responses but second order accurate. */
+    inline void setCentralDifferenceJacobian(bool central) {
+        jacobianCentral_ = central;
+    }
+
+    /*! Return true if central differences are used for the brute force
+     * Jacobian. */
+    inline bool centralDifferenceJacobian() const { return jacobianCentral_; }
+
     /*! Here you should initialize your Jacobian matrix. Default is RMatrix()*/
     virtual void initJacobian();
 
@@ -201,7 +241,7 @@ public:
 
     /*! Set number of threads used for brute force Jacobian generation.
      *1 is default. If nThreads is greater than 1 you need to implement
-     * \ref response_mt with a read only response function.
+     * \ref clone or \ref response_mt with a read only response function.
      * Maybe its worth set the single setThreadCount to 1 than,
      * that you don't find yourself in a threading overkill.*/
     void setMultiThreadJacobian(Index nThreads);
@@ -222,7 +262,35 @@ protected:
 
     void setMesh_(const Mesh & mesh, bool update=true);
 
+    /*! Use the reference counted mesh without copying it. */
+    void setMesh_(const std::shared_ptr< Mesh > & mesh, bool update=true);
+
+    /*! Copy on write: make the mesh private before changing markers or
+     * attributes. With update the mesh dependencies are recreated since
+     * they may point into the shared mesh. Clones may detach concurrently
+     * from their threads: the shared mesh is only read while copying and
+     * released afterwards, so the reference count of the other owners
+     * never drops before their copy is finished. */
+    void detachMesh_(bool update=true);
+
+    /*! Return the forward mesh for changing cell attributes, mesh data or
+     * temporary markers in place. A mesh shared only with the own region
+     * manager stays shared, since the region manager never reads them.
+     * It is copied (\ref detachMesh_) if a clone or another forward
+     * operator shares it too. */
+    Mesh * attributeMesh_();
+
+    /*! Create the neighbor infos of a private forward mesh if missing.
+     * Shared meshes always have them, since the region manager and
+     * \ref setMesh_ create them, and are never changed here. */
+    void createNeighborInfos_() const;
+
+    /*! Fill the Jacobian by finite differences using nThreads threads. */
+    void createJacobianFD_(const RVector & model, const RVector & resp,
+                           Index nThreads);
+
     Mesh                    * mesh_;
+    std::shared_ptr< Mesh > sharedMesh_;
 
     DataContainer           * dataContainer_;
 
@@ -244,6 +312,10 @@ protected:
     Index                   nThreads_;
     Index                   nThreadsJacobian_;
 
+    double                  jacobianStep_;
+    double                  jacobianMinStep_;
+    bool                    jacobianCentral_;
+
 private:
     RegionManager            * regionManager_;
 
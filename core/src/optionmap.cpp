@@ -100,7 +100,7 @@ void OptionMap::parse(int argc, char * argv[]){
       //      std::cout << "lastoption"<< lastOption_->name_ << " = "<< std::endl;
             lastOption_->assign(&lastString[0]);
         }
-    } else {
+    } else if (!lastString.empty()){
         std::cout << "Non-option argument: " << lastString << std::endl;
     }
 }
@@ -0,0 +1,261 @@
+/******************************************************************************
+ *   Copyright (C) 2005-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "profiler.h"
+#include "memwatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace GIMLI{
+
+template < > DLLEXPORT Profiler * Singleton < Profiler >::pInstance_ = NULL;
+
+static std::atomic< bool > __GIMLIProfilerEnabled__(false);
+static const std::chrono::steady_clock::time_point __GIMLIProfilerEpoch__ =
+    std::chrono::steady_clock::now();
+
+struct Profiler::ThreadLog {
+    struct Open {
+        const char * name;
+        double start;
+        double child;
+        double memory;
+    };
+
+    Index thread;
+    //** guards events, the stack is only touched by the owning thread
+    std::mutex mutex;
+    std::vector< ProfileEvent > events;
+    std::vector< Open > stack;
+};
+
+Profiler::Profiler() : trackMemory_(false) {
+}
+
+Profiler::~Profiler(){
+    for (auto * log: logs_) delete log;
+}
+
+bool Profiler::enabled(){
+    return __GIMLIProfilerEnabled__.load(std::memory_order_relaxed);
+}
+
+void Profiler::setEnabled(bool enabled){
+    __GIMLIProfilerEnabled__ = enabled;
+}
+
+double Profiler::now_() const {
+    return std::chrono::duration< double, std::micro >(
+        std::chrono::steady_clock::now() - __GIMLIProfilerEpoch__).count();
+}
+
+Profiler::ThreadLog * Profiler::threadLog_(){
+    static thread_local ThreadLog * log = 0;
+    if (!log){
+        std::lock_guard< std::mutex > lock(mutex_);
+        logs_.push_back(new ThreadLog());
+        log = logs_.back();
+        log->thread = logs_.size() - 1;
+    }
+    return log;
+}
+
+Profiler::ThreadLog * Profiler::begin_(const char * name){
+    ThreadLog * log = threadLog_();
+    ThreadLog::Open o;
+    o.name = name;
+    o.child = 0.0;
+    o.memory = trackMemory_ ? MemWatch::instance().inUse() : 0.0;
+    o.start = now_();
+    log->stack.push_back(o);
+    return log;
+}
+
+void Profiler::end_(ThreadLog * log){
+    double t = now_();
+    ThreadLog::Open o(log->stack.back());
+    log->stack.pop_back();
+
+    ProfileEvent e;
+    e.name = o.name;
+    e.start = o.start;
+    e.duration = t - o.start;
+    e.self = e.duration - o.child;
+    e.memory = trackMemory_ ? MemWatch::instance().inUse() - o.memory : 0.0;
+    e.thread = log->thread;
+    e.depth = log->stack.size();
+    if (!log->stack.empty()) log->stack.back().child += e.duration;
+
+    std::lock_guard< std::mutex > lock(log->mutex);
+    log->events.push_back(e);
+}
+
+ProfileCounter & Profiler::counter(const std::string & name){
+    std::lock_guard< std::mutex > lock(mutex_);
+    return counters_[name];
+}
+
+std::map< std::string, int64 > Profiler::counters() const {
+    std::lock_guard< std::mutex > lock(mutex_);
+    std::map< std::string, int64 > ret;
+    for (auto & c: counters_) ret[c.first] = c.second.value();
+    return ret;
+}
+
+std::vector< ProfileEvent > Profiler::events() const {
+    std::lock_guard< std::mutex > lock(mutex_);
+    std::vector< ProfileEvent > ret;
+    for (auto & log: logs_){
+        std::lock_guard< std::mutex > eLock(log->mutex);
+        ret.insert(ret.end(), log->events.begin(), log->events.end());
+    }
+    std::sort(ret.begin(), ret.end(),
+              [](const ProfileEvent & a, const ProfileEvent & b){
+                  return a.start < b.start; });
+    return ret;
+}
+
+void Profiler::clear(){
+    std::lock_guard< std::mutex > lock(mutex_);
+    for (auto & log: logs_){
+        std::lock_guard< std::mutex > eLock(log->mutex);
+        log->events.clear();
+    }
+    for (auto & c: counters_) c.second.reset();
+}
+
+std::string Profiler::summary() const {
+    struct Entry {
+        Entry() : calls(0), total(0.0), self(0.0), max(0.0), memory(0.0) {}
+        Index calls;
+        double total, self, max, memory;
+    };
+    std::map< std::string, Entry > zones;
+    for (auto & e: this->events()){
+        Entry & z = zones[e.name];
+        z.calls ++;
+        z.total += e.duration;
+        z.self += e.self;
+        z.max = std::max(z.max, e.duration);
+        z.memory += e.memory;
+    }
+    std::vector< std::pair< std::string, Entry > > sorted(zones.begin(), zones.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair< std::string, Entry > & a,
+                 const std::pair< std::string, Entry > & b){
+                  return a.second.total > b.second.total; });
+
+    std::stringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << std::setw(10) << "calls" << std::setw(14) << "total/ms"
+        << std::setw(14) << "self/ms" << std::setw(14) << "max/ms";
+    if (trackMemory_) out << std::setw(12) << "mem/MB";
+    out << "  zone" << std::endl;
+    for (auto & z: sorted){
+        out << std::setw(10) << z.second.calls
+            << std::setw(14) << z.second.total * 1e-3
+            << std::setw(14) << z.second.self * 1e-3
+            << std::setw(14) << z.second.max * 1e-3;
+        if (trackMemory_) out << std::setw(12) << z.second.memory;
+        out << "  " << z.first << std::endl;
+    }
+    for (auto & c: this->counters()){
+        out << std::setw(10) << c.second << "  " << c.first << std::endl;
+    }
+    return out.str();
+}
+
+static std::string jsonString_(const std::string & s){
+    std::string ret("\"");
+    for (auto c: s){
+        if (c == '"' || c == '\\') ret += '\\';
+        ret += c;
+    }
+    return ret + "\"";
+}
+
+void Profiler::exportChromeTrace(const std::string & filename) const {
+    std::ofstream file(filename.c_str());
+    if (!file){
+        throwError(WHERE_AM_I + " cannot open file: " + filename);
+    }
+    std::vector< ProfileEvent > events(this->events());
+
+    file << std::setprecision(15);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+    Index nThreads = 0;
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        nThreads = logs_.size();
+    }
+    for (Index i = 0; i < nThreads; i ++){
+        file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+             << i << ", \"args\": {\"name\": \"thread " << i << "\"}}," << std::endl;
+    }
+    double end = now_();
+    for (auto & e: events){
+        file << "{\"name\": " << jsonString_(e.name)
+             << ", \"cat\": \"gimli\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread
+             << ", \"ts\": " << e.start << ", \"dur\": " << e.duration
+             << ", \"args\": {\"self\": " << e.self;
+        if (trackMemory_) file << ", \"memory\": " << e.memory;
+        file << "}}," << std::endl;
+    }
+    for (auto & c: this->counters()){
+        file << "{\"name\": " << jsonString_(c.first)
+             << ", \"cat\": \"gimli\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << end
+             << ", \"args\": {\"count\": " << c.second << "}}," << std::endl;
+    }
+    //** closing event, so every entry above can end with a comma
+    file << "{\"name\": \"end\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": "
+         << end << "}" << std::endl << "]}" << std::endl;
+}
+
+//** GIMLI_PROFILE=[filename]: record the whole program and report at exit
+static std::string __GIMLIProfilerFile__;
+
+static void profilerAtExit_(){
+    Profiler & p = Profiler::instance();
+    std::cout << p.summary();
+    if (!__GIMLIProfilerFile__.empty() && __GIMLIProfilerFile__ != "1"){
+        try {
+            p.exportChromeTrace(__GIMLIProfilerFile__);
+        } catch(std::exception & e){
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+static struct ProfilerEnv_ {
+    ProfilerEnv_(){
+        const char * f = std::getenv("GIMLI_PROFILE");
+        if (f){
+            __GIMLIProfilerFile__ = f;
+            Profiler::instance().setEnabled(true);
+            std::atexit(profilerAtExit_);
+        }
+    }
+} __GIMLIProfilerEnv__;
+
+} // namespace GIMLI
@@ -0,0 +1,175 @@
+/******************************************************************************
+ *   Copyright (C) 2005-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_PROFILER__H
+#define _GIMLI_PROFILER__H
+
+#include "gimli.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#define GIMLI_PROFILE_CAT2_(a, b) a##b
+#define GIMLI_PROFILE_CAT_(a, b) GIMLI_PROFILE_CAT2_(a, b)
+
+#if USE_PROFILING
+    /*! Time the enclosing scope as zone with name (a string literal). */
+    #define GIMLI_PROFILE_ZONE(name) \
+        GIMLI::ProfileZone GIMLI_PROFILE_CAT_(__gimliZone, __LINE__)(name)
+    /*! Add n to the counter with name (a string literal). */
+    #define GIMLI_PROFILE_COUNT(name, n) \
+        do { if (GIMLI::Profiler::enabled()) { \
+            static GIMLI::ProfileCounter & __gimliCounter__ = \
+                GIMLI::Profiler::instance().counter(name); \
+            __gimliCounter__.add(n); } } while (0)
+#else
+    #define GIMLI_PROFILE_ZONE(name) do {} while (0)
+    #define GIMLI_PROFILE_COUNT(name, n) do {} while (0)
+#endif
+
+namespace GIMLI{
+
+//! Finished profile zone, times are in microseconds since profiler start.
+struct DLLEXPORT ProfileEvent {
+    const char * name;
+    double start;
+    double duration;
+    /*! Duration without the nested zones of the same thread. */
+    double self;
+    /*! Change of the process memory in MByte, if memory tracking is on. */
+    double memory;
+    Index thread;
+    Index depth;
+};
+
+//! Thread safe event counter, see \ref GIMLI_PROFILE_COUNT.
+class DLLEXPORT ProfileCounter {
+public:
+    ProfileCounter() : value_(0) {}
+
+    inline void add(int64 n=1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+    inline int64 value() const { return value_.load(std::memory_order_relaxed); }
+
+    inline void reset() { value_ = 0; }
+
+protected:
+    std::atomic< int64 > value_;
+};
+
+//! Hierarchical profiler for nested zones and counters.
+/*! Collects the zones of all threads and the counters of the process.
+ * Recording is off until setEnabled(true) is called or the environment
+ * variable GIMLI_PROFILE is set. With GIMLI_PROFILE=trace.json the trace
+ * is written and the summary is shown at program exit.
+ *
+ * The instrumentation macros \ref GIMLI_PROFILE_ZONE and
+ * \ref GIMLI_PROFILE_COUNT are only compiled if the library is built with
+ * USE_PROFILING (cmake -DGIMLI_PROFILING=ON), otherwise they vanish.
+ * Zones created directly with \ref ProfileZone work always.
+ *
+ * This is a singleton class, use e.g.:
+ * Profiler::instance().exportChromeTrace("trace.json") */
+class DLLEXPORT Profiler : public Singleton< Profiler > {
+public:
+    friend class Singleton< Profiler >;
+    friend class ProfileZone;
+
+    /*! Return true if zones and counters are recorded. */
+    static bool enabled();
+
+    /*! Switch recording on or off. */
+    void setEnabled(bool enabled);
+
+    /*! Record the change of process memory (see \ref MemWatch) for every
+     * zone. This reads /proc twice per zone, so default is false. */
+    void setTrackMemory(bool track) { trackMemory_ = track; }
+
+    bool trackMemory() const { return trackMemory_; }
+
+    /*! Return the counter with name, create it if needed. The reference
+     * stays valid for the lifetime of the profiler. */
+    ProfileCounter & counter(const std::string & name);
+
+    /*! Return the counter values. */
+    std::map< std::string, int64 > counters() const;
+
+    /*! Return all finished zones of all threads. */
+    std::vector< ProfileEvent > events() const;
+
+    /*! Remove all recorded zones and reset the counters. */
+    void clear();
+
+    /*! Return a flat summary with calls, total, self and max time per zone,
+     * sorted by total time, followed by the counters. */
+    std::string summary() const;
+
+    /*! Write all zones and counters in the Chrome trace event format,
+     * to be viewed with chrome://tracing or https://ui.perfetto.dev */
+    void exportChromeTrace(const std::string & filename) const;
+
+protected:
+    struct ThreadLog;
+
+    ThreadLog * threadLog_();
+
+    ThreadLog * begin_(const char * name);
+
+    void end_(ThreadLog * log);
+
+    double now_() const;
+
+    std::vector< ThreadLog * > logs_;
+    std::map< std::string, ProfileCounter > counters_;
+    mutable std::mutex mutex_;
+    bool trackMemory_;
+
+private:
+    /*! Private so that it can not be called */
+    Profiler();
+    /*! Private so that it can not be called */
+    virtual ~Profiler();
+    /*! Copy constructor is private, so don't use it */
+    Profiler(const Profiler &){};
+    /*! Assignment operator is private, so don't use it */
+    void operator = (const Profiler &){ };
+};
+
+//! Scoped profile zone.
+/*! Records the lifetime of this object as zone with the given name if the
+ * profiler is enabled. The name must outlive the profiler, e.g., a string
+ * literal. Usually created with \ref GIMLI_PROFILE_ZONE. */
+class DLLEXPORT ProfileZone {
+public:
+    ProfileZone(const char * name)
+        : log_(Profiler::enabled() ? Profiler::instance().begin_(name) : 0) {}
+
+    ~ProfileZone(){ if (log_) Profiler::instance().end_(log_); }
+
+protected:
+    Profiler::ThreadLog * log_;
+
+private:
+    ProfileZone(const ProfileZone &){};
+    void operator = (const ProfileZone &){ };
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_PROFILER__H
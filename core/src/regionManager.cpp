@@ -20,12 +20,15 @@
 
 #include "mesh.h"
 #include "node.h"
+#include "profiler.h"
 #include "shape.h"
 #include "sparsematrix.h"
 #include "stopwatch.h"
 #include "trans.h"
 #include "vectortemplates.h"
 
+#include <unordered_map>
+
 namespace GIMLI{
 
 Region::Region(SIndex marker, RegionManager * parent, bool single)
@@ -170,6 +173,14 @@ void Region::resize(const std::vector < Cell * > & cells){
     this->constraintWeights_.clear();
 }
 
+void Region::resize(const std::vector < Cell * > & cells,
+                    const std::vector < Boundary * > & bounds){
+    cells_ = cells;
+    bounds_.clear();
+    if (!isBackground_ && !isSingle_) bounds_ = bounds;
+    this->constraintWeights_.clear();
+}
+
 void Region::countParameter(Index start){
 //     __MS(marker()<< " " << fixValue())
     startParameter_ = start;
@@ -225,6 +236,11 @@ void Region::permuteParameterMarker(const IndexArray & p){
     for (Index i = 0; i < paraIDs_.size(); i ++) paraIDs_[i] = p[paraIDs_[i]];
 }
 
+void Region::remapMesh(const Mesh & mesh){
+    for (auto & c: cells_) c = &mesh.cell(c->id());
+    for (auto & b: bounds_) b = &mesh.boundary(b->id());
+}
+
 //################ Start values
 void Region::setStartModel(const RVector & start){
     if (isBackground_){
@@ -557,7 +573,7 @@ void Region::setParameters(double start, double lb, double ub, std::string trans
 }
 
 //******************************************************************************
-RegionManager::RegionManager(bool verbose) : verbose_(verbose), mesh_(NULL){
+RegionManager::RegionManager(bool verbose) : verbose_(verbose){
     paraDomain_ = new Mesh();
     parameterCount_ = 0;
     haveLocalTrans_ = false;
@@ -582,12 +598,32 @@ RegionManager::~RegionManager(){
 }
 
 const Mesh & RegionManager::mesh() const {
-    if (mesh_== 0){
+    if (!mesh_){
         throwError("RegionManager knows no mesh.");
     }
     return *mesh_;
 }
 
+Mesh * RegionManager::pMesh(){
+    this->detachMesh_();
+    return mesh_.get();
+}
+
+void RegionManager::detachMesh_(){
+    if (!mesh_ || mesh_.use_count() == 1) return;
+
+    if (verbose_) std::cout << "RegionManager: mesh is shared, copying on write." << std::endl;
+    std::shared_ptr< Mesh > mesh(new Mesh(*mesh_));
+
+    //** the copy has the same entity ids, so just move all pointers
+    for (auto & x: this->regionMap_) x.second->remapMesh(*mesh);
+
+    for (auto & x: this->interRegionInterfaceMap_){
+        for (auto & b: x.second) b = &mesh->boundary(b->id());
+    }
+    mesh_ = mesh;
+}
+
 Region * RegionManager::region(SIndex marker){
     if (regionMap_.count(marker) == 0){
         throwError(WHERE_AM_I + " no region with marker " + str(marker));
@@ -610,11 +646,12 @@ void RegionManager::clear(){
     _cWeights.clear();
 
     if (paraDomain_) { paraDomain_->clear(); }
-    if (mesh_) { delete mesh_; mesh_ = NULL; }
+    mesh_.reset();
 }
 
 
 void RegionManager::setMesh(const Mesh & mesh, bool holdRegionInfos){
+    GIMLI_PROFILE_ZONE("RegionManager::setMesh");
 
     if (!holdRegionInfos){
         if (verbose_) std::cout << "Reset region parameter" << std::endl;
@@ -624,8 +661,7 @@ void RegionManager::setMesh(const Mesh & mesh, bool holdRegionInfos){
     Stopwatch swatch(true);
     if (verbose_) std::cout << "RegionManager copying mesh ...";
 
-    if (mesh_) delete mesh_;
-    mesh_ = new Mesh(mesh);
+    mesh_.reset(new Mesh(mesh));
 
     if (verbose_){
         std::cout << swatch.duration(true) << " s " << std::endl;
@@ -648,40 +684,44 @@ void RegionManager::setMesh(const Mesh & mesh, bool holdRegionInfos){
         log(Info, "More than 50 regions, so we assume single regions only.");
     }
 
-    std::map < int, std::vector< Cell * > > markerCellVectorMap;
-    if (singleOnly){
-        for(std::vector< Cell * >::const_iterator it = mesh_->cells().begin();
-                                               it != mesh_->cells().end(); it++){
-            if (! markerCellVectorMap.count((*it)->marker())){
-                markerCellVectorMap[(*it)->marker()] = std::vector< Cell * >();
+    //** sort cells and inner boundaries by marker in one pass over the mesh
+    std::unordered_map< SIndex, Index > markerIdx;
+    for (Index i = 0; i < regions.size(); i ++) markerIdx[regions[i]] = i;
+
+    std::vector< std::vector< Cell * > > regionCells(regions.size());
+    for (auto & c: mesh_->cells()){
+        regionCells[markerIdx[c->marker()]].push_back(c);
+    }
+
+    std::vector< std::vector< Boundary * > > regionBounds(regions.size());
+    if (!singleOnly){
+        if (mesh_->boundaryCount() == 0) {
+            std::cerr << "WARNING! no boundaries defined! run mesh.createNeighborInfos()" << std::endl;
+        }
+        for (auto & b: mesh_->boundaries()){
+            if (b->leftCell() && b->rightCell() &&
+                b->leftCell()->marker() == b->rightCell()->marker()){
+                regionBounds[markerIdx[b->leftCell()->marker()]].push_back(b);
             }
-            markerCellVectorMap[(*it)->marker()].push_back((*it));
         }
     }
 
     for (Index i = 0; i < regions.size(); i ++){
         if (singleOnly){
-            createSingleRegion_(regions[i], markerCellVectorMap[regions[i]]);
+            createSingleRegion_(regions[i], regionCells[i]);
         } else {
-            createRegion_(regions[i], *mesh_, regions[i]);
+            createRegion_(regions[i], regionCells[i], regionBounds[i]);
         }
     }
-    //** looking for and create region interfaces
 
     //** looking for and create inter-region interfaces
     this->findInterRegionInterfaces();
 
     if (singleOnly){
         log(Info, "Applying *:* interregion constraints.");
-        for (Index i = 0; i < regions.size(); i ++){
-            for (Index j = 0; j < regions.size(); j ++){
-                if (i != j){
-                    setInterRegionConstraint(regions[i], regions[j], 1.0);
-                                // if (verbose_) std::cout << minRegion[i] << " <-> "
-                                //                         << maxRegion[j] << " weight:"
-                                //                         << toDouble(row[2]) << std::endl;
-                }
-            }
+        //** only regions with a common interface can be constrained
+        for (auto & x: this->interRegionInterfaceMap_){
+            setInterRegionConstraint(x.first.first, x.first.second, 1.0);
         }
     }
     this->recountParaMarker_();
@@ -719,6 +759,21 @@ Region * RegionManager::createRegion_(SIndex marker, const Mesh & mesh, SIndex c
     return region;
 }
 
+Region * RegionManager::createRegion_(SIndex marker,
+                                     const std::vector < Cell * > & cells,
+                                     const std::vector < Boundary * > & bounds){
+    Region * region = NULL;
+
+    if (regionMap_.count(marker) == 0){
+        region = new Region(marker, this);
+        regionMap_.insert(std::make_pair(marker, region));
+    } else {
+        region = regionMap_[marker];
+    }
+    region->resize(cells, bounds);
+    return region;
+}
+
 Region * RegionManager::addRegion(SIndex marker){
     Region * region = createSingleRegion_(marker, std::vector < Cell * > ());
     recountParaMarker_(); //** make sure the counter is right
@@ -750,6 +805,7 @@ void RegionManager::createParaDomain_(){
 }
 
 void RegionManager::permuteParameterMarker(const IVector & p){
+    this->detachMesh_();
     isPermuted_ = true;
     for (auto & x: this->regionMap_){
         x.second->permuteParameterMarker(p);
@@ -758,6 +814,7 @@ void RegionManager::permuteParameterMarker(const IVector & p){
 }
 
 void RegionManager::recountParaMarker_(){
+    this->detachMesh_();
     Index count = 0;
     for (auto & x: this->regionMap_){
         x.second->countParameter(count);
@@ -772,9 +829,6 @@ void RegionManager::findInterRegionInterfaces(){
     interRegionInterfaceMap_.clear();
     interRegionConstraints_.clear();
 
-    //** having fun with stl
-    std::map< std::pair< SIndex, SIndex >, std::list < Boundary * > > ::iterator iRMapIter;
-
     for (auto & bIter: mesh_->boundaries()){
         Boundary & b = *bIter;
 
@@ -785,15 +839,7 @@ void RegionManager::findInterRegionInterfaces(){
                 SIndex maxMarker = max(b.leftCell()->marker(),
                                        b.rightCell()->marker());
 
-                iRMapIter = interRegionInterfaceMap_.find(std::pair< SIndex, SIndex >(minMarker, maxMarker));
-
-                if (iRMapIter == interRegionInterfaceMap_.end()){
-                    interRegionInterfaceMap_.insert(std::pair<
-                        std::pair< SIndex, SIndex >,                       std::list < Boundary * > > (std::pair< SIndex, SIndex>(minMarker, maxMarker),
-                                        std::list< Boundary* >()));
-                }
-
-                interRegionInterfaceMap_[std::pair< SIndex, SIndex > (minMarker, maxMarker)].push_back(&b);
+                interRegionInterfaceMap_[std::pair< SIndex, SIndex >(minMarker, maxMarker)].push_back(&b);
             }
         }
     }
@@ -908,9 +954,9 @@ Index RegionManager::interRegionConstraintsCount() const {
             regionMap_.find(ab.second)->second->isSingle()){
              count += 1;
         } else {
-            if (interRegionInterfaceMap_.find(ab) !=
-                interRegionInterfaceMap_.end()){
-                count += interRegionInterfaceMap_.find(ab)->second.size();
+            auto iRMapIter = interRegionInterfaceMap_.find(ab);
+            if (iRMapIter != interRegionInterfaceMap_.end()){
+                count += iRMapIter->second.size();
             }
         }
     }
@@ -985,7 +1031,7 @@ void RegionManager::fillConstraints(RSparseMapMatrix & C){
 
             if (iRMapIter != interRegionInterfaceMap_.end()){
 
-                std::list< Boundary * > bounds = iRMapIter->second;
+                const std::list< Boundary * > & bounds = iRMapIter->second;
 
                 for (auto & bIter : bounds){
 
@@ -26,6 +26,7 @@
 
 #include <set>
 #include <list>
+#include <memory>
 
 namespace GIMLI{
 
@@ -61,6 +62,11 @@ public:
     /*! Set new parameter cells, i.e. update the related mesh and all sizes. Only for single region.*/
     void resize(const std::vector < Cell * > & cells);
 
+    /*! Set new parameter cells and the boundaries between them, e.g.,
+     * collected by the RegionManager for all regions at once. */
+    void resize(const std::vector < Cell * > & cells,
+                const std::vector < Boundary * > & bounds);
+
     /*! Mark this region to be a background region, need RegionManger::recount */
     inline void markBackground(bool background){ isBackground_ = background; }
 
@@ -167,6 +173,10 @@ public:
     /*!Permute parameter indecies.*/
     void permuteParameterMarker(const IndexArray & p);
 
+    /*! Move the cell and boundary pointers to mesh, which needs to be an
+     * identical copy (same entity ids) of the mesh this region lives in. */
+    void remapMesh(const Mesh & mesh);
+
     /*! Return all parameter indices of this region.*/
     const IndexArray & paraIds() const { return paraIDs_; }
 
@@ -272,7 +282,13 @@ public:
 
     const Mesh & mesh() const;
 
-    inline Mesh * pMesh() { return mesh_; }
+    /*! Return the mesh for write access. If the mesh is shared with a
+     * forward operator, a private copy is made first. */
+    Mesh * pMesh();
+
+    /*! Return the reference counted mesh, empty if there is none. Forward
+     * operators share it and need to copy it before any change. */
+    const std::shared_ptr< Mesh > & sharedMesh() const { return mesh_; }
 
     /*!Add an new single region.*/
     Region * addRegion(SIndex marker);
@@ -401,6 +417,11 @@ protected:
      */
     Region * createRegion_(SIndex marker, const Mesh & mesh, SIndex cellMarker);
 
+    /*! Create or update the region marker with given cells and inner
+     * boundaries. */
+    Region * createRegion_(SIndex marker, const std::vector < Cell * > & cells,
+                           const std::vector < Boundary * > & bounds);
+
     /*!
      * Internal method to create a single parameter region. The method is called from \ref setMesh()
      */
@@ -408,12 +429,17 @@ protected:
 
     IVector allRegionMarker_(bool excludeBoundary=false) const;
 
+    /*! Copy on write: give the regions a private mesh copy if the mesh is
+     * shared, i.e., with a forward operator, before markers are changed. */
+    void detachMesh_();
+
     bool verbose_;
     bool isPermuted_;
 
     Index parameterCount_;
 
-    Mesh * mesh_;
+    /*! The mesh is shared with \ref ModellingBase and only copied on write. */
+    std::shared_ptr< Mesh > mesh_;
     Mesh * paraDomain_;
 
     std::map < SIndex, Region * > regionMap_;
@@ -104,112 +104,109 @@ int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
     double aQ = 0.0;
     int count = 0;
 
-    Vec q(nData, 0.0);
-    Vec wcp(nConst, 0.0); // nBounds
-
-//     std::cout.precision(14);
-    // std::cout << "###############################################" << std::endl;
-    // std::cout << 0 << "  " << accuracy << std::endl;
-
-    // hack until matMult with expression templates
-    Vec pwm(nConst, 0.0);
-    Vec p_tm(nModel, 0.0);
-    Vec x_tm(nModel, 0.0);
-    Vec zdWtd(nData, 0.0);
-    Vec wmx(nConst, 0.0);
-    Vec wcwcCwmx(nConst, 0.0);
-    Vec Cpwm(nConst, 0.0);
+    //** preallocated workspaces, the loop below only allocates inside the
+    //** virtual S/C (trans)mult calls
+    Vec dWtd(dW * td);              // nData
+    Vec zdWtd(nData, 0.0);          // nData
+    Vec q(nData, 0.0);              // nData
+    Vec p_tm(nModel, 0.0);          // nModel
+    Vec pwm(nModel, 0.0);           // nModel
+    Vec wcp(nConst, 0.0);           // nConst
+    Vec Cwmx(C * Vec(wm * x));      // nConst, mostly updated by recurrence
+    Vec wcwcCwmx(nConst, 0.0);      // nConst
+
+    double * px     = &x[0];
+    double * pp     = &p[0];
+    double * pr     = &r[0];
+    double * pz     = &z[0];
+    double * pq     = &q[0];
+    const double * ptm    = &tm[0];
+    const double * pwmv   = &wm[0];
+    const double * pwc    = &wc[0];
+    const double * pcdx   = &cdx[0];
+    const double * pdWtd  = &dWtd[0];
+
+    //** vector operations are only worth threading for large models
+    const bool mt = useOMP() && max(nModel, nData) > 100000;
 
     while (count < maxIter && normR2 > accuracy){
         count ++;
-        p_tm.assign(p / tm);
-        q = (S * p_tm) * (dW * td);
-        // q = S * Vec(p / tm) * dW * td;
-        // std::cout << "q " << min(q) << " " << max(q) << " " << mean(q) << std::endl;
-        // q = round(q, 1e-10);
-        // std::cout << "q " << min(q) << " " << max(q) << " " << mean(q) << std::endl;
-        pwm.assign(p * wm);
-        Cpwm.assign(C * pwm);
-        
+
+        double * pptm = &p_tm[0];
+        double * ppwm = &pwm[0];
+#pragma omp parallel for if (mt)
+        for (Index i = 0; i < nModel; i ++){
+            pptm[i] = pp[i] / ptm[i];
+            ppwm[i] = pp[i] * pwmv[i];
+        }
+
+        const Vec Sp(S * p_tm);
+        const double * pSp = &Sp[0];
+        double qq = 0.0;
+#pragma omp parallel for reduction(+:qq) if (mt)
+        for (Index i = 0; i < nData; i ++){
+            pq[i] = pSp[i] * pdWtd[i];
+            qq += pq[i] * pq[i];
+        }
+
         //** try to avoid accuracy problems with unsorted C
-        Cpwm.round(1e-10);
-
-        // Vec Cpwm((C * pwm));
-        wcp = wc * Cpwm;
-        
-        // std::cout << "pwm " << min(pwm) << " " << max(pwm) << " " << mean(pwm) << std::endl;
-        // std::cout << "Cpwm " << min(Cpwm) << " " << max(Cpwm) << " " << mean(Cpwm) << std::endl;
-        // std::cout << "wcp " << min(wcp) << " " << max(wcp) << " " << mean(wcp) << std::endl;
-
-        if (count == 1 && std::fabs(mean(Cpwm)+17.00029) < 1e-2){
-            // C.save("C17000.bmat");
-            // pwm.save("pwm1700.bmat");
-            //throwError("debug halt");
-__MS("##################################################################")
+        const Vec Cpwm(C * pwm);
+        const double * pCpwm = &Cpwm[0];
+        double * pwcp = &wcp[0];
+        double ww = 0.0;
+#pragma omp parallel for reduction(+:ww) if (mt)
+        for (Index i = 0; i < nConst; i ++){
+            pwcp[i] = pwc[i] * roundTo(pCpwm[i], 1e-10);
+            ww += pwcp[i] * pwcp[i];
         }
-        // if (count == 1 && std::fabs(mean(Cpwm)+17.708) < 1e-2){
-        //     // C.save("C17708.bmat");
-        //     // pwm.save("pwm17708.bmat");
-        //     throwError("debug halt");
-        // }
-        // wcp = wc * (C * pwm);
-        // wcp = round(wcp, 1e-10);
-
-
-        aQ = (dot(q, q) + lambda * dot(wcp, wcp));
-        // if (aQ < 1e-10){
-        //     aQ = 1e-10;
-        // }
-        
-        // std::cout << "aQ " << aQ<< std::endl;
+
+        aQ = qq + lambda * ww;
         alpha = normR2 / aQ;
-        //alpha = std::round(alpha * 1e10) / 1e10;
 
-        x += p * alpha;
+#pragma omp parallel for if (mt)
+        for (Index i = 0; i < nModel; i ++) px[i] += pp[i] * alpha;
 
-        if ((count % 10) == -1) { // TOM
-            x_tm.assign(x / tm);
-            z = bR - (S * x_tm) * td; // z exakt durch extra Mult.
-            z *= dW;
-        } else {
-            z -= q * alpha;
+        double * pzdWtd = &zdWtd[0];
+#pragma omp parallel for if (mt)
+        for (Index i = 0; i < nData; i ++){
+            pz[i] -= pq[i] * alpha;
+            pzdWtd[i] = pz[i] * pdWtd[i];
         }
-        //z = round(z, 1e-10);
 
-        zdWtd.assign(z * dW * td);
-        wmx.assign(wm * x);
-        wcwcCwmx.assign(wc * wc * (C * wmx));
+        //** C * (wm * x) follows x without an extra multiplication, but is
+        //** recomputed from time to time against accumulated rounding errors
+        if (count % 50 == 0){
+#pragma omp parallel for if (mt)
+            for (Index i = 0; i < nModel; i ++) ppwm[i] = px[i] * pwmv[i];
+            Cwmx = C * pwm;
+        } else {
+            double * pCwmx = &Cwmx[0];
+#pragma omp parallel for if (mt)
+            for (Index i = 0; i < nConst; i ++) pCwmx[i] += pCpwm[i] * alpha;
+        }
+        const double * pCwmx = &Cwmx[0];
+        double * pwcwc = &wcwcCwmx[0];
+#pragma omp parallel for if (mt)
+        for (Index i = 0; i < nConst; i ++){
+            pwcwc[i] = pwc[i] * pwc[i] * pCwmx[i];
+        }
 
-        r =   transMult(S, zdWtd) / tm 
-            - transMult(C, wcwcCwmx) * wm * lambda - cdx;
-        // r = transMult(S, Vec(z * dW * td)) / tm 
-        //     - transMult(C, Vec(wc * wc * (C * Vec(wm * x)))) * wm * lambda 
-        //     - cdx;
-        //r = round(r, 1e-8);
+        const Vec StZ(transMult(S, zdWtd));
+        const Vec CtW(transMult(C, wcwcCwmx));
+        const double * pStZ = &StZ[0];
+        const double * pCtW = &CtW[0];
 
         normR2old = normR2;
-        normR2 = dot(r, r);
+        normR2 = 0.0;
+#pragma omp parallel for reduction(+:normR2) if (mt)
+        for (Index i = 0; i < nModel; i ++){
+            pr[i] = pStZ[i] / ptm[i] - pCtW[i] * pwmv[i] * lambda - pcdx[i];
+            normR2 += pr[i] * pr[i];
+        }
         beta = normR2 / normR2old;
-        //beta = std::round(beta * 1e10) / 1e10;
-
-        p = r + p * beta;
-
-//         std::cout << "\n" << count << " +++++"  << " " << normR2<< std::endl;
-//         std::cout << alpha << " " << beta<< " " << alpha << std::endl;
-//         std::cout << "q " << min(q) << " " << max(q) << " " << mean(q) << std::endl;
-//         std::cout << "wcp "  << min(wcp) << " " << max(wcp) << " " << mean(wcp) << std::endl;
-//         std::cout << "x "  << min(x) << " " << max(x) << " " << mean(x) << std::endl;
-//         std::cout << "r "  << min(r) << " " << max(r) << " " << mean(r) << std::endl;
-//         std::cout << "p "  << min(p) << " " << max(p) << " " << mean(p) << std::endl;
-        
-// __MS("---" << count << "-------" << normR2 << "-------------------------")
-// __MS(min(q) << " " << max(q) << " " << mean(q))
-// __MS(min(wcp) << " " << max(wcp) << " " << mean(wcp))
-// __MS(alpha)
-
-//         if((count < 200)) {
-//             std::cout << count << "  " << normR2 << std::endl;
-//         }
+
+#pragma omp parallel for if (mt)
+        for (Index i = 0; i < nModel; i ++) pp[i] = pr[i] + pp[i] * beta;
 
 #ifndef _WIN32
         if (verbose) std::cout << "\r[ " << count << "/" << normR2 << "]\t";
@@ -219,10 +216,181 @@ __MS("##################################################################")
     if (verbose) std::cout << "[ " << count << "/" << normR2 << "]\t" << std::endl;
 #endif
 
-    // if (z.size() > 100 )exit(1);
     return 1;
 }
 
+/*! Solve the small dense system A x = b by Gaussian elimination with
+partial pivoting. A and b are overwritten. Returns false if A is singular
+to working precision. */
+static bool solveDenseSmall_(std::vector < double > & A,
+                             std::vector < double > & b, Index n){
+    double aMax = 0.0;
+    for (Index i = 0; i < n * n; i ++) aMax = max(aMax, std::fabs(A[i]));
+    const double pivTol = 1e-14 * aMax;
+
+    for (Index k = 0; k < n; k ++){
+        Index piv = k;
+        for (Index i = k + 1; i < n; i ++){
+            if (std::fabs(A[i * n + k]) > std::fabs(A[piv * n + k])) piv = i;
+        }
+        if (piv != k){
+            for (Index j = 0; j < n; j ++) std::swap(A[k * n + j], A[piv * n + j]);
+            std::swap(b[k], b[piv]);
+        }
+        double d = A[k * n + k];
+        if (std::fabs(d) <= pivTol) return false;
+        for (Index i = k + 1; i < n; i ++){
+            double f = A[i * n + k] / d;
+            if (f == 0.0) continue;
+            for (Index j = k; j < n; j ++) A[i * n + j] -= f * A[k * n + j];
+            b[i] -= f * b[k];
+        }
+    }
+    for (Index k = n; k-- > 0;){
+        double s = b[k];
+        for (Index j = k + 1; j < n; j ++) s -= A[k * n + j] * b[j];
+        b[k] = s / A[k * n + k];
+    }
+    return true;
+}
+
+int solveMultiLambdaCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
+                               const Vec & dWeight, const Vec & b,
+                               const Vec & wc, const Vec & wm,
+                               const Vec & tm, const Vec & td,
+                               const Vec & lambdas, const Vec & roughness,
+                               std::vector < Vec > & xs,
+                               std::vector < Vec > & dds,
+                               int maxIter, double tol, bool verbose){
+    Index nData = b.size();
+    Index nModel = tm.size();
+    Index nConst = C.rows();
+    Index nLambda = lambdas.size();
+
+    if (S.rows() != nData)  std::cerr << "J.rows != nData " << S.rows() << " / " << nData << std::endl;
+    if (C.cols() != nModel) std::cerr << "C.cols != nModel " << C.cols() << " / " << nModel << std::endl;
+    if (wc.size() != nConst) std::cerr << "wc.size() != nConst " << wc.size() << " / " << nConst << std::endl;
+    if (roughness.size() != nConst) std::cerr << "roughness.size != nConst " << roughness.size() << " / " << nConst << std::endl;
+
+    //** weighted operators: A = dW * td * S / tm,  L = wc * C * wm
+    //** min |A x - dW * b|^2 + lambda * |L x + roughness|^2
+    //** normal equation: (A^T A + lambda L^T L) x = A^T dW b - lambda L^T roughness
+    Vec dW2(dWeight * dWeight);
+    auto LtL = [&](const Vec & x){
+        return Vec(transMult(C, Vec(wc * wc * (C * Vec(wm * x)))) * wm);
+    };
+    Vec Ltr(transMult(C, Vec(wc * roughness)) * wm);
+    Vec Atb(transMult(S, Vec(b * dW2 * td)) / tm);
+
+    //** basis V, its unweighted data SV = td * S * (v / tm) and the projected
+    //** matrices P = (AV)^T AV, G = (LV)^T LV, c = (AV)^T dW b, h = V^T L^T r
+    std::vector < Vec > V;  // nModel
+    std::vector < Vec > SV; // nData
+    std::vector < std::vector < double > > P, G; // column j holds [0..j][j]
+    std::vector < double > c, h;
+
+    auto addBasis = [&](Vec v){
+        //** full reorthogonalization, twice is enough
+        for (Index pass = 0; pass < 2; pass ++){
+            for (Index i = 0; i < V.size(); i ++) v -= V[i] * dot(V[i], v);
+        }
+        double nv = norml2(v);
+        //** <= also stops for zero right-hand sides, e.g., zero data and
+        //** roughness, which have the zero update as solution
+        if (nv <= 1e-12 * max(norml2(Atb), norml2(Ltr))) return false;
+        v /= nv;
+        Index k = V.size();
+        V.push_back(v);
+        SV.push_back((S * Vec(v / tm)) * td);
+        Vec LtLv(LtL(v));
+        P.push_back(std::vector < double >(k + 1));
+        G.push_back(std::vector < double >(k + 1));
+        for (Index i = 0; i <= k; i ++){
+            P[k][i] = dot(Vec(SV[i] * dW2), SV[k]);
+            G[k][i] = dot(V[i], LtLv);
+        }
+        c.push_back(dot(Vec(SV[k] * dW2), b));
+        h.push_back(dot(v, Ltr));
+        return true;
+    };
+
+    //** solve the projected problem (P + lambda G) y = c - lambda h
+    std::vector < double > M, y;
+    auto solveProjected = [&](double lambda){
+        Index k = V.size();
+        M.assign(k * k, 0.0);
+        y.assign(k, 0.0);
+        for (Index j = 0; j < k; j ++){
+            for (Index i = 0; i <= j; i ++){
+                M[i * k + j] = P[j][i] + lambda * G[j][i];
+                M[j * k + i] = M[i * k + j];
+            }
+            y[j] = c[j] - lambda * h[j];
+        }
+        if (!solveDenseSmall_(M, y, k)){
+            throwError(WHERE_AM_I + " projected system is singular for lambda "
+                       + str(lambda) + " and basis size " + str(k));
+        }
+    };
+    auto combine = [&](const std::vector < Vec > & B, Index n){
+        Vec x(n, 0.0);
+        for (Index j = 0; j < y.size(); j ++) x += B[j] * y[j];
+        return x;
+    };
+
+    //** the residual of every lambda at x = 0 lies in span(A^T dW b, L^T r)
+    addBasis(Atb);
+    addBasis(Ltr);
+
+    //** stop like solveCGLSCDWWhtrans if the normal equation residual of
+    //** every lambda is small, i.e. below tol or 1e-8 of the initial one
+    std::vector < double > accuracy(nLambda, tol);
+    if (tol < 0.0){
+        for (Index l = 0; l < nLambda; l ++){
+            Vec r0(Atb - Ltr * lambdas[l]);
+            accuracy[l] = max(TOLERANCE, 1e-8 * dot(r0, r0));
+        }
+    }
+    std::vector < bool > converged(nLambda, false);
+    Index nConverged = 0;
+
+    //** generalized Krylov subspace: the lambdas take turns to check their
+    //** projected solution and extend the common basis by its residual,
+    //** each extension costs one S and one S^T multiplication
+    Index maxK = min(Index(max(maxIter, 1)), nModel);
+    Index l = 0;
+    while (V.size() > 0 && V.size() < maxK && nConverged < nLambda){
+        while (converged[l]) l = (l + 1) % nLambda;
+
+        solveProjected(lambdas[l]);
+        Vec x(combine(V, nModel));
+        Vec r(transMult(S, Vec((combine(SV, nData) - b) * dW2 * td)) / tm
+              + (LtL(x) + Ltr) * lambdas[l]);
+
+        if (dot(r, r) <= accuracy[l] || !addBasis(r)){
+            converged[l] = true;
+            nConverged ++;
+        }
+        l = (l + 1) % nLambda;
+
+#ifndef _WIN32
+        if (verbose) std::cout << "\r[ " << V.size() << "/" << nConverged << "]\t";
+#endif
+    }
+    if (verbose) std::cout << std::endl << "Krylov basis size: " << V.size() << std::endl;
+
+    xs.resize(nLambda);
+    dds.resize(nLambda);
+
+    for (Index l = 0; l < nLambda; l ++){
+        solveProjected(lambdas[l]);
+        xs[l] = combine(V, nModel);
+        //** the predicted data need no S multiplication
+        dds[l] = combine(SV, nData);
+    }
+    return V.size();
+}
+
 int solveCGLSCDWWtrans(const MatrixBase & S, const MatrixBase & C,
                        const Vec & dWeight,  const Vec & b, Vec & x,
                        const Vec & wc, const Vec & mc, const Vec & tm,
@@ -36,6 +36,31 @@ DLLEXPORT int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
                         int maxIter=200, double tol=-1.0,
                         bool verbose=false);
 
+/*! Multi-lambda variant of \ref solveCGLSCDWWhtrans.
+Solves the regularized problem for every lambda in lambdas, starting from
+a zero model update, on one common generalized Krylov subspace. The lambdas
+take turns to extend the basis by the residual of their projected normal
+equation, which costs one S and one S^T multiplication like a CGLS
+iteration. Every lambda reuses the whole basis, so all together need far
+less iterations than one CGLS solve per lambda. The basis grows until
+the residual of every lambda satisfies tol as in \ref solveCGLSCDWWhtrans,
+or maxIter is reached, and needs one vector of size nData and one of size
+nModel per iteration. The basis is bounded by min(maxIter, nModel) vectors,
+so maxIter also limits the memory of (nData + nModel) * maxIter values.
+A zero right-hand side gives zero updates and a basis size of 0.
+Returns the model updates in xs and the predicted data updates
+td * S * (x / tm) in dds, one for each lambda. Returns the basis size. */
+DLLEXPORT int solveMultiLambdaCDWWhtrans(const MatrixBase & S,
+                        const MatrixBase & C,
+                        const Vec & dWeight, const Vec & b,
+                        const Vec & wc, const Vec & wm,
+                        const Vec & tm, const Vec & td,
+                        const Vec & lambdas, const Vec & roughness,
+                        std::vector < Vec > & xs,
+                        std::vector < Vec > & dds,
+                        int maxIter=200, double tol=-1.0,
+                        bool verbose=false);
+
 DLLEXPORT int solveCGLSCDWWtrans(const MatrixBase & S, const MatrixBase & C,
                        const Vec & dWeight,  const Vec & b, Vec & x,
                        const Vec & wc, const Vec & mc, const Vec & tm,
@@ -24,9 +24,11 @@
 #include "vector.h"
 #include "vectortemplates.h"
 #include "matrix.h"
+#include "mappedfile.h"
 #include "mesh.h"
 #include "meshentities.h"
 #include "node.h"
+#include "profiler.h"
 #include "stopwatch.h"
 
 #include <map>
@@ -415,6 +417,7 @@ public:
 
     /*! Return SparseMapMatrix: this * a  */
     virtual Vector < ValueType > mult(const Vector < ValueType > & a) const {
+        GIMLI_PROFILE_COUNT("SpMV", 1);
         Vector < ValueType > ret(this->rows(), 0.0);
 
         ASSERT_EQUAL(this->cols(), a.size())
@@ -453,6 +456,7 @@ public:
 
     /*! Return SparseMapMatrix: this.T * a */
     virtual Vector < ValueType > transMult(const Vector < ValueType > & a) const {
+        GIMLI_PROFILE_COUNT("SpMV", 1);
         Vector < ValueType > ret(this->cols(), 0.0);
 
         ASSERT_EQUAL(this->rows(), a.size())
@@ -517,29 +521,18 @@ public:
     void importCol(const std::string & filename, double dropTol, Index colOffset){
     //std::cout << "rows: " << Jcluster.rows() << " cols: " << Jcluster.cols()<< std::endl;
 
-        FILE *file; file = fopen(filename.c_str(), "r+b");
-        if (!file) {
-            throwError(WHERE_AM_I + " " + filename + ": " + strerror(errno));
-        }
-        Index ret = 0;
-
-
-        uint32 rows = 0;
-        ret = fread(&rows, sizeof(uint32), 1, file);
-        if (ret == 0) throwError("fail reading file " + filename);
-        uint32 cols = 0;
-        ret = fread(&cols, sizeof(uint32), 1, file);
-        if (ret == 0) throwError("fail reading file " + filename);
-        ValueType val;
+        MappedFile mf(filename);
+        const uint32 * dim = mf.at< uint32 >(0, 2);
+        uint32 rows = dim[0];
+        uint32 cols = dim[1];
+        const ValueType * vals = mf.at< ValueType >(2 * sizeof(uint32),
+                                                    Index(rows) * cols);
         for (uint i = 0; i < rows; i ++){
             for (uint j = 0; j < cols; j ++){
-                ret = fread(&val, sizeof(ValueType), 1, file);
-                if (ret == 0) throwError("fail reading file " + filename);
+                const ValueType & val = vals[Index(i) * cols + j];
                 if (abs(val) > dropTol) this->setVal(i, j + colOffset, val);
             }
         }
-
-        fclose(file);
     }
     // no default arg here .. pygimli@win64 linker bug
     void importCol(const std::string & filename, double dropTol=1e-3){
@@ -741,16 +734,18 @@ public:
         rows_ = colPtr_.size() - 1;
     }
 
+    /*! Construct from CRS arrays. The column count is taken from the
+     * largest column index if nCols is 0. */
     SparseMatrix(const std::vector < int > & colPtr,
                  const std::vector < int > & rowIdx,
-                 const Vector < ValueType > vals, int stype=0)
+                 const Vector < ValueType > vals, int stype=0, Index nCols=0)
         : MatrixBase(){
           colPtr_ = colPtr;
           rowIdx_ = rowIdx;
           vals_   = vals;
           stype_  = stype;
           valid_  = true;
-          cols_ = max(rowIdx_) + 1;
+          cols_ = nCols > 0 ? nCols : max(rowIdx_) + 1;
           rows_ = colPtr_.size() - 1;
     }
 
@@ -823,6 +818,7 @@ public:
 
     /*! Return this * a  */
     virtual Vector < ValueType > mult(const Vector < ValueType > & a) const {
+        GIMLI_PROFILE_COUNT("SpMV", 1);
         if (a.size() < this->cols()){
             throwLengthError(WHERE_AM_I + " SparseMatrix size(): " + str(this->cols()) + " a.size(): " +
                                 str(a.size())) ;
@@ -876,7 +872,7 @@ public:
 
     /*! Return this.T * a */
     virtual Vector < ValueType > transMult(const Vector < ValueType > & a) const {
-
+        GIMLI_PROFILE_COUNT("SpMV", 1);
         if (a.size() < this->rows()){
             throwLengthError(WHERE_AM_I + " SparseMatrix size(): " + str(this->rows()) + " a.size(): " +
                                 str(a.size())) ;
@@ -0,0 +1,231 @@
+/******************************************************************************
+ *   Copyright (C) 2005-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace GIMLI{
+
+template < > DLLEXPORT ThreadPool * Singleton < ThreadPool >::pInstance_ = NULL;
+
+static std::mutex __GIMLIThreadPoolResizeMutex__;
+static thread_local bool __GIMLIThreadPoolWorker__ = false;
+
+struct ThreadPool::Job {
+    //** chunk range [begin, end) owned by one thread, others steal from end
+    struct Slot {
+        Slot() : begin(0), end(0) {}
+        std::mutex mutex;
+        Index begin;
+        Index end;
+    };
+
+    Job(Index nChunks, Index nSlots)
+        : slots(new Slot[nSlots]), nSlots(nSlots), left(nChunks),
+          helpers(0), open(true), failed(false) {
+        slots[0].end = nChunks;
+    }
+
+    std::function< void(Index, Index) > run;
+    std::unique_ptr< Slot[] > slots;
+    Index nSlots;
+    std::atomic< Index > left;
+
+    //** guarded by the pool mutex
+    Index helpers;
+    bool open;
+
+    std::atomic< bool > failed;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable done;
+
+    bool take(Index slot, Index & chunk){
+        Slot & own = slots[slot];
+        {
+            std::lock_guard< std::mutex > lock(own.mutex);
+            if (own.begin < own.end){
+                chunk = own.begin ++;
+                return true;
+            }
+        }
+        for (Index k = 1; k < nSlots; k ++){
+            Slot & victim = slots[(slot + k) % nSlots];
+            Index b = 0, e = 0;
+            {
+                std::lock_guard< std::mutex > lock(victim.mutex);
+                Index n = victim.end - victim.begin;
+                if (n == 0) continue;
+                e = victim.end;
+                b = e - (n + 1) / 2;
+                victim.end = b;
+            }
+            std::lock_guard< std::mutex > lock(own.mutex);
+            own.begin = b + 1;
+            own.end = e;
+            chunk = b;
+            return true;
+        }
+        return false;
+    }
+};
+
+ThreadPool::ThreadPool() : stop_(false) {
+}
+
+ThreadPool::~ThreadPool(){
+    resize_(0);
+}
+
+Index ThreadPool::workerCount() const {
+    std::lock_guard< std::mutex > lock(mutex_);
+    return workers_.size();
+}
+
+void ThreadPool::resize_(Index nWorkers){
+    //** workers_ is read by nested loops of workers, so change it
+    //** only under the pool mutex
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        if (nWorkers == workers_.size()) return;
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto & t: workers_) if (t.joinable()) t.join();
+
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        workers_.clear();
+        stop_ = false;
+        for (Index i = 0; i < nWorkers; i ++){
+            workers_.push_back(std::thread(&ThreadPool::work_, this, i));
+        }
+    }
+    log(Debug, "ThreadPool: " + str(nWorkers) + " worker threads.");
+}
+
+void ThreadPool::work_(Index id){
+    __GIMLIThreadPoolWorker__ = true;
+    std::unique_lock< std::mutex > lock(mutex_);
+    while (true){
+        std::shared_ptr< Job > job;
+        wake_.wait(lock, [&]{
+            if (stop_) return true;
+            for (auto & j: jobs_){
+                if (j->open && j->helpers + 1 < j->nSlots) {
+                    job = j;
+                    return true;
+                }
+            }
+            return false;
+        });
+        if (stop_) return;
+
+        Index slot = ++ job->helpers;
+        lock.unlock();
+        participate_(*job, slot);
+        lock.lock();
+        //** nothing left to take, no need for further helpers
+        job->open = false;
+    }
+}
+
+void ThreadPool::participate_(Job & job, Index slot){
+    Index chunk = 0;
+    while (job.take(slot, chunk)){
+        if (!job.failed){
+            try {
+                job.run(chunk, slot);
+            } catch (...) {
+                std::lock_guard< std::mutex > lock(job.mutex);
+                if (!job.failed) job.error = std::current_exception();
+                job.failed = true;
+            }
+        }
+        if (-- job.left == 0){
+            std::lock_guard< std::mutex > lock(job.mutex);
+            job.done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(const std::vector< Index > & bounds,
+                             const ChunkFunction & f, Index nThreads){
+    if (bounds.size() < 2) return;
+    Index nChunks = bounds.size() - 1;
+    if (nThreads == 0) nThreads = threadCount();
+
+    if (!__GIMLIThreadPoolWorker__){
+        //** follow setThreadCount, but never while loops are running
+        std::lock_guard< std::mutex > rLock(__GIMLIThreadPoolResizeMutex__);
+        bool idle = false;
+        {
+            std::lock_guard< std::mutex > lock(mutex_);
+            idle = jobs_.empty();
+        }
+        if (idle) resize_(max(Index(1), threadCount()) - 1);
+    }
+
+    Index nHelpers = min(min(nThreads, nChunks) - 1, workerCount());
+    if (nThreads < 2 || nChunks < 2 || nHelpers == 0){
+        for (Index i = 0; i < nChunks; i ++) f(bounds[i], bounds[i + 1], 0);
+        return;
+    }
+
+    std::shared_ptr< Job > job(new Job(nChunks, nHelpers + 1));
+    job->run = [&](Index chunk, Index slot){
+        f(bounds[chunk], bounds[chunk + 1], slot);
+    };
+
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        jobs_.push_back(job);
+    }
+    wake_.notify_all();
+
+    participate_(*job, 0);
+
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        job->open = false;
+        jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+    }
+    {
+        std::unique_lock< std::mutex > lock(job->mutex);
+        job->done.wait(lock, [&]{ return job->left == 0; });
+    }
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+void ThreadPool::parallelFor(Index start, Index end, Index grain,
+                             const ChunkFunction & f, Index nThreads){
+    if (end <= start) return;
+    if (nThreads == 0) nThreads = threadCount();
+    if (grain == 0) grain = max(Index(1), (end - start) / (8 * nThreads));
+
+    std::vector< Index > bounds;
+    bounds.reserve((end - start) / grain + 2);
+    for (Index i = start; i < end; i += grain) bounds.push_back(i);
+    bounds.push_back(end);
+    this->parallelFor(bounds, f, nThreads);
+}
+
+} // namespace GIMLI
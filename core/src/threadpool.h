@@ -0,0 +1,106 @@
+/******************************************************************************
+ *   Copyright (C) 2005-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_THREADPOOL__H
+#define _GIMLI_THREADPOOL__H
+
+#include "gimli.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace GIMLI{
+
+//! Process wide pool of worker threads.
+/*! The workers are started on first use and live until the end of the
+ * process. Its size follows \ref setThreadCount, the calling thread takes
+ * part in every loop so threadCount() - 1 workers are started.
+ *
+ * Loops are split into chunks which are handed out by work stealing:
+ * all chunks start at the caller, idle threads steal half of the remaining
+ * chunks of a busy one. Unevenly expensive iterations are balanced this way
+ * without the need of small static slices.
+ *
+ * Loops can be nested, a worker that starts a loop works on it as well, so
+ * an inner loop finishes even if no other worker is free.
+ *
+ * This is a singleton class, use e.g.: ThreadPool::instance().parallelFor(..)
+ */
+class DLLEXPORT ThreadPool : public Singleton< ThreadPool > {
+public:
+    friend class Singleton< ThreadPool >;
+
+    /*! Chunk function f(start, end, slot). slot is a small number, starting
+     * at 0, that is unique for all threads working on the same loop and
+     * can be used to pick thread local data. */
+    typedef std::function< void(Index, Index, Index) > ChunkFunction;
+
+    /*! Call f for chunks of [start, end) with at most grain iterations each,
+     * using up to nThreads threads (0 for \ref threadCount()). Returns when
+     * all chunks are done. The first exception thrown by f is rethrown
+     * here. */
+    void parallelFor(Index start, Index end, Index grain,
+                     const ChunkFunction & f, Index nThreads=0);
+
+    /*! Call f for the chunks [bounds[i], bounds[i + 1]). Use this if the
+     * chunk borders matter, e.g., to keep iterations that write to the
+     * same memory in one chunk. */
+    void parallelFor(const std::vector< Index > & bounds,
+                     const ChunkFunction & f, Index nThreads=0);
+
+    /*! Return the number of running worker threads. */
+    Index workerCount() const;
+
+protected:
+    struct Job;
+
+    void resize_(Index nWorkers);
+
+    void work_(Index id);
+
+    void participate_(Job & job, Index slot);
+
+    std::vector< std::thread > workers_;
+    std::vector< std::shared_ptr< Job > > jobs_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+
+private:
+    /*! Private so that it can not be called */
+    ThreadPool();
+    /*! Private so that it can not be called */
+    virtual ~ThreadPool();
+    /*! Copy constructor is private, so don't use it */
+    ThreadPool(const ThreadPool &){};
+    /*! Assignment operator is private, so don't use it */
+    void operator = (const ThreadPool &){ };
+};
+
+/*! Shortcut for ThreadPool::instance().parallelFor(start, end, grain, f). */
+inline void parallelFor(Index start, Index end, Index grain,
+                        const ThreadPool::ChunkFunction & f, Index nThreads=0){
+    ThreadPool::instance().parallelFor(start, end, grain, f, nThreads);
+}
+
+} // namespace GIMLI
+
+#endif // _GIMLI_THREADPOOL__H
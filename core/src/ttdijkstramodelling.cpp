@@ -239,7 +239,7 @@ void fillGraph_(Graph & graph, Cell & c, double slowness){
 
 Graph TravelTimeDijkstraModelling::createGraph(const RVector & slownessPerCell) const {
     Graph graph;
-    mesh_->createNeighborInfos();
+    this->createNeighborInfos_();
 
     for (Index i = 0; i < mesh_->cellCount(); i ++) {
         Cell & c = mesh_->cell(i);
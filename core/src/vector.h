@@ -196,13 +196,13 @@ public:
 // this constructor is dangerous for IndexArray in pygimli ..
 // there is an autocast from int -> IndexArray(int)
     Vector()
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
     // explicit Vector(Index n = 0) : data_(NULL), begin_(NULL), end_(NULL) {
         resize(0);
         clean();
     }
     Vector(Index n)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
     // explicit Vector(Index n = 0) : data_(NULL), begin_(NULL), end_(NULL) {
         resize(n);
         clean();
@@ -212,7 +212,7 @@ public:
      * Construct one-dimensional array of size n, and fill it with val
      */
     Vector(Index n, const ValueType & val)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(n);
         fill(val);
     }
@@ -221,7 +221,7 @@ public:
      * Construct vector from file. Shortcut for Vector::load
      */
     Vector(const std::string & filename, IOFormat format=Ascii)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         this->load(filename, format);
     }
 
@@ -229,7 +229,7 @@ public:
      * Copy constructor. Create new vector as a deep copy of v.
      */
     Vector(const Vector< ValueType > & v)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(v.size());
         copy_(v);
     }
@@ -238,7 +238,7 @@ public:
      * Copy constructor. Create new vector as a deep copy of the slice v[start, end)
      */
     Vector(const Vector< ValueType > & v, Index start, Index end)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(end - start);
         std::copy(&v[start], &v[end], data_);
     }
@@ -247,7 +247,7 @@ public:
      * Copy constructor. Create new vector from expression
      */
     template < class A > Vector(const __VectorExpr< ValueType, A > & v)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(v.size());
         assign_(v);
     }
@@ -257,14 +257,14 @@ public:
      * Copy constructor. Create new vector as a deep copy of std::vector(Valuetype)
      */
     Vector(const std::vector< ValueType > & v)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(v.size());
         for (Index i = 0; i < v.size(); i ++) data_[i] = v[i];
         //std::copy(&v[0], &v[v.size()], data_);
     }
 
     template < class ValueType2 > Vector(const Vector< ValueType2 > & v)
-        : size_(0), data_(0), capacity_(0){
+        : size_(0), data_(0), capacity_(0), ownsData_(true){
         resize(v.size());
         for (Index i = 0; i < v.size(); i ++) data_[i] = ValueType(v[i]);
         //std::copy(&v[0], &v[v.size()], data_);
@@ -718,15 +718,18 @@ DEFINE_UNARY_MOD_OPERATOR__(*, MULT)
         }
 //         __MS(n << " " << capacity_ << " " << newCapacity)
 
-        if (newCapacity != capacity_) {
+        if (newCapacity != capacity_ || !ownsData_) {
             ValueType * buffer = new ValueType[newCapacity];
 
+            //** a view gets its own memory here
             std::memcpy(buffer, data_,
-                        sizeof(ValueType) * min(capacity_, newCapacity));
+                        sizeof(ValueType) * min(ownsData_ ? capacity_ : size_,
+                                                newCapacity));
             // std::destroy_at(data_);
-            if (data_) delete [] data_;
+            if (data_ && ownsData_) delete [] data_;
             data_  = buffer;
             capacity_ = newCapacity;
+            ownsData_ = true;
             //std::copy(&tmp[0], &tmp[min(tmp.size(), n)], data_);
         }
      }
@@ -774,6 +777,22 @@ DEFINE_UNARY_MOD_OPERATOR__(*, MULT)
     /*! Empty the vector. Frees memory and resize to 0.*/
     void clear(){ free_(); }
 
+    /*! Use the n values at data as content without copying them.
+     * The vector does not own the memory, so it has to stay valid as long
+     * as the vector uses it. Writing to the vector writes to data. Copies
+     * are always deep and a resize moves the values into own memory. */
+    void attach(ValueType * data, Index n){
+        free_();
+        data_ = data;
+        size_ = n;
+        capacity_ = n;
+        ownsData_ = false;
+    }
+
+    /*! Return true if the values are used from foreign memory,
+     * see \ref attach. */
+    inline bool isView() const { return !ownsData_; }
+
     /*! Round all values of this array to a given tolerance. */
     Vector< ValueType > & round(const ValueType & tolerance){
         THROW_TO_IMPL
@@ -921,8 +940,9 @@ protected:
     void free_(){
         size_ = 0;
         capacity_ = 0;
-        if (data_)  delete [] data_;
+        if (data_ && ownsData_)  delete [] data_;
         data_  = NULL;
+        ownsData_ = true;
     }
 
     void copy_(const Vector< ValueType > & v){
@@ -950,6 +970,7 @@ protected:
     Index size_;
     ValueType * data_;
     Index capacity_;
+    bool ownsData_;
 
     static const Index minSizePerThread = 10000;
     static const int maxThreads = 8;
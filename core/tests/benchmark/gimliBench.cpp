@@ -0,0 +1,368 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2024 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+//! Microbenchmarks for the core kernels.
+/*! All meshes and data are generated in-process, so runs are reproducible
+ * and can be compared across commits, e.g.:
+ *
+ * gimliBench -o before.json; ...; gimliBench -o after.json
+ *
+ * Every benchmark is timed in batches of at least --minTime seconds and
+ * reports the fastest and the median batch per iteration. */
+
+#include <gimli.h>
+#include <cholmodWrapper.h>
+#include <datacontainer.h>
+#include <elementmatrix.h>
+#include <matrix.h>
+#include <mesh.h>
+#include <meshgenerators.h>
+#include <optionmap.h>
+#include <sparsematrix.h>
+#include <stopwatch.h>
+#include <ttdijkstramodelling.h>
+#include <vector.h>
+
+#include <bert/bert.h>
+#include <bert/bertDataContainer.h>
+#include <bert/dcfemmodelling.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace GIMLI;
+
+//! Timing state handed to every benchmark.
+class Bench {
+public:
+    Bench(const std::string & name, Index size, double minTime, Index repeat)
+        : name_(name), size_(size), minTime_(minTime), repeat_(repeat),
+          items_(0), iterations_(0) {}
+
+    /*! Problem size parameter of this run. */
+    Index size() const { return size_; }
+
+    /*! Number of processed items per iteration, e.g., nonzeros or cells. */
+    void setItems(Index items) { items_ = items; }
+
+    /*! Time f. Call once per benchmark after all setup is done. */
+    void run(const std::function< void() > & f){
+        Stopwatch swatch(true);
+        f();
+        double t = std::max(swatch.duration(), 1e-9);
+
+        Index n = std::max(Index(1), Index(minTime_ / t));
+        for (Index r = 0; r < repeat_; r ++){
+            swatch.restart();
+            for (Index i = 0; i < n; i ++) f();
+            times_.push_back(swatch.duration() / n);
+        }
+        iterations_ = n * repeat_;
+        std::sort(times_.begin(), times_.end());
+    }
+
+    double min() const { return times_.empty() ? 0.0 : times_.front(); }
+
+    double median() const { return times_.empty() ? 0.0 : times_[times_.size() / 2]; }
+
+    const std::string & name() const { return name_; }
+
+    Index items() const { return items_; }
+
+    Index iterations() const { return iterations_; }
+
+protected:
+    std::string name_;
+    Index size_;
+    double minTime_;
+    Index repeat_;
+    Index items_;
+    Index iterations_;
+    std::vector< double > times_;
+};
+
+typedef std::function< void(Bench &) > BenchFunction;
+
+struct BenchCase {
+    std::string name;
+    std::vector< Index > sizes;
+    BenchFunction f;
+};
+
+//** square 2D grid with n x n cells or cube with n^3 cells
+Mesh createBenchMesh_(Index dim, Index n){
+    if (dim == 2) return createMesh2D(n, n);
+    return createMesh3D(n, n, n);
+}
+
+//** stiffness + mass, i.e., symmetric positive definite
+void fillSPD_(const Mesh & mesh, RSparseMatrix & S){
+    S.buildSparsityPattern(mesh);
+    ElementMatrix < double > A;
+    for (Index i = 0; i < mesh.cellCount(); i ++){
+        A.ux2uy2uz2(mesh.cell(i));
+        S += A;
+        A.u2(mesh.cell(i));
+        S += A;
+    }
+}
+
+RVector randomVector_(Index n, Index seed=1234){
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution< double > dist(0.0, 1.0);
+    RVector ret(n);
+    for (Index i = 0; i < n; i ++) ret[i] = dist(gen);
+    return ret;
+}
+
+void vectorExpression(Bench & b){
+    RVector x(randomVector_(b.size(), 1)), y(randomVector_(b.size(), 2)), z;
+    b.run([&]{ z = x * y + 2.0 * x - y / 3.0; });
+    b.setItems(b.size());
+}
+
+void denseMult(Bench & b){
+    RMatrix A(b.size(), b.size());
+    for (Index i = 0; i < A.rows(); i ++) A[i] = randomVector_(A.cols(), i);
+    RVector x(randomVector_(b.size())), y;
+    b.run([&]{ y = A * x; });
+    b.setItems(b.size() * b.size());
+}
+
+void denseTransMult(Bench & b){
+    RMatrix A(b.size(), b.size());
+    for (Index i = 0; i < A.rows(); i ++) A[i] = randomVector_(A.cols(), i);
+    RVector x(randomVector_(b.size())), y;
+    b.run([&]{ y = transMult(A, x); });
+    b.setItems(b.size() * b.size());
+}
+
+template < Index dim > void sparseMult(Bench & b){
+    Mesh mesh(createBenchMesh_(dim, b.size()));
+    RSparseMatrix S;
+    fillSPD_(mesh, S);
+    RVector x(randomVector_(S.cols())), y;
+    b.run([&]{ y = S * x; });
+    b.setItems(S.nVals());
+}
+
+template < Index dim > void sparsityPattern(Bench & b){
+    Mesh mesh(createBenchMesh_(dim, b.size()));
+    RSparseMatrix S;
+    b.run([&]{ S.buildSparsityPattern(mesh); });
+    b.setItems(S.nVals());
+}
+
+template < Index dim > void stiffnessAssembly(Bench & b){
+    Mesh mesh(createBenchMesh_(dim, b.size()));
+    RSparseMatrix S;
+    b.run([&]{ S.fillStiffnessMatrix(mesh); });
+    b.setItems(mesh.cellCount());
+}
+
+template < Index dim > void cholmodFactorize(Bench & b){
+    if (!CHOLMODWrapper::valid()) throwError("CHOLMOD not available.");
+    Mesh mesh(createBenchMesh_(dim, b.size()));
+    RSparseMatrix S;
+    fillSPD_(mesh, S);
+    b.run([&]{ CHOLMODWrapper solver(S); });
+    b.setItems(S.nVals());
+}
+
+template < Index dim > void cholmodSolve(Bench & b){
+    if (!CHOLMODWrapper::valid()) throwError("CHOLMOD not available.");
+    Mesh mesh(createBenchMesh_(dim, b.size()));
+    RSparseMatrix S;
+    fillSPD_(mesh, S);
+    CHOLMODWrapper solver(S);
+    RVector rhs(randomVector_(S.rows())), x(S.rows());
+    b.run([&]{ solver.solve(rhs, x); });
+    b.setItems(S.nVals());
+}
+
+void findCell(Bench & b){
+    Mesh mesh(createMesh3D(b.size(), b.size(), b.size()));
+    std::mt19937 gen(42);
+    std::uniform_real_distribution< double > dist(0.0, double(b.size()));
+    R3Vector pos(1000);
+    for (auto & p: pos) p = RVector3(dist(gen), dist(gen), dist(gen));
+    mesh.findCell(pos[0]);
+    Index found = 0;
+    b.run([&]{
+        found = 0;
+        for (auto & p: pos) if (mesh.findCell(p, false)) found ++;
+    });
+    if (found != pos.size()) log(Warning, b.name(), "missed", pos.size() - found);
+    b.setItems(pos.size());
+}
+
+void createNeighborInfos(Bench & b){
+    Mesh mesh(createMesh3D(b.size(), b.size(), b.size()));
+    b.run([&]{ mesh.createNeighborInfos(true); });
+    b.setItems(mesh.cellCount());
+}
+
+void dijkstraSetStartNode(Bench & b){
+    Mesh mesh(createMesh3D(b.size(), b.size(), b.size()));
+    //** all node pairs of a cell are connected, like TravelTimeDijkstraModelling
+    Graph graph;
+    for (Index i = 0; i < mesh.cellCount(); i ++){
+        const Cell & c = mesh.cell(i);
+        for (Index j = 0; j < c.nodeCount(); j ++){
+            for (Index k = j + 1; k < c.nodeCount(); k ++){
+                Index na = c.node(j).id(), nb = c.node(k).id();
+                double d = c.node(j).pos().distance(c.node(k).pos());
+                graph[na][nb] = GraphDistInfo(d, d, c.id());
+                graph[nb][na] = GraphDistInfo(d, d, c.id());
+            }
+        }
+    }
+    Dijkstra dijkstra(graph);
+    b.run([&]{ dijkstra.setStartNode(0); });
+    b.setItems(mesh.nodeCount());
+}
+
+//** dipole-dipole survey with nElecs electrodes on a 2D grid
+void createERT_(Index nElecs, Mesh & mesh, DataContainerERT & data){
+    RVector x(4 * nElecs + 1), y(21);
+    for (Index i = 0; i < x.size(); i ++) x[i] = -double(nElecs) + 0.5 * i;
+    for (Index i = 0; i < y.size(); i ++) y[i] = -std::pow(1.2, double(y.size() - 1 - i)) + 1.0;
+    mesh = createMesh2D(x, y);
+    for (Index i = 0; i < nElecs; i ++){
+        RVector3 p(-0.5 * nElecs + i, 0.0);
+        data.createSensor(p);
+        mesh.node(mesh.findNearestNode(p)).setMarker(MARKER_NODE_ELECTRODE);
+    }
+    for (Index sep = 1; sep < 6; sep ++){
+        for (Index a = 0; a + sep + 2 < nElecs; a ++){
+            data.addFourPointData(a, a + 1, a + sep + 1, a + sep + 2);
+        }
+    }
+    data.set("k", RVector(data.size(), 1.0));
+}
+
+void ertCalculate(Bench & b){
+    Mesh mesh;
+    DataContainerERT data;
+    createERT_(b.size(), mesh, data);
+    DCMultiElectrodeModelling fop(mesh, data);
+    RVector model(fop.mesh()->cellCount(), 100.0);
+    b.run([&]{ fop.response(model); });
+    b.setItems(data.size());
+}
+
+void ertJacobian(Bench & b){
+    Mesh mesh;
+    DataContainerERT data;
+    createERT_(b.size(), mesh, data);
+    DCMultiElectrodeModelling fop(mesh, data);
+    RVector model(fop.mesh()->cellCount(), 100.0);
+    fop.response(model);
+    b.run([&]{ fop.createJacobian(model); });
+    b.setItems(data.size() * model.size());
+}
+
+std::vector< BenchCase > benchCases(){
+    std::vector< BenchCase > c;
+    c.push_back({"vector/expression", {10000, 1000000}, vectorExpression});
+    c.push_back({"dense/mult", {200, 1000}, denseMult});
+    c.push_back({"dense/transMult", {200, 1000}, denseTransMult});
+    c.push_back({"sparse/SpMV2d", {100, 300}, sparseMult< 2 >});
+    c.push_back({"sparse/SpMV3d", {10, 30}, sparseMult< 3 >});
+    c.push_back({"sparse/buildSparsityPattern2d", {100, 300}, sparsityPattern< 2 >});
+    c.push_back({"sparse/buildSparsityPattern3d", {10, 30}, sparsityPattern< 3 >});
+    c.push_back({"fem/stiffnessAssembly2d", {100, 300}, stiffnessAssembly< 2 >});
+    c.push_back({"fem/stiffnessAssembly3d", {10, 30}, stiffnessAssembly< 3 >});
+    c.push_back({"solver/cholmodFactorize2d", {100, 300}, cholmodFactorize< 2 >});
+    c.push_back({"solver/cholmodFactorize3d", {10, 20}, cholmodFactorize< 3 >});
+    c.push_back({"solver/cholmodSolve2d", {100, 300}, cholmodSolve< 2 >});
+    c.push_back({"solver/cholmodSolve3d", {10, 20}, cholmodSolve< 3 >});
+    c.push_back({"mesh/findCell", {10, 30}, findCell});
+    c.push_back({"mesh/createNeighborInfos", {10, 30}, createNeighborInfos});
+    c.push_back({"dijkstra/setStartNode", {10, 20}, dijkstraSetStartNode});
+    c.push_back({"ert/calculate", {21, 41}, ertCalculate});
+    c.push_back({"ert/createJacobian", {21, 41}, ertJacobian});
+    return c;
+}
+
+void writeJSON_(const std::string & fileName, const std::vector< Bench > & results){
+    std::ofstream file(fileName.c_str());
+    if (!file) throwError("cannot open file: " + fileName);
+
+    file << std::setprecision(9);
+    file << "{" << std::endl
+         << "  \"context\": {\"version\": \"" << versionStr() << "\", "
+         << "\"threads\": " << threadCount() << ", "
+         << "\"cpus\": " << numberOfCPU() << "}," << std::endl
+         << "  \"benchmarks\": [" << std::endl;
+    for (Index i = 0; i < results.size(); i ++){
+        const Bench & b = results[i];
+        file << "    {\"name\": \"" << b.name() << "\", \"size\": " << b.size()
+             << ", \"iterations\": " << b.iterations()
+             << ", \"min\": " << b.min() << ", \"median\": " << b.median()
+             << ", \"items\": " << b.items() << "}"
+             << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char *argv[]){
+    std::string filter, outFile;
+    double minTime = 0.2;
+    int repeat = 5;
+    bool list = false;
+
+    OptionMap oMap;
+    oMap.setDescription("Microbenchmarks for the core kernels of libgimli. "
+                        "Times are seconds per iteration.");
+    oMap.add(filter,  "f:", "filter", "Run only benchmarks whose name contains this string.");
+    oMap.add(outFile, "o:", "output", "Write the results as JSON to this file.");
+    oMap.add(minTime, "t:", "minTime", "Minimum time per batch in seconds.");
+    oMap.add(repeat,  "r:", "repeat", "Number of timed batches.");
+    oMap.add(list,    "l",  "list", "List the benchmarks and exit.");
+    oMap.parse(argc, argv);
+
+    std::vector< Bench > results;
+    for (auto & c: benchCases()){
+        if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+        for (auto n: c.sizes){
+            std::string name(c.name + "/" + str(n));
+            if (list) {
+                std::cout << name << std::endl;
+                continue;
+            }
+            Bench b(c.name, n, minTime, repeat);
+            try {
+                c.f(b);
+            } catch (std::exception & e){
+                std::cerr << name << ": " << e.what() << std::endl;
+                continue;
+            }
+            std::cout << std::left << std::setw(40) << name << std::right
+                      << std::setw(14) << b.min() << std::setw(14) << b.median()
+                      << std::setw(10) << b.iterations() << std::endl;
+            results.push_back(b);
+        }
+    }
+    if (!outFile.empty()) writeJSON_(outFile, results);
+    return EXIT_SUCCESS;
+}
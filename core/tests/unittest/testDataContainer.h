@@ -6,6 +6,8 @@
 #include <gimli.h>
 #include <datacontainer.h>
 #include <pos.h>
+#include <bert/bertDataContainer.h>
+#include <bert/datamap.h>
 
 #include <stdexcept>
 
@@ -17,6 +19,7 @@ class DataContainerTest : public CppUnit::TestFixture  {
     
     CPPUNIT_TEST(testIO);
     CPPUNIT_TEST(testEdit);
+    CPPUNIT_TEST(testDataMap);
     
     CPPUNIT_TEST_SUITE_END();
     
@@ -93,9 +96,109 @@ public:
     }   
     
     void testIO(){
-        
+        DataContainer data;
+        uint nSensors = 10;
+        for (uint i = 0; i < nSensors; i++){
+            data.createSensor(RVector3(double(i), 0.0, 0.0));
+        }
+        data.registerSensorIndex("a");
+        data.registerSensorIndex("b");
+        data.resize(nSensors - 1);
+
+        RVector tmp(data.size()); tmp.fill(x__);
+        data.set("a", tmp);
+        data.set("b", tmp + 1.0);
+        data.set("rhoa", tmp * 0.1 + 1.0/3.0);
+        data.set("valid", RVector(data.size(), 1.0));
+
+        data.save("test.io.dat");
+        DataContainer text;
+        text.registerSensorIndex("a");
+        text.registerSensorIndex("b");
+        text.load("test.io.dat");
+        CPPUNIT_ASSERT(text.size() == data.size());
+        CPPUNIT_ASSERT(text.sensorCount() == data.sensorCount());
+        CPPUNIT_ASSERT(text("b") == data("b"));
+
+        data.saveBinary("test.io.bdat");
+        DataContainer bin("test.io.bdat");
+        CPPUNIT_ASSERT(bin.size() == data.size());
+        CPPUNIT_ASSERT(bin.sensorCount() == data.sensorCount());
+        CPPUNIT_ASSERT(bin.isSensorIndex("a"));
+        CPPUNIT_ASSERT(bin("rhoa") == data("rhoa"));
+        CPPUNIT_ASSERT(bin.hash() == data.hash());
+
+        //** the binary format keeps the sensor format and index base
+        text.setSensorIndexOnFileFromOne(false);
+        text.saveBinary("test.io.bdat");
+        bin.load("test.io.bdat");
+        CPPUNIT_ASSERT(!bin.sensorIndexOnFileFromOne());
+        CPPUNIT_ASSERT(bin.formatStringSensors() == text.formatStringSensors());
+        CPPUNIT_ASSERT(bin.formatStringSensors() == "x y z ");
+
+        //** values longer than 64 characters are not truncated
+        std::fstream file; openOutFile("test.io.dat", &file);
+        file << "2" << std::endl << "# x" << std::endl << "0" << std::endl << "1" << std::endl
+             << "1" << std::endl << "# a rhoa" << std::endl
+             << "1 1." << std::string(70, '0') << "e2" << std::endl
+             << "0" << std::endl;
+        file.close();
+        text.load("test.io.dat");
+        CPPUNIT_ASSERT(std::fabs(text("rhoa")[0] - 100.0) < 1e-12);
     }
     
+    void testDataMap(){
+        //** collect matrix u_ij = potential at j for current at i
+        Index nElecs = 5;
+        std::fstream file; openOutFile("test.io.collect", &file);
+        file.precision(17);
+        file << nElecs << std::endl;
+        for (Index i = 0; i < nElecs; i ++) file << double(i) << "\t0\t0" << std::endl;
+        for (Index i = 0; i < nElecs; i ++){
+            for (Index j = 0; j < nElecs; j ++) file << 1.0 / (1.0 + i + 2.0 * j) << "\t";
+            file << std::endl;
+        }
+        file.close();
+
+        DataMap map("test.io.collect");
+        CPPUNIT_ASSERT(map.rows() == nElecs);
+        CPPUNIT_ASSERT(map.cols() == nElecs);
+        CPPUNIT_ASSERT(!map.isComplex());
+        CPPUNIT_ASSERT(std::fabs(map.pot(2, 3) - 1.0 / 9.0) < 1e-14);
+
+        DataContainerERT data;
+        for (Index i = 0; i < nElecs; i ++) data.createSensor(RVector3(double(i), 0.0, 0.0));
+        data.createFourPointData(0, 0, 1, 2, 3);
+        data.createFourPointData(1, 1, 2, 3, 4);
+        data.createFourPointData(2, 0, -1, 4, -1);
+
+        RVector u(map.data(data));
+        RVector uRez(map.data(data, true));
+        auto uXX = [&](int a, int b, int m, int n){
+            double r = 0.0;
+            if (a > -1 && m > -1) r += map.pot(a, m);
+            if (a > -1 && n > -1) r -= map.pot(a, n);
+            if (b > -1 && m > -1) r -= map.pot(b, m);
+            if (b > -1 && n > -1) r += map.pot(b, n);
+            return r;
+        };
+        CPPUNIT_ASSERT(std::fabs(u[1] - uXX(1, 2, 3, 4)) < 1e-14);
+        CPPUNIT_ASSERT(std::fabs(u[2] - uXX(0, -1, 4, -1)) < 1e-14);
+        CPPUNIT_ASSERT(std::fabs(uRez[0] - uXX(2, 3, 0, 1)) < 1e-14);
+
+        RVector u1, uRez1;
+        map.data(data, u1, uRez1);
+        CPPUNIT_ASSERT(u1 == u);
+        CPPUNIT_ASSERT(uRez1 == uRez);
+
+        map.saveBinary("test.io.bcollect");
+        DataMap bin("test.io.bcollect");
+        CPPUNIT_ASSERT(bin.rows() == nElecs);
+        CPPUNIT_ASSERT(bin.electrodes()[3] == map.electrodes()[3]);
+        CPPUNIT_ASSERT(bin.potentials() == map.potentials());
+        CPPUNIT_ASSERT(bin.data(data) == u);
+    }
+
     void testEdit(){
         
     }
@@ -7,6 +7,10 @@
 #include <meshentities.h>
 #include <elementmatrix.h>
 #include <integration.h>
+#include <meshgenerators.h>
+
+#include <bert/bertDataContainer.h>
+#include <bert/bertJacobian.h>
 
 class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST_SUITE(FEMTest);
@@ -18,6 +22,8 @@ class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testFEM2D);
     CPPUNIT_TEST(testFEM3D);
 
+    CPPUNIT_TEST(testSensitivityKernel);
+
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -79,6 +85,88 @@ public:
         testStiffness3D();
     }
 
+    void testSensitivityKernel(){
+        //** 40 model cells with 2 mesh cells each, more than one panel
+        GIMLI::Mesh mesh(GIMLI::createMesh2D(GIMLI::Index(10), GIMLI::Index(8)));
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            mesh.cell(i).setMarker(i / 2);
+        }
+
+        GIMLI::DataContainerERT data;
+        GIMLI::Index nElecs = 6;
+        for (GIMLI::Index i = 0; i < nElecs; i ++){
+            data.createSensor(GIMLI::RVector3(double(i), 0.0));
+        }
+        data.addFourPointData(0, 1, 2, 3);
+        data.addFourPointData(0, -1, 4, -1);
+        data.addFourPointData(1, 5, 2, 4);
+        data.addFourPointData(5, 2, 3, 1);
+        data.addFourPointData(3, -1, 0, 1);
+
+        GIMLI::RVector k(3), w(3);
+        k[0] = 0.1; k[1] = 0.5; k[2] = 2.0;
+        w[0] = 0.2; w[1] = 0.3; w[2] = 0.5;
+        GIMLI::RMatrix pots(nElecs * k.size(), mesh.nodeCount());
+        for (GIMLI::Index i = 0; i < pots.rows(); i ++){
+            for (GIMLI::Index j = 0; j < pots.cols(); j ++){
+                pots[i][j] = std::sin(0.37 * i + 1.3 * j) + 0.1 * i;
+            }
+        }
+
+        //** previous kernel: one element matrix product per datum and cell
+        GIMLI::RMatrix Sref(data.size(), 40);
+        GIMLI::RVector dummy(mesh.nodeCount(), 0.0);
+        GIMLI::ElementMatrix< double > S_i, S1_i;
+        for (GIMLI::Index c = 0; c < mesh.cellCount(); c ++){
+            S1_i.ux2uy2uz2(mesh.cell(c));
+            for (GIMLI::Index kIdx = 0; kIdx < k.size(); kIdx ++){
+                S_i.u2(mesh.cell(c));
+                S_i *= k[kIdx] * k[kIdx];
+                S_i += S1_i;
+                for (GIMLI::Index d = 0; d < data.size(); d ++){
+                    const GIMLI::RVector * p[4];
+                    const char * t[4] = {"a", "b", "m", "n"};
+                    for (GIMLI::Index e = 0; e < 4; e ++){
+                        int idx = int(data(t[e])[d]);
+                        p[e] = idx > -1 ? &pots[idx + nElecs * kIdx] : &dummy;
+                    }
+                    Sref[d][mesh.cell(c).marker()] +=
+                        S_i.mult(*p[0], *p[1], *p[2], *p[3]) * w[kIdx];
+                }
+            }
+        }
+
+        std::vector < std::pair < GIMLI::Index, GIMLI::Index > > ids;
+        for (GIMLI::Index nThreads = 1; nThreads < 5; nThreads += 3){
+            GIMLI::RMatrix S;
+            GIMLI::createSensitivityCol(S, mesh, data, pots, w, k, ids,
+                                        nThreads, false);
+            CPPUNIT_ASSERT(S.rows() == Sref.rows() && S.cols() == Sref.cols());
+            for (GIMLI::Index d = 0; d < S.rows(); d ++){
+                CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(S[d] - Sref[d])) <
+                               1e-12 * GIMLI::max(GIMLI::abs(Sref[d])));
+            }
+        }
+
+        //** more data than electrode pairs switch to the electrode pair
+        //** products, the rows need to be the same as for the direct path
+        GIMLI::DataContainerERT dataPairs(data);
+        for (GIMLI::Index i = 0; i < 5; i ++){
+            for (GIMLI::Index d = 0; d < data.size(); d ++){
+                dataPairs.addFourPointData(data("a")[d], data("b")[d],
+                                           data("m")[d], data("n")[d]);
+            }
+        }
+        CPPUNIT_ASSERT(dataPairs.size() > (nElecs + 1) * (nElecs + 1) / 2);
+        GIMLI::RMatrix SPairs;
+        GIMLI::createSensitivityCol(SPairs, mesh, dataPairs, pots, w, k, ids,
+                                    1, false);
+        for (GIMLI::Index d = 0; d < SPairs.rows(); d ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(SPairs[d] - Sref[d % data.size()])) <
+                           1e-12 * GIMLI::max(GIMLI::abs(Sref[d % data.size()])));
+        }
+    }
+
     void testStiffness1D(){
 
         std::vector < GIMLI::Node * > n(2);
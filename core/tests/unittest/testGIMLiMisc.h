@@ -7,8 +7,15 @@
 #include <memwatch.h>
 
 #include <matrix.h>
+#include <calculateMultiThread.h>
+#include <dc1dmodelling.h>
+#include <em1dmodelling.h>
+#include <gravimetry.h>
+#include <inversion.h>
+#include <meshgenerators.h>
 
 #include <polynomial.h>
+#include <profiler.h>
 #include <pos.h>
 
 class GIMLIMiscTest : public CppUnit::TestFixture  {
@@ -20,6 +27,14 @@ class GIMLIMiscTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testMemWatch);
     CPPUNIT_TEST(testHash);
     CPPUNIT_TEST(testPolynomialFunction);
+    CPPUNIT_TEST(testThreadPool);
+    CPPUNIT_TEST(testProfiler);
+    CPPUNIT_TEST(testBruteForceJacobian);
+    CPPUNIT_TEST(testLineSearchResponses);
+    CPPUNIT_TEST(testDC1dJacobian);
+    CPPUNIT_TEST(testEM1dJacobian);
+    CPPUNIT_TEST(testGravimetry);
+    CPPUNIT_TEST(testForwardMeshSharing);
 //     CPPUNIT_TEST(testRotationByQuaternion);
 
 	//CPPUNIT_TEST_EXCEPTION(funct, exception);
@@ -176,6 +191,415 @@ public:
 
     }
 
+
+    class SquareSumMT : public GIMLI::BaseCalcMT{
+    public:
+        SquareSumMT(GIMLI::RVector & out) : BaseCalcMT(false), out_(&out){}
+        virtual void calc(){
+            for (GIMLI::Index i = start_; i < end_; i ++){
+                //** uneven work per iteration
+                double s = 0.0;
+                for (GIMLI::Index j = 0; j < (i % 97) * 50; j ++) s += std::sqrt(double(i + j));
+                (*out_)[i] = s;
+            }
+        }
+    protected:
+        GIMLI::RVector * out_;
+    };
+
+    //! Forward operator without clone but with a read only response.
+    class QuadraticModelling : public GIMLI::ModellingBase {
+    public:
+        QuadraticModelling() : GIMLI::ModellingBase(false) {}
+
+        virtual GIMLI::RVector response(const GIMLI::RVector & m){
+            return response_mt(m, 0);
+        }
+
+        virtual GIMLI::RVector response_mt(const GIMLI::RVector & m,
+                                           GIMLI::Index) const {
+            GIMLI::RVector r(m.size() + 1);
+            for (GIMLI::Index i = 0; i < m.size(); i ++){
+                r[i] = m[i] * m[i] + (i > 0 ? m[i - 1] * m[i] : 0.0);
+            }
+            r[m.size()] = GIMLI::sum(m);
+            return r;
+        }
+    };
+
+    void testThreadPool(){
+        GIMLI::Index oldTC = GIMLI::threadCount();
+        GIMLI::setThreadCount(4);
+        GIMLI::Index n = 5000;
+
+        GIMLI::RVector serial(n), mt(n);
+        GIMLI::distributeCalc(SquareSumMT(serial), n, 1);
+        GIMLI::distributeCalc(SquareSumMT(mt), n, 4);
+        CPPUNIT_ASSERT(serial == mt);
+
+        //** nested loops
+        GIMLI::RMatrix A(40, 100);
+        GIMLI::parallelFor(0, A.rows(), 1, [&](GIMLI::Index s, GIMLI::Index e, GIMLI::Index){
+            for (GIMLI::Index i = s; i < e; i ++){
+                GIMLI::parallelFor(0, A.cols(), 7, [&](GIMLI::Index s2, GIMLI::Index e2, GIMLI::Index){
+                    for (GIMLI::Index j = s2; j < e2; j ++) A[i][j] = i * 1000 + j;
+                });
+            }
+        });
+        CPPUNIT_ASSERT(A[39][99] == 39099 && GIMLI::sum(A[17]) == 17000 * 100 + 4950);
+
+        bool thrown = false;
+        try {
+            GIMLI::parallelFor(0, 100, 1, [](GIMLI::Index s, GIMLI::Index, GIMLI::Index){
+                if (s == 42) GIMLI::throwError("chunk 42");
+            });
+        } catch (std::exception & e){
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+        GIMLI::setThreadCount(oldTC);
+    }
+
+    void testProfiler(){
+        GIMLI::Profiler & p = GIMLI::Profiler::instance();
+        bool wasEnabled = GIMLI::Profiler::enabled();
+        p.setEnabled(false);
+        p.clear();
+        { GIMLI::ProfileZone z("ignored"); }
+        CPPUNIT_ASSERT(p.events().size() == 0);
+
+        p.setEnabled(true);
+        GIMLI::setThreadCount(4);
+        {
+            GIMLI::ProfileZone outer("outer");
+            GIMLI::parallelFor(0, 8, 1, [&](GIMLI::Index, GIMLI::Index, GIMLI::Index){
+                GIMLI::ProfileZone inner("inner");
+                p.counter("work").add(2);
+            });
+        }
+        p.setEnabled(wasEnabled);
+
+        std::vector< GIMLI::ProfileEvent > events(p.events());
+        CPPUNIT_ASSERT(events.size() == 9);
+        CPPUNIT_ASSERT(std::string(events[0].name) == "outer" && events[0].depth == 0);
+        double inner = 0.0;
+        for (auto & e: events){
+            if (e.thread == events[0].thread && std::string(e.name) == "inner"){
+                CPPUNIT_ASSERT(e.depth == 1);
+                inner += e.duration;
+            }
+        }
+        CPPUNIT_ASSERT(std::fabs(events[0].self - (events[0].duration - inner)) < 1e-6);
+        CPPUNIT_ASSERT(p.counters()["work"] == 16);
+        CPPUNIT_ASSERT(p.summary().find("inner") != std::string::npos);
+
+        p.exportChromeTrace("profile.json");
+        std::ifstream file("profile.json");
+        std::string trace((std::istreambuf_iterator< char >(file)),
+                          std::istreambuf_iterator< char >());
+        CPPUNIT_ASSERT(trace.find("\"traceEvents\"") != std::string::npos);
+        CPPUNIT_ASSERT(trace.find("\"name\": \"outer\"") != std::string::npos);
+        p.clear();
+        CPPUNIT_ASSERT(p.events().size() == 0 && p.counters()["work"] == 0);
+    }
+
+    void testBruteForceJacobian(){
+        GIMLI::RVector ab2(15);
+        for (GIMLI::Index i = 0; i < ab2.size(); i ++) ab2[i] = std::pow(10.0, i / 7.0);
+        GIMLI::RVector mn2(ab2.size(), 0.5);
+        GIMLI::RVector thk(20, 2.0);
+        GIMLI::RVector rho(thk.size() + 1);
+        for (GIMLI::Index i = 0; i < rho.size(); i ++) rho[i] = 50.0 + 10.0 * (i % 5);
+
+        GIMLI::DC1dRhoModelling fop(thk, ab2, mn2);
+        GIMLI::RVector resp(fop.response(rho));
+        fop.ModellingBase::createJacobian(rho);
+        GIMLI::RMatrix J(fop.jacobianRef());
+        CPPUNIT_ASSERT(J.rows() == ab2.size() && J.cols() == rho.size());
+
+        //** clones on 4 threads give the same result
+        GIMLI::Index oldTC = GIMLI::threadCount();
+        GIMLI::setThreadCount(4);
+        fop.setMultiThreadJacobian(4);
+        fop.ModellingBase::createJacobian(rho);
+        CPPUNIT_ASSERT(fop.jacobianRef() == J);
+
+        //** without clone the columns run through response_mt on the pool
+        QuadraticModelling qfop;
+        qfop.setCentralDifferenceJacobian(true);
+        GIMLI::RVector m(30);
+        for (GIMLI::Index i = 0; i < m.size(); i ++) m[i] = 1.0 + 0.1 * i;
+        qfop.createJacobian(m);
+        GIMLI::RMatrix Jq(qfop.jacobianRef());
+        qfop.setMultiThreadJacobian(4);
+        qfop.createJacobian(m);
+        CPPUNIT_ASSERT(qfop.jacobianRef() == Jq);
+        //** central differences are exact for the quadratic terms
+        CPPUNIT_ASSERT(std::fabs(Jq[3][3] - 2.0 * m[3] - m[2]) < 1e-10);
+        CPPUNIT_ASSERT(std::fabs(Jq[3][2] - m[3]) < 1e-10);
+
+        //** rhoa is homogeneous of degree 1 in rho: J * rho == rhoa
+        fop.setCentralDifferenceJacobian(true);
+        fop.setJacobianStep(1e-4);
+        fop.ModellingBase::createJacobian(rho);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fop.jacobianRef() * rho - resp) / resp) < 1e-6);
+        GIMLI::setThreadCount(oldTC);
+    }
+
+    template < class Fop > void compareJacobian_(Fop & fop, const GIMLI::RVector & model){
+        fop.createJacobian(model);
+        GIMLI::RMatrix J(fop.jacobianRef());
+
+        fop.setCentralDifferenceJacobian(true);
+        fop.setJacobianStep(1e-4);
+        fop.ModellingBase::createJacobian(model);
+        const GIMLI::RMatrix & JFD = fop.jacobianRef();
+
+        CPPUNIT_ASSERT(J.rows() == JFD.rows() && J.cols() == model.size());
+        for (GIMLI::Index i = 0; i < J.rows(); i ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(J[i] - JFD[i])) < 1e-5 * GIMLI::max(GIMLI::abs(JFD[i])));
+        }
+    }
+
+    void testLineSearchResponses(){
+        GIMLI::RVector ab2(15);
+        for (GIMLI::Index i = 0; i < ab2.size(); i ++) ab2[i] = std::pow(10.0, i / 7.0);
+        GIMLI::RVector mn2(ab2.size(), 0.5);
+        GIMLI::RVector thk(10, 2.0);
+        GIMLI::RVector rho(thk.size() + 1);
+        for (GIMLI::Index i = 0; i < rho.size(); i ++) rho[i] = 50.0 + 10.0 * (i % 5);
+
+        //** forward operator without clone
+        class NoCloneModelling : public GIMLI::DC1dRhoModelling {
+        public:
+            NoCloneModelling(GIMLI::RVector & thk, GIMLI::RVector & ab2,
+                             GIMLI::RVector & mn2)
+                : GIMLI::DC1dRhoModelling(thk, ab2, mn2) {}
+            virtual GIMLI::ModellingBase * clone() const { return NULL; }
+        };
+
+        GIMLI::Index oldTC = GIMLI::threadCount();
+        GIMLI::setThreadCount(4);
+
+        GIMLI::DC1dRhoModelling fop(thk, ab2, mn2);
+        NoCloneModelling fopSerial(thk, ab2, mn2);
+        GIMLI::RVector data(fop.response(rho));
+
+        std::vector< GIMLI::RVector > models;
+        for (GIMLI::ModellingBase * f: std::vector< GIMLI::ModellingBase * >{&fop, &fopSerial}){
+            f->setThreadCount(4);
+            GIMLI::RTransLog transLog;
+            GIMLI::RInversion inv(data, *f, transLog, transLog, false);
+            inv.setRelativeError(0.03);
+            inv.setLambda(10.0);
+            inv.setMaxIter(2);
+            inv.setLineSearchResponses(4);
+            inv.setModel(GIMLI::RVector(rho.size(), 60.0));
+            models.push_back(inv.run());
+        }
+        //** clones on 4 threads and the serial fallback take the same steps
+        CPPUNIT_ASSERT(models[0] == models[1]);
+        CPPUNIT_ASSERT(models[0] != GIMLI::RVector(rho.size(), 60.0));
+
+        //** forward operator with internal state of the last response, like
+        //** the potentials that DCMultiElectrodeModelling reuses
+        class StatefulModelling : public GIMLI::DC1dRhoModelling {
+        public:
+            StatefulModelling(GIMLI::RVector & thk, GIMLI::RVector & ab2,
+                              GIMLI::RVector & mn2, bool canClone)
+                : GIMLI::DC1dRhoModelling(thk, ab2, mn2),
+                  canClone_(canClone), staleJacobians(0) {}
+            virtual GIMLI::ModellingBase * clone() const {
+                return canClone_ ? new StatefulModelling(*this) : NULL;
+            }
+            virtual GIMLI::RVector response(const GIMLI::RVector & rho){
+                lastModel_ = rho;
+                return GIMLI::DC1dRhoModelling::response(rho);
+            }
+            virtual void createJacobian(const GIMLI::RVector & rho){
+                if (!(lastModel_ == rho)) staleJacobians ++;
+                GIMLI::DC1dRhoModelling::createJacobian(rho);
+            }
+            bool canClone_;
+            GIMLI::Index staleJacobians;
+            GIMLI::RVector lastModel_;
+        };
+
+        for (bool canClone: {true, false}){
+            StatefulModelling fopState(thk, ab2, mn2, canClone);
+            fopState.setThreadCount(4);
+            GIMLI::RTransLog transLog;
+            GIMLI::RInversion inv(data, fopState, transLog, transLog, false);
+            inv.setRelativeError(0.03);
+            inv.setLambda(10.0);
+            inv.setMaxIter(4);
+            inv.setLineSearchResponses(4);
+            inv.setModel(GIMLI::RVector(rho.size(), 60.0));
+            inv.run();
+            CPPUNIT_ASSERT(fopState.staleJacobians == 0);
+            CPPUNIT_ASSERT(fopState.lastModel_ == inv.model());
+        }
+        GIMLI::setThreadCount(oldTC);
+    }
+
+    void testDC1dJacobian(){
+        GIMLI::RVector ab2(20);
+        for (GIMLI::Index i = 0; i < ab2.size(); i ++) ab2[i] = std::pow(10.0, i / 8.0);
+        GIMLI::RVector mn2(ab2 / 3.0);
+        GIMLI::Index nLay = 5;
+        GIMLI::RVector model(2 * nLay - 1);
+        for (GIMLI::Index i = 0; i < nLay - 1; i ++) model[i] = 1.0 + 2.0 * i;
+        for (GIMLI::Index i = 0; i < nLay; i ++) model[nLay - 1 + i] = 10.0 + 90.0 * (i % 2) + 5.0 * i;
+
+        GIMLI::DC1dModelling fop(nLay, ab2, mn2);
+        compareJacobian_(fop, model);
+    }
+
+    void testEM1dJacobian(){
+        GIMLI::Index nLay = 4;
+        GIMLI::RVector model(2 * nLay - 1);
+        for (GIMLI::Index i = 0; i < nLay - 1; i ++) model[i] = 3.0 + 4.0 * i;
+        for (GIMLI::Index i = 0; i < nLay; i ++) model[nLay - 1 + i] = 10.0 + 190.0 * (i % 2) + 7.0 * i;
+
+        GIMLI::RVector periods(10);
+        for (GIMLI::Index i = 0; i < periods.size(); i ++) periods[i] = std::pow(10.0, -3.0 + i * 0.5);
+        GIMLI::MT1dModelling mt(periods, nLay);
+        compareJacobian_(mt, model);
+
+        GIMLI::RVector freqs(6);
+        for (GIMLI::Index i = 0; i < freqs.size(); i ++) freqs[i] = 110.0 * std::pow(2.0, double(i));
+        GIMLI::FDEM1dModelling fdem(nLay, freqs, 10.0, 1.0);
+        compareJacobian_(fdem, model);
+    }
+
+    void testGravimetry(){
+        GIMLI::Index oldTC = GIMLI::threadCount();
+        GIMLI::setThreadCount(4);
+        //** rectangular prism [-50, 50]^2 x [-60, -10] after Nagy (1966)
+        double xb[2] = {-50., 50.}, zb[2] = {-60., -10.};
+        GIMLI::RVector x(5), z(3);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = -50. + 25. * i;
+        for (GIMLI::Index i = 0; i < z.size(); i ++) z[i] = -60. + 25. * i;
+        GIMLI::Mesh mesh(GIMLI::createMesh3D(x, x, z));
+
+        GIMLI::R3Vector stations;
+        for (GIMLI::Index i = 0; i < 5; i ++) stations.push_back(GIMLI::RVector3(-100. + 40. * i, 13., 5.));
+
+        GIMLI::GravimetryModelling fop(mesh, stations);
+        GIMLI::RVector density(1, 1000.);
+        GIMLI::RVector gz(fop.response(density));
+
+        for (GIMLI::Index s = 0; s < stations.size(); s ++){
+            const GIMLI::RVector3 & p = stations[s];
+            double g = 0.0;
+            for (int i = 0; i < 2; i ++) for (int j = 0; j < 2; j ++) for (int k = 0; k < 2; k ++){
+                double dx = xb[i] - p[0], dy = xb[j] - p[1], dz = p[2] - zb[k];
+                double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                g += ((i + j + k) % 2 ? 1. : -1.) *
+                    (dx * std::log(dy + r) + dy * std::log(dx + r) - dz * std::atan(dx * dy / (dz * r)));
+            }
+            g *= 6.67384e-11 * 1e5 * density[0];
+            CPPUNIT_ASSERT(gz[s] > 0.0);
+            CPPUNIT_ASSERT(std::fabs(gz[s] - g) < 1e-10 * std::fabs(g) + 1e-14);
+        }
+
+        fop.setMatrixFree(true);
+        CPPUNIT_ASSERT(std::fabs(GIMLI::max(GIMLI::abs(fop.response(density) - gz))) < 1e-12);
+        fop.createJacobian(density);
+        GIMLI::RMatrix * J = dynamic_cast< GIMLI::RMatrix * >(fop.jacobian());
+        CPPUNIT_ASSERT(J->cols() == 1);
+        CPPUNIT_ASSERT(std::fabs(GIMLI::max(GIMLI::abs(*J * density - gz))) < 1e-12);
+
+        //** 2D block agrees with the boundary line integrals
+        GIMLI::Mesh mesh2(GIMLI::createMesh2D(x, z));
+        GIMLI::RVector rho2(mesh2.cellCount());
+        for (GIMLI::Index i = 0; i < rho2.size(); i ++) rho2[i] = 100. * (i % 3);
+        GIMLI::GravimetryModelling fop2(mesh2, stations);
+        GIMLI::RVector gz2(fop2.response(rho2));
+        GIMLI::RVector gb(GIMLI::calcGBounds(stations, mesh2, rho2));
+        CPPUNIT_ASSERT(std::fabs(GIMLI::max(GIMLI::abs(gz2 - gb))) < 1e-10 * GIMLI::max(GIMLI::abs(gb)));
+        GIMLI::setThreadCount(oldTC);
+    }
+
+    void testForwardMeshSharing(){
+        GIMLI::RVector x(4);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = double(i);
+        GIMLI::Mesh mesh(GIMLI::createMesh2D(x, x));
+        GIMLI::R3Vector stations(1, GIMLI::RVector3(1.5, 5.0));
+
+        GIMLI::GravimetryModelling fop(mesh, stations);
+        std::unique_ptr< GIMLI::ModellingBase > clone(fop.clone());
+        const GIMLI::ModellingBase & cFop = fop;
+        const GIMLI::ModellingBase & cClone = *clone;
+        //** read access keeps the mesh shared
+        CPPUNIT_ASSERT(cFop.mesh() == cClone.mesh());
+        CPPUNIT_ASSERT(cFop.mesh()->neighborsKnown());
+
+        //** changes of the original are not seen by the clone
+        fop.mapModel(GIMLI::RVector(mesh.cellCount(), 2.0));
+        CPPUNIT_ASSERT(cFop.mesh() != cClone.mesh());
+        CPPUNIT_ASSERT(GIMLI::min(cFop.mesh()->cellAttributes()) == 2.0);
+        CPPUNIT_ASSERT(GIMLI::max(cClone.mesh()->cellAttributes()) == 0.0);
+
+        std::unique_ptr< GIMLI::ModellingBase > clone2(fop.clone());
+        const GIMLI::ModellingBase & cClone2 = *clone2;
+        CPPUNIT_ASSERT(cFop.mesh() == cClone2.mesh());
+        fop.mesh()->cell(0).setMarker(7);
+        CPPUNIT_ASSERT(cFop.mesh()->cell(0).marker() == 7);
+        CPPUNIT_ASSERT(cClone2.mesh()->cell(0).marker() == 0);
+
+        //** and the other way round
+        clone2->mesh()->cell(1).setAttribute(3.0);
+        CPPUNIT_ASSERT(cFop.mesh()->cell(1).attribute() == 2.0);
+        CPPUNIT_ASSERT(cClone2.mesh()->cell(1).attribute() == 3.0);
+        CPPUNIT_ASSERT(cClone.mesh()->cell(1).attribute() == 0.0);
+
+        //** forward operator that writes the model into the mesh like
+        //** DCMultiElectrodeModelling does
+        class AttributeModelling : public GIMLI::ModellingBase {
+        public:
+            AttributeModelling(GIMLI::Mesh & mesh)
+                : GIMLI::ModellingBase(mesh, false) {}
+            virtual GIMLI::ModellingBase * clone() const {
+                return new AttributeModelling(*this);
+            }
+            virtual GIMLI::RVector response(const GIMLI::RVector & model){
+                this->mapModel(model);
+                return mesh_->cellAttributes();
+            }
+        };
+
+        AttributeModelling aFop(mesh);
+        aFop.initRegionManager();
+        const GIMLI::ModellingBase & cAFop = aFop;
+        GIMLI::Index nPara = aFop.regionManager().parameterCount();
+        CPPUNIT_ASSERT(cAFop.mesh() == &aFop.regionManager().mesh());
+
+        //** a mesh shared only with the region manager is not copied
+        GIMLI::RVector resp(aFop.response(GIMLI::RVector(nPara, 5.0)));
+        CPPUNIT_ASSERT(cAFop.mesh() == &aFop.regionManager().mesh());
+        CPPUNIT_ASSERT(GIMLI::min(resp) == 5.0 && GIMLI::max(resp) == 5.0);
+
+        //** clones responding concurrently copy it, the original keeps it
+        GIMLI::Index nClones = 8;
+        std::vector< std::unique_ptr< GIMLI::ModellingBase > > clones;
+        for (GIMLI::Index i = 0; i < nClones; i ++) clones.emplace_back(aFop.clone());
+        std::vector< GIMLI::RVector > resps(nClones);
+        GIMLI::ThreadPool::instance().parallelFor(0, nClones, 1,
+            [&](GIMLI::Index start, GIMLI::Index end, GIMLI::Index){
+                for (GIMLI::Index i = start; i < end; i ++){
+                    resps[i] = clones[i]->response(GIMLI::RVector(nPara, double(i)));
+                }
+            }, 4);
+        for (GIMLI::Index i = 0; i < nClones; i ++){
+            const GIMLI::ModellingBase & cC = *clones[i];
+            CPPUNIT_ASSERT(cC.mesh() != cAFop.mesh());
+            CPPUNIT_ASSERT(GIMLI::min(resps[i]) == double(i));
+            CPPUNIT_ASSERT(GIMLI::max(cC.mesh()->cellAttributes()) == double(i));
+        }
+        CPPUNIT_ASSERT(cAFop.mesh() == &aFop.regionManager().mesh());
+        CPPUNIT_ASSERT(GIMLI::max(cAFop.mesh()->cellAttributes()) == 5.0);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(GIMLIMiscTest);
@@ -3,11 +3,31 @@
 #include <gimli.h>
 #include <mesh.h>
 #include <meshgenerators.h>
+#include <interpolate.h>
+#include <sparsematrix.h>
+#include <regionManager.h>
+#include <threadpool.h>
 
 #include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <algorithm>
 
 using namespace GIMLI;
 
+//! Gives the tests access to both neighbor searches.
+class NeighborTestMesh_ : public Mesh {
+public:
+    NeighborTestMesh_(const Mesh & mesh) : Mesh(mesh){}
+
+    Index createHashed(){ return createNeighborInfosHashed_(); }
+
+    void createCellwise(Cell * c){ createNeighborInfosCell_(c); }
+};
+
 class MeshTest : public CppUnit::TestFixture{
     CPPUNIT_TEST_SUITE(MeshTest);
     CPPUNIT_TEST(testSimple);
@@ -15,6 +35,14 @@ class MeshTest : public CppUnit::TestFixture{
     CPPUNIT_TEST(testRefine3d);
 
     CPPUNIT_TEST(testPolygonInsertion);
+    CPPUNIT_TEST(testEdgeSplit);
+    CPPUNIT_TEST(testBinaryV4);
+    CPPUNIT_TEST(testExportPVTU);
+    CPPUNIT_TEST(testImportVTK);
+    CPPUNIT_TEST(testNeighborInfos);
+    CPPUNIT_TEST(testNodeCellInterpolation);
+    CPPUNIT_TEST(testRegionManager);
+    CPPUNIT_TEST(testEntityArena);
 
     //CPPUNIT_TEST_EXCEPTION(funct, exception);
     CPPUNIT_TEST_SUITE_END();
@@ -169,6 +197,574 @@ public:
         CPPUNIT_ASSERT(q1.node(0).id() == 4);
         CPPUNIT_ASSERT(q1.node(1).id() == 8);
     }
+    void testEdgeSplit(){
+        Mesh m(2, true);
+        Node *n0 = m.createNode(RVector3(0.0, 0.0));
+        Node *n1 = m.createNode(RVector3(10.0, 0.0));
+        Node *n2 = m.createNode(RVector3(10.0, -5.0));
+        m.createEdge(*n0, *n1, 1);
+        m.createEdge(*n1, *n2, 2);
+
+        for (Index i = 1; i < 100; i ++){
+            m.createNodeWithCheck(RVector3(0.1 * ((i * 37) % 100), 0.0),
+                                  1e-6, false, true);
+        }
+        m.createNodeWithCheck(RVector3(10.0, -2.5), 1e-6, false, true);
+        CPPUNIT_ASSERT(m.nodeCount() == 103);
+        CPPUNIT_ASSERT(m.boundaryCount() == 102);
+
+        double len = 0.0;
+        for (Index i = 0; i < m.boundaryCount(); i ++){
+            if (m.boundary(i).marker() == 1) len += m.boundary(i).size();
+            CPPUNIT_ASSERT(m.boundary(i).size() < 0.1 + 1e-12 ||
+                           m.boundary(i).marker() == 2);
+        }
+        CPPUNIT_ASSERT(std::fabs(len - 10.0) < 1e-12);
+    }
+
+    void testEntityArena(){
+        //** the arena alone: aligned, stable and grows past one slab
+        EntityArena arena;
+        CPPUNIT_ASSERT(arena.allocated() == 0);
+        std::vector< RVector3 * > ps;
+        for (Index i = 0; i < 10000; i ++){
+            ps.push_back(arena.create< RVector3 >(double(i), 1.0, 2.0));
+        }
+        CPPUNIT_ASSERT(arena.allocated() > (Index(1) << 16));
+        for (Index i = 0; i < ps.size(); i ++){
+            CPPUNIT_ASSERT(ps[i]->x() == double(i) && ps[i]->z() == 2.0);
+            CPPUNIT_ASSERT(reinterpret_cast< std::size_t >(ps[i]) % alignof(RVector3) == 0);
+        }
+        //** larger than a slab
+        std::vector< char > * big = arena.create< std::vector< char > >(Index(1) << 20, 'x');
+        CPPUNIT_ASSERT(big->size() == (Index(1) << 20));
+        big->~vector();
+        arena.clear();
+        CPPUNIT_ASSERT(arena.allocated() == 0);
+
+        //** mesh entities keep their addresses while the mesh grows
+        Mesh mesh(createTriangleMesh_(2));
+        mesh.createNeighborInfos();
+        Node * n0 = &mesh.node(0);
+        Cell * c0 = &mesh.cell(0);
+        Boundary * b0 = &mesh.boundary(0);
+        RVector3 c0Center(c0->center());
+        Index nCells0 = mesh.cellCount();
+        for (Index i = 0; i < 3000; i ++){
+            Node * a = mesh.createNode(10.0 + i, 0.0, 0.0);
+            Node * b = mesh.createNode(10.0 + i, 1.0, 0.0);
+            Node * c = mesh.createNode(11.0 + i, 0.0, 0.0);
+            mesh.createTriangle(*a, *c, *b, 1);
+            mesh.createEdge(*a, *b, 2, false);
+        }
+        CPPUNIT_ASSERT(mesh.cellCount() == nCells0 + 3000);
+        CPPUNIT_ASSERT(&mesh.node(0) == n0 && &mesh.cell(0) == c0 && &mesh.boundary(0) == b0);
+        CPPUNIT_ASSERT(n0->pos() == RVector3(0.0, 0.0, 0.0));
+        CPPUNIT_ASSERT(c0->center() == c0Center && &c0->node(0) == n0);
+        CPPUNIT_ASSERT(std::fabs(sum(mesh.cellSizes()) - (4.0 + 3000 * 0.5)) < 1e-8);
+
+        //** a copy has its own entities, it also creates the missing edges
+        mesh.createNeighborInfos(true);
+        CPPUNIT_ASSERT(&mesh.boundary(0) == b0);
+        Mesh copy(mesh);
+        CPPUNIT_ASSERT(copy.nodeCount() == mesh.nodeCount());
+        CPPUNIT_ASSERT(copy.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(copy.boundaryCount() == mesh.boundaryCount());
+        CPPUNIT_ASSERT(copy.positions() == mesh.positions());
+        CPPUNIT_ASSERT(&copy.node(0) != n0);
+        copy.node(0).setPos(RVector3(-1.0, 0.0));
+        CPPUNIT_ASSERT(n0->pos() == RVector3(0.0, 0.0, 0.0));
+        for (Index i = 0; i < mesh.cellCount(); i += 97){
+            CPPUNIT_ASSERT(copy.cell(i).node(2).id() == mesh.cell(i).node(2).id());
+        }
+
+        //** clear destroys all and the mesh can be filled again
+        mesh.clear();
+        CPPUNIT_ASSERT(mesh.nodeCount() == 0 && mesh.cellCount() == 0 &&
+                       mesh.boundaryCount() == 0);
+        CPPUNIT_ASSERT(copy.cellCount() == nCells0 + 3000);
+        mesh = createTriangleMesh_(3);
+        mesh.createNeighborInfos();
+        CPPUNIT_ASSERT(mesh.cellCount() == 18);
+        CPPUNIT_ASSERT(std::fabs(sum(mesh.cellSizes()) - 9.0) < 1e-12);
+        CPPUNIT_ASSERT(mesh.cell(17).node(2).id() < mesh.nodeCount());
+    }
+
+    void checkRegions_(const Mesh & mesh){
+        RegionManager rm(false);
+        rm.setMesh(mesh);
+
+        IVector markers(unique(sort(mesh.cellMarkers())));
+        CPPUNIT_ASSERT(rm.regionCount() == markers.size());
+
+        for (auto & m: markers){
+            Region * r = rm.region(m);
+            //** reference: the per region scan used before
+            std::vector< Cell * > cells(mesh.findCellByMarker(m));
+            std::vector< Boundary * > bounds;
+            if (!r->isSingle()){
+                for (Index i = 0; i < mesh.boundaryCount(); i ++){
+                    Boundary & b = mesh.boundary(i);
+                    if (b.leftCell() && b.rightCell() &&
+                        b.leftCell()->marker() == m &&
+                        b.rightCell()->marker() == m) bounds.push_back(&b);
+                }
+            }
+            //** the manager holds its own copy of the mesh, so compare ids
+            CPPUNIT_ASSERT(r->cells().size() == cells.size());
+            for (Index i = 0; i < cells.size(); i ++){
+                CPPUNIT_ASSERT(r->cells()[i]->id() == cells[i]->id());
+            }
+            CPPUNIT_ASSERT(r->boundaries().size() == bounds.size());
+            for (Index i = 0; i < bounds.size(); i ++){
+                CPPUNIT_ASSERT(r->boundaries()[i]->id() == bounds[i]->id());
+            }
+        }
+
+        //** the former *:* loop over all region pairs adds nothing new
+        Index nConstraints = rm.interRegionConstraintsCount();
+        if (markers.size() > 50){
+            CPPUNIT_ASSERT(nConstraints > 0);
+            for (auto & a: markers){
+                for (auto & b: markers){
+                    if (a != b) rm.setInterRegionConstraint(a, b, 1.0);
+                }
+            }
+        }
+        CPPUNIT_ASSERT(rm.interRegionConstraintsCount() == nConstraints);
+    }
+
+    void testRegionManager(){
+        //** 4 multi parameter regions
+        Mesh mesh(createMesh2D(10, 6));
+        for (auto & c: mesh.cells()){
+            RVector3 p(c->center());
+            c->setMarker((p[0] > 5.) + 2 * (p[1] > 3.));
+        }
+        checkRegions_(mesh);
+
+        //** more than 50 regions are single regions
+        for (auto & c: mesh.cells()) c->setMarker(c->id());
+        checkRegions_(mesh);
+    }
+
+    void testNodeCellInterpolation(){
+        //** 2 x 1 quads with cell sizes 1 and 3
+        Mesh mesh(createGrid(RVector(std::vector< double >{0.0, 1.0, 4.0}),
+                             RVector(std::vector< double >{0.0, 1.0})));
+        RVector cData(std::vector< double >{1.0, 2.0});
+
+        RVector n(cellDataToPointData(mesh, cData));
+        CPPUNIT_ASSERT(n.size() == mesh.nodeCount());
+        CPPUNIT_ASSERT(std::fabs(n[0] - 1.0) < TOLERANCE);
+        CPPUNIT_ASSERT(std::fabs(n[1] - 1.5) < TOLERANCE);
+        CPPUNIT_ASSERT(std::fabs(n[2] - 2.0) < TOLERANCE);
+
+        RVector w(cellDataToPointData(mesh, cData, true));
+        CPPUNIT_ASSERT(std::fabs(w[1] - 7.0 / 4.0) < TOLERANCE);
+        CPPUNIT_ASSERT(std::fabs(w[4] - 7.0 / 4.0) < TOLERANCE);
+
+        const RSparseMatrix & A = mesh.cellToNodeInterpolation();
+        CPPUNIT_ASSERT(A.rows() == mesh.nodeCount() && A.cols() == mesh.cellCount());
+        CPPUNIT_ASSERT(&A == &mesh.cellToNodeInterpolation());
+
+        //** moving nodes: no cached weights, zero sized cells give zeros
+        Mesh moved(mesh);
+        moved.setStaticGeometry(false);
+        CPPUNIT_ASSERT_THROW(moved.cellToNodeInterpolation(true), std::exception);
+        moved.node(2).setPos(RVector3(1.0, 0.0));
+        moved.node(5).setPos(RVector3(1.0, 1.0));
+        RVector wm(cellDataToPointData(moved, cData, true));
+        CPPUNIT_ASSERT(std::fabs(wm[1] - 1.0) < TOLERANCE);
+        CPPUNIT_ASSERT(wm[2] == 0.0 && wm[5] == 0.0);
+
+        RVector c(pointDataToCellData(mesh, x(mesh.positions())));
+        CPPUNIT_ASSERT(std::fabs(c[0] - 0.5) < TOLERANCE);
+        CPPUNIT_ASSERT(std::fabs(c[1] - 2.5) < TOLERANCE);
+
+        //** a new cell changes the operators
+        Node * n6 = mesh.createNode(RVector3(5.0, 0.0));
+        mesh.createTriangle(mesh.node(2), *n6, mesh.node(5));
+        RVector n2(cellDataToPointData(mesh, RVector(std::vector< double >{1.0, 2.0, 5.0})));
+        CPPUNIT_ASSERT(n2.size() == mesh.nodeCount());
+        CPPUNIT_ASSERT(std::fabs(n2[2] - 3.5) < TOLERANCE);
+        CPPUNIT_ASSERT(std::fabs(n2[6] - 5.0) < TOLERANCE);
+
+        //** nodes without cells have no mean
+        mesh.createNode(RVector3(9.0, 9.0));
+        RVector cData3(std::vector< double >{1.0, 2.0, 5.0});
+        RVector n3(cellDataToPointData(mesh, cData3));
+        CPPUNIT_ASSERT(std::isnan(n3[7]) && !std::isnan(n3[6]));
+        CPPUNIT_ASSERT(std::isnan(cellDataToPointData(mesh, cData3, true)[7]));
+
+        //** concurrent const callers build the caches once
+        Mesh fresh(mesh);
+        const Mesh & cFresh = fresh;
+        std::vector< const RSparseMatrix * > ops(16, 0);
+        ThreadPool::instance().parallelFor(0, ops.size(), 1,
+            [&](Index start, Index end, Index){
+                for (Index i = start; i < end; i ++){
+                    ops[i] = (i % 2) ? &cFresh.cellToNodeInterpolation() :
+                                       &cFresh.nodeToCellInterpolation();
+                }
+            }, 4);
+        for (Index i = 0; i < ops.size(); i ++){
+            CPPUNIT_ASSERT(ops[i] == ops[i % 2]);
+        }
+        CPPUNIT_ASSERT(ops[1]->rows() == fresh.nodeCount());
+        CPPUNIT_ASSERT(ops[0]->rows() == fresh.cellCount());
+    }
+
+    /*! Read the ascii values of the DataArray with the attribute key or of
+     * the first DataArray after the element key. */
+    std::vector < double > vtuArray_(const std::string & content,
+                                     const std::string & key){
+        std::vector < double > vals;
+        std::string::size_type pos = content.find(key);
+        CPPUNIT_ASSERT(pos != std::string::npos);
+        if (key[0] == '<') pos = content.find("<DataArray", pos);
+        pos = content.find(">", pos) + 1;
+        std::istringstream is(content.substr(pos, content.find("</DataArray>", pos) - pos));
+        double v;
+        while (is >> v) vals.push_back(v);
+        return vals;
+    }
+
+    std::string readFile_(const std::string & fileName){
+        std::ifstream file(fileName.c_str());
+        CPPUNIT_ASSERT(file.good());
+        std::stringstream ss; ss << file.rdbuf();
+        return ss.str();
+    }
+
+    void testExportPVTU(){
+        std::string body(getEnvironment< std::string >("TMPDIR", "/tmp") + "/gimli_testpvtu");
+        RVector x(std::vector< double >{0.0, 1.0, 2.0, 3.0, 4.0});
+        Mesh mesh(createMesh2D(x, RVector(std::vector< double >{0.0, 1.0, 2.0, 3.0}), 0));
+        for (Index i = 0; i < mesh.cellCount(); i ++) mesh.cell(i).setMarker(i);
+        mesh.addData("n", GIMLI::x(mesh.positions()));
+
+        //** single file keeps the node numbering
+        mesh.exportVTU(body, false);
+        std::string content(readFile_(body + ".vtu"));
+        std::vector < double > conn(vtuArray_(content, "Name=\"connectivity\""));
+        CPPUNIT_ASSERT(conn.size() == 4 * mesh.cellCount());
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            for (Index j = 0; j < 4; j ++){
+                CPPUNIT_ASSERT(conn[4 * i + j] == mesh.cell(i).node(j).id());
+            }
+        }
+        std::remove((body + ".vtu").c_str());
+
+        //** pieces hold consecutive cells with their own nodes
+        Index nPieces = 3;
+        mesh.exportPVTU(body, nPieces, false);
+        content = readFile_(body + ".pvtu");
+        CPPUNIT_ASSERT(content.find("Name=\"_Marker\"") != std::string::npos);
+        CPPUNIT_ASSERT(content.find("<Piece Source=\"gimli_testpvtu_2.vtu\"/>")
+                       != std::string::npos);
+
+        Index cellID = 0;
+        for (Index i = 0; i < nPieces; i ++){
+            std::string piece(body + "_" + str(i) + ".vtu");
+            content = readFile_(piece);
+            std::vector < double > points(vtuArray_(content, "<Points>"));
+            std::vector < double > conn(vtuArray_(content, "Name=\"connectivity\""));
+            std::vector < double > offsets(vtuArray_(content, "Name=\"offsets\""));
+            std::vector < double > marker(vtuArray_(content, "Name=\"_Marker\""));
+            std::vector < double > n(vtuArray_(content, "Name=\"n\""));
+            CPPUNIT_ASSERT(n.size() * 3 == points.size());
+            CPPUNIT_ASSERT(marker.size() == offsets.size());
+
+            for (Index c = 0; c < offsets.size(); c ++){
+                const Cell & cell = mesh.cell(cellID);
+                CPPUNIT_ASSERT(marker[c] == cell.marker());
+                Index first = c > 0 ? offsets[c - 1] : 0;
+                CPPUNIT_ASSERT(offsets[c] - first == cell.nodeCount());
+                for (Index j = 0; j < cell.nodeCount(); j ++){
+                    Index id = conn[first + j];
+                    RVector3 p(points[3 * id], points[3 * id + 1], points[3 * id + 2]);
+                    CPPUNIT_ASSERT(p.dist(cell.node(j).pos()) < 1e-10);
+                    CPPUNIT_ASSERT(std::fabs(n[id] - p[0]) < 1e-6);
+                }
+                cellID ++;
+            }
+            std::remove(piece.c_str());
+        }
+        CPPUNIT_ASSERT(cellID == mesh.cellCount());
+        std::remove((body + ".pvtu").c_str());
+
+        //** a mesh without cells gives one empty piece
+        Mesh empty(2);
+        empty.createNode(0.0, 0.0, 0.0);
+        empty.exportPVTU(body, 4, false);
+        content = readFile_(body + "_0.vtu");
+        CPPUNIT_ASSERT(content.find("NumberOfCells=\"0\"") != std::string::npos);
+        CPPUNIT_ASSERT(readFile_(body + ".pvtu").find("_1.vtu") == std::string::npos);
+        std::remove((body + "_0.vtu").c_str());
+        std::remove((body + ".pvtu").c_str());
+    }
+
+    void testImportVTK(){
+        std::string fileName(getEnvironment< std::string >("TMPDIR", "/tmp")
+                             + "/gimli_testlegacy.vtk");
+        //** vtk 5.1 cell layout, nan/inf values and a token longer than 64 chars
+        std::ofstream file(fileName.c_str());
+        file << "# vtk DataFile Version 5.1" << std::endl
+             << "test" << std::endl << "ASCII" << std::endl
+             << "DATASET UNSTRUCTURED_GRID" << std::endl
+             << "POINTS 4 double" << std::endl
+             << "0 0 0 1 0 0 0 1 0 1 1 0" << std::endl
+             << "CELLS 3 6" << std::endl
+             << "OFFSETS vtktypeint64" << std::endl << "0 3 6" << std::endl
+             << "CONNECTIVITY vtktypeint64" << std::endl << "0 1 2 1 3 2" << std::endl
+             << "CELL_TYPES 2" << std::endl << "5 5" << std::endl
+             << "CELL_DATA 2" << std::endl
+             << "SCALARS Marker int 1" << std::endl
+             << "LOOKUP_TABLE default" << std::endl << "3 4" << std::endl
+             << "POINT_DATA 4" << std::endl
+             << "SCALARS u double" << std::endl
+             << "nan inf -inf 1." << std::string(80, '0') << "1" << std::endl;
+        file.close();
+
+        Mesh mesh; mesh.importVTK(fileName);
+        CPPUNIT_ASSERT(mesh.dim() == 2);
+        CPPUNIT_ASSERT(mesh.nodeCount() == 4);
+        CPPUNIT_ASSERT(mesh.cellCount() == 2);
+        CPPUNIT_ASSERT(mesh.cell(1).node(1).id() == 3);
+        CPPUNIT_ASSERT(mesh.cell(0).marker() == 3 && mesh.cell(1).marker() == 4);
+        RVector u(mesh.data("u"));
+        CPPUNIT_ASSERT(u.size() == 4);
+        CPPUNIT_ASSERT(std::isnan(u[0]));
+        CPPUNIT_ASSERT(std::isinf(u[1]) && u[1] > 0 && std::isinf(u[2]) && u[2] < 0);
+        CPPUNIT_ASSERT(std::fabs(u[3] - 1.0) < TOLERANCE);
+
+        //** values without data section end at the next keyword, unknown
+        //** sections are skipped
+        file.open(fileName.c_str());
+        file << "# vtk DataFile Version 3.0" << std::endl
+             << "test" << std::endl << "ASCII" << std::endl
+             << "DATASET UNSTRUCTURED_GRID" << std::endl
+             << "POINTS 3 float" << std::endl
+             << "0 0 0 1 0 0 0 1 0" << std::endl
+             << "SCALARS s double" << std::endl << "NaN 2" << std::endl << "Infinity" << std::endl
+             << "UNKNOWN_SECTION 2" << std::endl << "nan 1" << std::endl
+             << "CELLS 1 4" << std::endl << "3 0 1 2" << std::endl
+             << "CELL_TYPES 1" << std::endl << "5" << std::endl;
+        file.close();
+
+        mesh.importVTK(fileName);
+        CPPUNIT_ASSERT(mesh.cellCount() == 1);
+        RVector s(mesh.data("s"));
+        CPPUNIT_ASSERT(s.size() == 3);
+        CPPUNIT_ASSERT(std::isnan(s[0]) && s[1] == 2.0 && std::isinf(s[2]));
+
+        //** binary data is big endian
+        file.open(fileName.c_str(), std::ios::out | std::ios::binary);
+        file << "# vtk DataFile Version 3.0" << std::endl
+             << "test" << std::endl << "BINARY" << std::endl
+             << "DATASET UNSTRUCTURED_GRID" << std::endl
+             << "POINTS 3 float" << std::endl;
+        float coords[9] = {0.f, 0.f, 0.f, 2.f, 0.f, 0.f, 0.f, 0.5f, 0.f};
+        for (Index i = 0; i < 9; i ++) writeBigEndian_(file, coords[i]);
+        file << std::endl << "CELLS 1 4" << std::endl;
+        int32 cells[4] = {3, 0, 1, 2};
+        for (Index i = 0; i < 4; i ++) writeBigEndian_(file, cells[i]);
+        file << std::endl << "CELL_TYPES 1" << std::endl;
+        writeBigEndian_(file, int32(5));
+        file << std::endl << "CELL_DATA 1" << std::endl
+             << "SCALARS Marker int 1" << std::endl
+             << "LOOKUP_TABLE default" << std::endl;
+        writeBigEndian_(file, int32(-7));
+        file << std::endl;
+        file.close();
+
+        mesh.importVTK(fileName);
+        CPPUNIT_ASSERT(mesh.nodeCount() == 3);
+        CPPUNIT_ASSERT(mesh.cellCount() == 1);
+        CPPUNIT_ASSERT(mesh.node(1).pos() == RVector3(2.0, 0.0));
+        CPPUNIT_ASSERT(mesh.node(2).pos() == RVector3(0.0, 0.5));
+        CPPUNIT_ASSERT(mesh.cell(0).marker() == -7);
+
+        //** corrupt cell sections throw instead of reading out of bounds
+        for (std::string cells: {"CELLS 1 4\n5 0 1 2\n",
+                                 "CELLS 1 4\n3 0 1 7\n",
+                                 "CELLS 3 6\nOFFSETS vtktypeint64\n0 4 3\n"
+                                 "CONNECTIVITY vtktypeint64\n0 1 2 1 2 0\n",
+                                 "CELLS 3 6\nOFFSETS vtktypeint64\n0 3 9\n"
+                                 "CONNECTIVITY vtktypeint64\n0 1 2 1 2 0\n"}){
+            file.open(fileName.c_str());
+            file << "# vtk DataFile Version 5.1" << std::endl
+                 << "test" << std::endl << "ASCII" << std::endl
+                 << "DATASET UNSTRUCTURED_GRID" << std::endl
+                 << "POINTS 3 float" << std::endl
+                 << "0 0 0 1 0 0 0 1 0" << std::endl << cells;
+            file.close();
+            CPPUNIT_ASSERT_THROW(mesh.importVTK(fileName), std::exception);
+        }
+        std::remove(fileName.c_str());
+    }
+
+    template < class T > void writeBigEndian_(std::ofstream & file, T v){
+        char tmp[sizeof(T)];
+        std::memcpy(tmp, &v, sizeof(T));
+        for (Index i = 0; i < sizeof(T); i ++) file.put(tmp[sizeof(T) - 1 - i]);
+    }
+
+    /*! Triangle mesh on a (n+1)^2 grid. */
+    Mesh createTriangleMesh_(Index n){
+        Mesh mesh(2);
+        for (Index j = 0; j <= n; j ++){
+            for (Index i = 0; i <= n; i ++){
+                mesh.createNode(double(i), double(j), 0.0);
+            }
+        }
+        for (Index j = 0; j < n; j ++){
+            for (Index i = 0; i < n; i ++){
+                Index a = j * (n + 1) + i;
+                mesh.createTriangle(mesh.node(a), mesh.node(a + 1), mesh.node(a + n + 2), i);
+                mesh.createTriangle(mesh.node(a), mesh.node(a + n + 2), mesh.node(a + n + 1), j);
+            }
+        }
+        return mesh;
+    }
+
+    /*! Compare the hashed neighbor search with the per-cell search. */
+    void compareNeighborInfos_(const Mesh & mesh){
+        NeighborTestMesh_ hashed(mesh), cellwise(mesh);
+        //** an inner boundary marker must be kept
+        for (Index i = 0; i < hashed.boundaryCount(); i ++){
+            if (hashed.boundary(i).rightCell()){
+                hashed.boundary(i).setMarker(5);
+                cellwise.boundary(i).setMarker(5);
+                break;
+            }
+        }
+        hashed.cleanNeighborInfos();
+        cellwise.cleanNeighborInfos();
+        CPPUNIT_ASSERT(hashed.createHashed() == 0);
+        for (Index i = 0; i < cellwise.cellCount(); i ++){
+            cellwise.createCellwise(&cellwise.cell(i));
+        }
+
+        CPPUNIT_ASSERT(hashed.boundaryCount() == cellwise.boundaryCount());
+        for (Index i = 0; i < hashed.cellCount(); i ++){
+            Cell & c0 = hashed.cell(i);
+            Cell & c1 = cellwise.cell(i);
+            for (Index j = 0; j < c0.neighborCellCount(); j ++){
+                CPPUNIT_ASSERT((c0.neighborCell(j) == NULL) == (c1.neighborCell(j) == NULL));
+                if (c0.neighborCell(j)){
+                    CPPUNIT_ASSERT(c0.neighborCell(j)->id() == c1.neighborCell(j)->id());
+                }
+            }
+        }
+
+        //** the boundaries may be created in a different order
+        std::map < std::vector < Index >, Boundary * > bounds;
+        for (Index i = 0; i < cellwise.boundaryCount(); i ++){
+            Boundary & b = cellwise.boundary(i);
+            std::vector < Index > key(b.ids());
+            std::sort(key.begin(), key.end());
+            bounds[key] = &b;
+        }
+        Index nInner = 0;
+        for (Index i = 0; i < hashed.boundaryCount(); i ++){
+            Boundary & b = hashed.boundary(i);
+            std::vector < Index > key(b.ids());
+            std::sort(key.begin(), key.end());
+            CPPUNIT_ASSERT(bounds.count(key));
+            Boundary & r = *bounds[key];
+            CPPUNIT_ASSERT(b.marker() == r.marker());
+            CPPUNIT_ASSERT(b.leftCell() && r.leftCell());
+            CPPUNIT_ASSERT(b.leftCell()->id() == r.leftCell()->id());
+            CPPUNIT_ASSERT((b.rightCell() == NULL) == (r.rightCell() == NULL));
+            if (b.rightCell()){
+                CPPUNIT_ASSERT(b.rightCell()->id() == r.rightCell()->id());
+                nInner ++;
+            }
+        }
+        CPPUNIT_ASSERT(nInner > 0);
+    }
+
+    void testNeighborInfos(){
+        RVector x(std::vector< double >{0.0, 1.0, 2.0, 3.5});
+        //** 2D quads, triangles and their quadratic versions
+        Mesh quads(createMesh2D(x, x, 0));
+        compareNeighborInfos_(quads);
+        compareNeighborInfos_(quads.createP2());
+        Mesh tris(createTriangleMesh_(4));
+        compareNeighborInfos_(tris);
+        compareNeighborInfos_(tris.createP2());
+        //** 3D hexahedrons and prisms
+        Mesh hex(createMesh3D(x, x, x, 0));
+        compareNeighborInfos_(hex);
+        compareNeighborInfos_(hex.createP2());
+        compareNeighborInfos_(createMesh3D(tris, x));
+
+        //** a duplicated corner cell is a third cell on its two inner faces
+        NeighborTestMesh_ dup(createMesh2D(x, x, 0));
+        dup.createCell(dup.cell(0));
+        dup.cleanNeighborInfos();
+        CPPUNIT_ASSERT(dup.createHashed() == 2);
+    }
+
+    void testBinaryV4(){
+        RVector x(std::vector< double >{0.0, 1.0, 2.0, 3.0});
+        Mesh mesh(createMesh3D(x, x, x, 0));
+        mesh.createNeighborInfos();
+        mesh.addData("c", RVector(mesh.cellCount(), 2.0));
+        std::string fileName(getEnvironment< std::string >("TMPDIR", "/tmp")
+                             + "/gimli_testv4.bms");
+        mesh.saveBinaryV4(fileName);
+
+        Mesh m2; m2.load(fileName);
+        CPPUNIT_ASSERT(m2.neighborsKnown());
+        CPPUNIT_ASSERT(m2.nodeCount() == mesh.nodeCount());
+        CPPUNIT_ASSERT(m2.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(m2.boundaryCount() == mesh.boundaryCount());
+        CPPUNIT_ASSERT(m2.positions() == mesh.positions());
+        CPPUNIT_ASSERT(m2.data("c") == mesh.data("c"));
+
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            for (uint j = 0; j < mesh.cell(i).neighborCellCount(); j ++){
+                Cell * n1 = mesh.cell(i).neighborCell(j);
+                Cell * n2 = m2.cell(i).neighborCell(j);
+                CPPUNIT_ASSERT((n1 == NULL) == (n2 == NULL));
+                if (n1) CPPUNIT_ASSERT(n1->id() == n2->id());
+            }
+        }
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            CPPUNIT_ASSERT(mesh.boundary(i).marker() == m2.boundary(i).marker());
+            CPPUNIT_ASSERT(mesh.boundary(i).leftCell()->id() ==
+                           m2.boundary(i).leftCell()->id());
+        }
+
+        //** a left cell index beyond the cell count must be rejected
+        uint64 leftOffset = 0;
+        int64 badId = mesh.cellCount() + 5;
+        std::fstream file(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(72 + 9 * sizeof(uint64));
+        file.read((char*)&leftOffset, sizeof(uint64));
+        file.seekp(leftOffset);
+        file.write((char*)&badId, sizeof(int64));
+        file.close();
+        Mesh m3;
+        CPPUNIT_ASSERT_THROW(m3.load(fileName), std::exception);
+        //** and not be hidden by the fallback to the v1 format
+        std::string msg;
+        try { m3.load(fileName); } catch(std::exception & e){ msg = e.what(); }
+        CPPUNIT_ASSERT(msg.find("cell index out of range") != std::string::npos);
+
+        //** 1D meshes are read back by load too
+        Mesh mesh1(createMesh1D(x));
+        mesh1.saveBinaryV4(fileName);
+        Mesh m4; m4.load(fileName);
+        CPPUNIT_ASSERT(m4.dim() == 1);
+        CPPUNIT_ASSERT(m4.cellCount() == mesh1.cellCount());
+        CPPUNIT_ASSERT(m4.positions() == mesh1.positions());
+        std::remove(fileName.c_str());
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MeshTest);
\ No newline at end of file
@@ -5,9 +5,12 @@
 #include <vector.h>
 #include <blockmatrix.h>
 #include <matrix.h>
+#include <mappedmatrix.h>
+#include <solver.h>
 #include <sparsematrix.h>
 #include <vectortemplates.h>
 #include <vector>
+#include <fstream>
 
 #include <stdexcept>
 
@@ -32,6 +35,10 @@ class VectorTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testSparseMapMatrix);
     CPPUNIT_TEST(testFind);
     CPPUNIT_TEST(testIO);
+    CPPUNIT_TEST(testMappedMatrix);
+    CPPUNIT_TEST(testAttach);
+    CPPUNIT_TEST(testCGLSSolver);
+    CPPUNIT_TEST(testMultiLambdaSolver);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -554,6 +561,190 @@ public:
         RVector t2("test", Binary);
         CPPUNIT_ASSERT(v == t2);
     }
+
+    void testAttach(){
+        double buf[6] = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0};
+        RVector v;
+        v.attach(buf, 6);
+        CPPUNIT_ASSERT(v.isView());
+        CPPUNIT_ASSERT(sum(v) == 15.0);
+        v *= 2.0;
+        CPPUNIT_ASSERT(buf[5] == 10.0);
+
+        RVector c(v);
+        CPPUNIT_ASSERT(!c.isView());
+        c[0] = 1.0;
+        CPPUNIT_ASSERT(buf[0] == 0.0);
+
+        v.resize(7, 1.0);
+        CPPUNIT_ASSERT(!v.isView());
+        CPPUNIT_ASSERT(v[5] == 10.0 && v[6] == 1.0);
+        v[0] = 3.0;
+        CPPUNIT_ASSERT(buf[0] == 0.0);
+
+        RMatrix A;
+        A.attach(buf, 2, 3);
+        CPPUNIT_ASSERT(A.rows() == 2 && A.cols() == 3);
+        CPPUNIT_ASSERT(A[1][0] == 6.0);
+        A[1][1] = -1.0;
+        CPPUNIT_ASSERT(buf[4] == -1.0);
+        RMatrix B(A);
+        CPPUNIT_ASSERT(!B[0].isView());
+    }
+
+    void testMappedMatrix(){
+        RMatrix A(7, 5);
+        for (Index i = 0; i < A.rows(); i ++) randn(A[i]);
+        saveMatrix(A, "test.bmat");
+
+        RMappedMatrix M("test.bmat");
+        CPPUNIT_ASSERT(M.rows() == A.rows());
+        CPPUNIT_ASSERT(M.cols() == A.cols());
+        CPPUNIT_ASSERT(M.row(3) == A[3]);
+        CPPUNIT_ASSERT(M.col(2) == A.col(2));
+
+        RVector x(A.cols()); randn(x);
+        RVector y(A.rows()); randn(y);
+        CPPUNIT_ASSERT(norm(M.mult(x) - A.mult(x)) < 1e-12);
+        CPPUNIT_ASSERT(norm(M.transMult(y) - A.transMult(y)) < 1e-12);
+
+        RMatrix B; loadMatrixSingleBin(B, "test.bmat");
+        CPPUNIT_ASSERT(B.rows() == A.rows());
+        CPPUNIT_ASSERT(B[6] == A[6]);
+
+        for (Index i = 0; i < A.rows(); i ++){
+            save(A[i], "test." + str(i), Binary);
+        }
+        RMappedMatrix V("test", 1);
+        CPPUNIT_ASSERT(V.rows() == A.rows());
+        CPPUNIT_ASSERT(norm(V.mult(x) - A.mult(x)) < 1e-12);
+
+        //** negative lengths and lengths whose byte size wraps around to
+        //** the file size are rejected
+        for (int64 len: {int64(-5), int64(5) + (int64(1) << 61)}){
+            std::fstream file("test.0", std::ios::in | std::ios::out | std::ios::binary);
+            file.write((char*)&len, sizeof(int64));
+            file.close();
+            CPPUNIT_ASSERT_THROW(RMappedMatrix("test", 1), std::exception);
+        }
+    }
+
+    /*! Small regularized problem for the CGLS solvers, with smoothness
+     * constraints and nonuniform weights and transformations. */
+    void createCGLSProblem_(RMatrix & S, RSparseMapMatrix & C,
+                            RVector & dW, RVector & b, RVector & td,
+                            RVector & wc, RVector & wm, RVector & tm,
+                            RVector & rough){
+        Index nData = 80, nModel = 120;
+        S.resize(nData, nModel);
+        for (Index i = 0; i < nData; i ++){
+            for (Index j = 0; j < nModel; j ++){
+                S[i][j] = std::sin(0.3 * i * j + i) / (1.0 + std::fabs(double(i) - j));
+            }
+        }
+        C = RSparseMapMatrix(nModel - 1, nModel);
+        for (Index i = 0; i < nModel - 1; i ++){
+            C.setVal(i, i, -1.0);
+            C.setVal(i, i + 1, 1.0);
+        }
+        dW.resize(nData); b.resize(nData); td.resize(nData);
+        for (Index i = 0; i < nData; i ++){
+            dW[i] = 1.0 + 0.01 * i;
+            b[i] = std::cos(0.1 * i);
+            td[i] = 1.0 + 0.1 * std::sin(double(i));
+        }
+        wm.resize(nModel); tm.resize(nModel);
+        for (Index i = 0; i < nModel; i ++){
+            wm[i] = 1.0 + 0.002 * i;
+            tm[i] = 0.5 + 0.01 * i;
+        }
+        wc = RVector(nModel - 1, 1.0);
+        rough.resize(nModel - 1);
+        for (Index i = 0; i < nModel - 1; i ++) rough[i] = 0.01 * std::sin(double(i));
+    }
+
+    void testCGLSSolver(){
+        RMatrix S;
+        RSparseMapMatrix C;
+        RVector dW, b, td, wc, wm, tm, rough;
+        createCGLSProblem_(S, C, dW, b, td, wc, wm, tm, rough);
+        double lambda = 5.0;
+
+        //** previous unfused iteration, needs more than 50 iterations here,
+        //** so the periodic recomputation of C * (wm * x) is included
+        RVector xRef(S.cols(), 0.0);
+        RVector cdx(transMult(C, RVector(wc * rough)) * wm * lambda);
+        RVector z(b * dW);
+        RVector r(transMult(S, RVector(b * dW * dW * td)) / tm - cdx);
+        double accuracy = max(TOLERANCE, 1e-08 * dot(r, r));
+        RVector p(transMult(S, RVector(z * dW * td)) / tm - cdx);
+        double normR2 = dot(p, p);
+        int count = 0;
+        while (count < 200 && normR2 > accuracy){
+            count ++;
+            RVector q((S * RVector(p / tm)) * (dW * td));
+            RVector Cpwm(C * RVector(p * wm));
+            Cpwm.round(1e-10);
+            RVector wcp(wc * Cpwm);
+            double alpha = normR2 / (dot(q, q) + lambda * dot(wcp, wcp));
+            xRef += p * alpha;
+            z -= q * alpha;
+            r = transMult(S, RVector(z * dW * td)) / tm
+                - transMult(C, RVector(wc * wc * (C * RVector(wm * xRef)))) * wm * lambda
+                - cdx;
+            double normR2old = normR2;
+            normR2 = dot(r, r);
+            p = r + p * (normR2 / normR2old);
+        }
+        CPPUNIT_ASSERT(count > 50);
+
+        RVector x(S.cols(), 0.0);
+        solveCGLSCDWWhtrans(S, C, dW, b, x, wc, wm, tm, td, lambda, rough);
+        CPPUNIT_ASSERT(max(abs(x - xRef)) < 1e-6 * max(abs(xRef)));
+    }
+
+    void testMultiLambdaSolver(){
+        RMatrix S;
+        RSparseMapMatrix C;
+        RVector dW, b, td, wc, wm, tm, rough;
+        createCGLSProblem_(S, C, dW, b, td, wc, wm, tm, rough);
+        //** the predicted data of zero weighted data are needed too
+        dW[3] = 0.0;
+        dW[40] = 0.0;
+
+        RVector lambdas(3);
+        lambdas[0] = 20.0; lambdas[1] = 5.0; lambdas[2] = 1.0;
+        std::vector < RVector > xs, dds;
+        int k = solveMultiLambdaCDWWhtrans(S, C, dW, b, wc, wm, tm, td,
+                                           lambdas, rough, xs, dds);
+        CPPUNIT_ASSERT(k > 0);
+        CPPUNIT_ASSERT(xs.size() == 3 && dds.size() == 3);
+
+        for (Index l = 0; l < lambdas.size(); l ++){
+            RVector x(S.cols(), 0.0);
+            solveCGLSCDWWhtrans(S, C, dW, b, x, wc, wm, tm, td, lambdas[l], rough);
+            //** both stop at the same relative residual
+            CPPUNIT_ASSERT(max(abs(xs[l] - x)) < 1e-3 * max(abs(x)));
+
+            RVector dd((S * RVector(xs[l] / tm)) * td);
+            CPPUNIT_ASSERT(max(abs(dds[l] - dd)) < 1e-10 * max(abs(dd)));
+        }
+
+        //** a tighter tolerance needs a larger basis
+        int kTight = solveMultiLambdaCDWWhtrans(S, C, dW, b, wc, wm, tm, td,
+                                                lambdas, rough, xs, dds, 200, 1e-20);
+        CPPUNIT_ASSERT(kTight > k);
+
+        //** zero data and roughness give zero updates, no NaN
+        int kZero = solveMultiLambdaCDWWhtrans(S, C, dW, RVector(b.size(), 0.0),
+                                               wc, wm, tm, td, lambdas,
+                                               RVector(rough.size(), 0.0), xs, dds);
+        CPPUNIT_ASSERT(kZero == 0);
+        for (Index l = 0; l < lambdas.size(); l ++){
+            CPPUNIT_ASSERT(max(abs(xs[l])) == 0.0 && max(abs(dds[l])) == 0.0);
+        }
+    }
+
     void setUp(){
         v1_ = new RVector(10);
         v2_ = new RVector(*v1_);